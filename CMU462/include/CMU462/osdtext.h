@@ -35,14 +35,44 @@ struct OSDLine {
 
   // font color
   Color color;
+
+  // cached vertex data (screen space position, texture coordinates and
+  // color of two triangles per glyph), and whether it must be rebuilt
+  std::vector<GLfloat> vertices;
+  bool dirty;
   
 };
 
+struct OSDGlyph {
+
+  // offset of the bitmap from the pen position and its size, in pixels
+  float left, top, width, height;
+
+  // horizontal advance of the pen, in pixels
+  float advance;
+
+  // bounds of the bitmap in the atlas
+  float s0, t0, s1, t1;
+
+};
+
+struct OSDFont {
+
+  // font size (in pixels)
+  size_t size;
+
+  // printable ASCII glyphs at this size
+  std::vector<OSDGlyph> glyphs;
+
+};
+
 /**
  * Provides an interface for text on-screen display. 
- * Note that this requires GL_BLEND enabled to work. Do note this is a very
- * basic implementation and the cost of all operations increases linearly with 
- * respect to the number of lines and the length of the lines. 
+ * Note that this requires GL_BLEND enabled to work. Glyphs of every font
+ * size in use are rasterized once into a single atlas texture, lines are
+ * only laid out again when they change, and all lines are drawn together
+ * from one vertex buffer, so drawing text that has not changed costs one
+ * draw call. Only printable ASCII characters are drawn.
  */
 class OSDText {
  public:
@@ -122,7 +152,8 @@ class OSDText {
   void set_text(int line_id, std::string text);
 
   /**
-   * Set the font size of a given line.
+   * Set the font size of a given line (doubled on HDPI displays, as in
+   * add_line).
    * If the given id is not valid, the call has no effect.
    * \param line_id Index of the line to set the text.
    * \param size The new size to set for the line.
@@ -139,8 +170,18 @@ class OSDText {
 
  private:
 
-  // draw a single line
-  void draw_line(OSDLine line);
+  // find the line with the given id (or lines.end())
+  std::vector<OSDLine>::iterator find_line(int line_id);
+
+  // find the font of the given size in the atlas (or -1)
+  int find_font(size_t size);
+
+  // add a font size to the atlas, and rasterize all glyphs again
+  void add_font(size_t size);
+  void build_atlas();
+
+  // compute the vertex data of a single line
+  void layout_line(OSDLine& line);
 
   // HDPI displays
   bool use_hdpi;
@@ -158,12 +199,21 @@ class OSDText {
   // lines to draw
   std::vector<OSDLine> lines;
 
+  // whether the vbo must be filled again (lines were changed, added or
+  // removed), and the number of vertices it holds
+  bool lines_changed;
+  size_t vertex_count;
+
+  // glyph atlas
+  std::vector<OSDFont> fonts;
+  GLuint atlas;
+
   // GL stuff
   GLuint vbo;
   GLuint program;
   GLint attribute_coord;
+  GLint attribute_color;
   GLint uniform_tex;
-  GLint uniform_color;
   
   // GL helpers
   GLuint compile_shaders();
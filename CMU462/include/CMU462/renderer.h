@@ -118,12 +118,35 @@ class Renderer {
    */
   virtual void mouse_button_event( int button, int event ) { }
 
+  /**
+   * Request continuous redraw.
+   * When drawing on demand, the viewer only draws a frame after user input
+   * or a call to request_frame(). A renderer that has something new to
+   * show on every frame (e.g., an animation, or work done a step at a time
+   * in render()) should return true here for as long as that lasts.
+   */
+  virtual bool wants_frame( void ) { return false; }
+
+  /**
+   * Request a single redraw.
+   * Asks the viewer to draw a new frame even though there was no input,
+   * e.g., when a background computation has produced something to show.
+   * Unlike the other methods, this may be called from any thread.
+   */
+  static void request_frame( void ) { if( frame_requester ) frame_requester(); }
+
   /**
    * Internal - 
    * The viewer will tell the renderer if the screen is in HDPI mode.
    */ 
   void use_hdpi_reneder_target() { use_hdpi = true; }
 
+  /**
+   * Internal - 
+   * The viewer installs the function that handles request_frame().
+   */ 
+  static void (*frame_requester)( void );
+
  protected:
 
   bool use_hdpi; ///< if the render target is using HIDPI
@@ -3,8 +3,12 @@
 
 #include "renderer.h"
 #include "osdtext.h"
+#include "profiler.h"
+#include "trace.h"
 
+#include <atomic>
 #include <chrono>
+#include <vector>
 
 #include "GLFW/glfw3.h"
 
@@ -49,6 +53,10 @@ class Viewer {
   /**
    * Start the drawing loop of the viewer.
    * Once called this will block until the viewer is close.
+   * By default, frames are drawn on demand: after user input, on request
+   * (see Renderer::request_frame() and Renderer::wants_frame()), or when
+   * the window needs to be refreshed; otherwise the viewer sleeps. F3
+   * switches to drawing continuously, and back.
    */
   void start( void );
 
@@ -71,10 +79,27 @@ class Viewer {
    */
   static void drawInfo( void );
 
+  /**
+   * Draw the profiler overlay: a graph of the recent frame times, and the
+   * average time of each stage (see Profiler).
+   */
+  static void drawProfiler( void );
+
+  /**
+   * Stop recording the trace and save it (see Trace).
+   */
+  static void save_trace( void );
+
+  /**
+   * Handle Renderer::request_frame() (from any thread).
+   */
+  static void request_frame( void );
+
   // window event callbacks
   static void err_callback( int error, const char* description );
   static void key_callback( GLFWwindow* window, int key, int scancode, int action, int mods );
   static void resize_callback( GLFWwindow* window, int width, int height );
+  static void refresh_callback( GLFWwindow* window );
   static void cursor_callback( GLFWwindow* window, double xpos, double ypos );
   static void scroll_callback( GLFWwindow* window, double xoffset, double yoffset);
   static void mouse_button_callback( GLFWwindow* window, int button, int action, int mods );
@@ -90,6 +115,16 @@ class Viewer {
   // info toggle
   static bool showInfo;
 
+  // profiler overlay toggle (F1)
+  static bool showProfiler;
+
+  // frame scheduling
+  static bool eventDriven;                 ///< draw on demand only? (toggled with F3)
+  static std::atomic<bool> frameRequested; ///< is a frame due, whether or not eventDriven?
+
+  // last renderer info shown in the OSD
+  static std::string rendererInfo;
+
   // window properties
   static GLFWwindow* window;
   static size_t buffer_w;
@@ -102,6 +137,7 @@ class Viewer {
   static OSDText* osd_text;
   static int line_id_renderer;
   static int line_id_framerate;
+  static std::vector<int> line_id_profiler;
 
 
 }; // class Viewer
@@ -14,6 +14,8 @@
 #include "color.h"
 #include "renderer.h"
 #include "viewer.h"
+#include "profiler.h"
+#include "trace.h"
 
 #include "base64.h"
 #include "tinyxml2.h"
@@ -1,5 +1,7 @@
 #include "osdtext.h"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
 #include "ft2build.h"
@@ -12,12 +14,15 @@ using namespace std;
 
 namespace CMU462 {
 
-struct point {
-    GLfloat x;
-    GLfloat y;
-    GLfloat s;
-    GLfloat t;
-};
+// range of characters in the atlas (printable ASCII)
+static const char first_char = 32;
+static const char last_char  = 126;
+
+// width of the atlas, in pixels (its height depends on the font sizes)
+static const size_t atlas_width = 512;
+
+// floats per vertex: x, y, s, t, r, g, b, a
+static const size_t vertex_size = 8;
 
 OSDText::OSDText() {
 
@@ -27,6 +32,10 @@ OSDText::OSDText() {
   face = new FT_Face;
 
   lines = vector<OSDLine>(); next_id = 0;
+
+  lines_changed = false;
+  vertex_count = 0;
+  atlas = 0;
 }
 
 OSDText::~OSDText() {
@@ -37,6 +46,8 @@ OSDText::~OSDText() {
 
   lines.clear();
   
+  glDeleteTextures(1, &atlas);
+  glDeleteBuffers(1, &vbo);
   glDeleteProgram(program);
 }
 
@@ -68,35 +79,89 @@ int OSDText::init(bool use_hdpi) {
   program = compile_shaders();
   if(program) {
       attribute_coord = get_attribu ( program, "coord" );
+      attribute_color = get_attribu ( program, "color" );
       uniform_tex     = get_uniform ( program, "tex"   );
-      uniform_color   = get_uniform ( program, "color" );
-      if (attribute_coord == -1 || uniform_tex == -1 || uniform_color == -1) {
+      if (attribute_coord == -1 || attribute_color == -1 || uniform_tex == -1) {
           return -1;
       }
   } else return -1;
 
-  // create the vbo
+  // create the vbo and the (empty) atlas
   glGenBuffers(1, &vbo);
+  glGenTextures(1, &atlas);
 
   return 0;
 }
 
 void OSDText::render() {
-  
-  glUseProgram(program);
 
+  // make sure every font size in use is in the atlas
   vector<OSDLine>::iterator it = lines.begin();
   while(it != lines.end()) {
-    draw_line(*it);
+    if (find_font(it->size) < 0) add_font(it->size);
     ++it;
   }
-  
-  glUseProgram(0);
+
+  // lay out the lines that changed
+  it = lines.begin();
+  while(it != lines.end()) {
+    if (it->dirty) {
+      layout_line(*it);
+      lines_changed = true;
+    }
+    ++it;
+  }
+
+  // gather all lines into the vbo
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  if (lines_changed) {
+    vector<GLfloat> vertices;
+    for (it = lines.begin(); it != lines.end(); ++it) {
+      vertices.insert(vertices.end(), it->vertices.begin(), it->vertices.end());
+    }
+    vertex_count = vertices.size() / vertex_size;
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat),
+                 vertices.empty() ? NULL : &vertices[0], GL_DYNAMIC_DRAW);
+    lines_changed = false;
+  }
+
+  // draw every glyph at once
+  if (vertex_count > 0) {
+    glUseProgram(program);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+    glUniform1i(uniform_tex, 0);
+
+    glEnableVertexAttribArray(attribute_coord);
+    glEnableVertexAttribArray(attribute_color);
+    glVertexAttribPointer(attribute_coord, 4, GL_FLOAT, GL_FALSE,
+                          vertex_size * sizeof(GLfloat), 0);
+    glVertexAttribPointer(attribute_color, 4, GL_FLOAT, GL_FALSE,
+                          vertex_size * sizeof(GLfloat),
+                          (const GLvoid*) (4 * sizeof(GLfloat)));
+
+    glDrawArrays(GL_TRIANGLES, 0, vertex_count);
+
+    glDisableVertexAttribArray(attribute_coord);
+    glDisableVertexAttribArray(attribute_color);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+  }
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
 void OSDText::resize(size_t w, size_t h) {
     sx = 2.0f / w;
     sy = 2.0f / h;
+
+    // lines are laid out in screen space
+    vector<OSDLine>::iterator it = lines.begin();
+    while(it != lines.end()) {
+      it->dirty = true;
+      ++it;
+    }
 }
 
 
@@ -109,6 +174,7 @@ int OSDText::add_line(float x, float y, string text,
   new_line.text = text;
   new_line.size = size;
   new_line.color = color;
+  new_line.dirty = true;
 
   // handle HDPI display
   if (use_hdpi) new_line.size *= 2;
@@ -124,79 +190,138 @@ int OSDText::add_line(float x, float y, string text,
 }
 
 void OSDText::del_line(int line_id) {
-  vector<OSDLine>::iterator it = lines.begin();
-  while(it != lines.end()) {
-    if(it->id == line_id) { 
-      lines.erase(it);
-      break;
-    }
-    ++it;
+  vector<OSDLine>::iterator it = find_line(line_id);
+  if(it != lines.end()) {
+    lines.erase(it);
+    lines_changed = true;
   }
 }
 
 void OSDText::set_anchor(int line_id, float x, float y) {
-  vector<OSDLine>::iterator it = lines.begin();
-  while(it != lines.end()) {
-    if(it->id == line_id) { 
-      it->x = x;
-      it->y = y;
-      break;
-    }
-    ++it;
-  }  
+  vector<OSDLine>::iterator it = find_line(line_id);
+  if(it != lines.end() && (it->x != x || it->y != y)) {
+    it->x = x;
+    it->y = y;
+    it->dirty = true;
+  }
 }
 
 void OSDText::set_text(int line_id, string text) {
-  vector<OSDLine>::iterator it = lines.begin();
-  while(it != lines.end()) {
-    if(it->id == line_id) { 
-      it->text = text;
-      break;
-    }
-    ++it;
-  }  
+  vector<OSDLine>::iterator it = find_line(line_id);
+  if(it != lines.end() && it->text != text) {
+    it->text = text;
+    it->dirty = true;
+  }
 }
 
 void OSDText::set_size(int line_id, size_t size) {
-  vector<OSDLine>::iterator it = lines.begin();
-  while(it != lines.end()) {
-    if(it->id == line_id) { 
-      it->size = size;
-      break;
-    }
-    ++it;
+  if (use_hdpi) size *= 2;
+  vector<OSDLine>::iterator it = find_line(line_id);
+  if(it != lines.end() && it->size != size) {
+    it->size = size;
+    it->dirty = true;
   }
 }
 
 void OSDText::set_color(int line_id, Color color) {
+  vector<OSDLine>::iterator it = find_line(line_id);
+  if(it != lines.end() && it->color != color) {
+    it->color = color;
+    it->dirty = true;
+  }
+}
+
+vector<OSDLine>::iterator OSDText::find_line(int line_id) {
   vector<OSDLine>::iterator it = lines.begin();
-  while(it != lines.end()) {
-    if(it->id == line_id) {
-      it->color = color;
-      break;
-    }
-    ++it;
+  while(it != lines.end() && it->id != line_id) ++it;
+  return it;
+}
+
+int OSDText::find_font(size_t size) {
+  for (size_t i = 0; i < fonts.size(); i++) {
+    if (fonts[i].size == size) return i;
   }
+  return -1;
 }
 
-void OSDText::draw_line(OSDLine line) {
+void OSDText::add_font(size_t size) {
 
-  // set font size
-  FT_Set_Pixel_Sizes(*face, 0, line.size);
+  OSDFont new_font;
+  new_font.size = size;
+  fonts.push_back(new_font);
 
-  // set font color
-  glUniform4fv(uniform_color, 1, (GLfloat*) &line.color);
+  // the texture coordinates of all glyphs may change
+  build_atlas();
+  vector<OSDLine>::iterator it = lines.begin();
+  while(it != lines.end()) {
+    it->dirty = true;
+    ++it;
+  }
+}
 
-  // get glyph
-  const char *p;
+void OSDText::build_atlas() {
+
+  // rasterize every glyph, and pack the bitmaps in rows ("shelves") from
+  // top to bottom, leaving a pixel between them so that linear filtering
+  // does not pick up neighbors
+  struct bitmap { size_t x, y, w, h; vector<unsigned char> pixels; };
+  vector<bitmap> bitmaps;
+  size_t x = 1, y = 1, row_height = 0;
   FT_GlyphSlot g = (*face)->glyph;
+  for (size_t i = 0; i < fonts.size(); i++) {
+    FT_Set_Pixel_Sizes(*face, 0, fonts[i].size);
+    fonts[i].glyphs.assign(last_char - first_char + 1, OSDGlyph());
+    for (char c = first_char; c <= last_char; c++) {
+      OSDGlyph& glyph = fonts[i].glyphs[c - first_char];
+      bitmap b; b.x = b.y = b.w = b.h = 0;
+      if (!FT_Load_Char(*face, c, FT_LOAD_RENDER)) {
+        glyph.left    = g->bitmap_left;
+        glyph.top     = g->bitmap_top;
+        glyph.advance = g->advance.x >> 6;
+        b.w = g->bitmap.width;
+        b.h = g->bitmap.rows;
+        for (size_t r = 0; r < b.h; r++) {
+          const unsigned char* row = g->bitmap.buffer + r * g->bitmap.pitch;
+          b.pixels.insert(b.pixels.end(), row, row + b.w);
+        }
+      }
+      glyph.width  = b.w;
+      glyph.height = b.h;
+
+      // start a new shelf when this one is full
+      if (x + b.w + 1 > atlas_width) {
+        x = 1;
+        y += row_height + 1;
+        row_height = 0;
+      }
+      b.x = x; b.y = y;
+      x += b.w + 1;
+      row_height = max(row_height, b.h);
+      bitmaps.push_back(b);
+    }
+  }
+  size_t atlas_height = y + row_height + 1;
+
+  // copy the bitmaps into the atlas
+  vector<unsigned char> pixels(atlas_width * atlas_height, 0);
+  size_t k = 0;
+  for (size_t i = 0; i < fonts.size(); i++) {
+    for (size_t j = 0; j < fonts[i].glyphs.size(); j++, k++) {
+      const bitmap& b = bitmaps[k];
+      for (size_t r = 0; r < b.h; r++) {
+        memcpy(&pixels[(b.y + r) * atlas_width + b.x], &b.pixels[r * b.w], b.w);
+      }
+      OSDGlyph& glyph = fonts[i].glyphs[j];
+      glyph.s0 = (float) b.x / atlas_width;
+      glyph.t0 = (float) b.y / atlas_height;
+      glyph.s1 = (float) (b.x + b.w) / atlas_width;
+      glyph.t1 = (float) (b.y + b.h) / atlas_height;
+    }
+  }
 
-  // gen texture
-  GLuint tex;
+  // upload the atlas as an alpha texture
   glActiveTexture(GL_TEXTURE0);
-  glGenTextures(1, &tex);
-  glBindTexture(GL_TEXTURE_2D, tex);
-  glUniform1i(uniform_tex, 0);
+  glBindTexture(GL_TEXTURE_2D, atlas);
 
   // require 1 byte alignment when uploading texture data 
   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
@@ -209,48 +334,50 @@ void OSDText::draw_line(OSDLine line) {
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-  // set up the VBO for our vertex data
-  glEnableVertexAttribArray(attribute_coord);
-  glBindBuffer(GL_ARRAY_BUFFER, vbo);
-  glVertexAttribPointer(attribute_coord, 4, GL_FLOAT, GL_FALSE, 0, 0);
+  glTexImage2D(GL_TEXTURE_2D, 
+               0, GL_ALPHA, atlas_width, atlas_height, 
+               0, GL_ALPHA, GL_UNSIGNED_BYTE, &pixels[0]);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void OSDText::layout_line(OSDLine& line) {
+
+  const OSDFont& font = fonts[find_font(line.size)];
+  const Color& c = line.color;
+
+  line.vertices.clear();
+  line.dirty = false;
 
   // loop through all characters
+  float x = line.x, y = line.y;
   const char* text = line.text.c_str();
-  for (p = text; *p; p++) {
+  for (const char* p = text; *p; p++) {
 
-    // Try to load and render the character
-    if (FT_Load_Char(*face, *p, FT_LOAD_RENDER)) continue;
-
-    // Upload the glyph bitmap as an alpha texture
-    glTexImage2D(GL_TEXTURE_2D, 
-                 0, GL_ALPHA, g->bitmap.width, g->bitmap.rows, 
-                 0, GL_ALPHA, GL_UNSIGNED_BYTE, g->bitmap.buffer);
+    // skip characters without a glyph
+    if (*p < first_char || *p > last_char) continue;
+    const OSDGlyph& g = font.glyphs[*p - first_char];
 
     // calculate the vertex and texture coordinates
-    float x2 =  line.x + g->bitmap_left * sx;
-    float y2 = -line.y - g->bitmap_top  * sy;
-    float w = g->bitmap.width * sx;
-    float h = g->bitmap.rows  * sy;
-
-    point box[4] = {
-      {x2, -y2, 0, 0},
-      {x2 + w, -y2, 1, 0},
-      {x2, -y2 - h, 0, 1},
-      {x2 + w, -y2 - h, 1, 1},
-    };
-
-    // draw the character to screen 
-    glBufferData(GL_ARRAY_BUFFER, sizeof box, box, GL_DYNAMIC_DRAW);
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    float x2 = x + g.left * sx;
+    float y2 = y + g.top  * sy;
+    float w = g.width  * sx;
+    float h = g.height * sy;
+
+    if (g.width > 0 && g.height > 0) {
+      GLfloat box[6][vertex_size] = {
+        {x2,     y2,     g.s0, g.t0, c.r, c.g, c.b, c.a},
+        {x2 + w, y2,     g.s1, g.t0, c.r, c.g, c.b, c.a},
+        {x2,     y2 - h, g.s0, g.t1, c.r, c.g, c.b, c.a},
+        {x2 + w, y2,     g.s1, g.t0, c.r, c.g, c.b, c.a},
+        {x2,     y2 - h, g.s0, g.t1, c.r, c.g, c.b, c.a},
+        {x2 + w, y2 - h, g.s1, g.t1, c.r, c.g, c.b, c.a},
+      };
+      line.vertices.insert(line.vertices.end(), &box[0][0], &box[0][0] + 6 * vertex_size);
+    }
 
     // Advance the cursor to the start of the next character
-    line.x += (g->advance.x >> 6) * sx;
-    line.y += (g->advance.y >> 6) * sy;
+    x += g.advance * sx;
   }
-
-  glDisableVertexAttribArray(attribute_coord);
-  glDeleteTextures(1, &tex);
-
 }
 
 GLuint OSDText::compile_shaders() {
@@ -261,18 +388,21 @@ GLuint OSDText::compile_shaders() {
 
   const char *vert_shader_src = "#version 120"
   "\nattribute vec4 coord;"
+  "\nattribute vec4 color;"
   "\nvarying vec2 texpos;"
+  "\nvarying vec4 texcolor;"
   "\nvoid main(void) {"
   "\n  gl_Position = vec4(coord.xy, 0, 1);"
   "\n  texpos = coord.zw;"
+  "\n  texcolor = color;"
   "\n}";
 
   const char *frag_shader_src = "#version 120"
   "\nvarying vec2 texpos;"
+  "\nvarying vec4 texcolor;"
   "\nuniform sampler2D tex;"
-  "\nuniform vec4 color;"
   "\nvoid main(void) {"
-  "\n  gl_FragColor = vec4(1, 1, 1, texture2D(tex, texpos).a) * color;"
+  "\n  gl_FragColor = vec4(1, 1, 1, texture2D(tex, texpos).a) * texcolor;"
   "\n}";
 
 // with drop shadow
@@ -0,0 +1,72 @@
+#include "profiler.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace CMU462 {
+
+vector<string> Profiler::names;
+vector<double> Profiler::current;
+vector<double> Profiler::frame_times( Profiler::history, 0. );
+vector<vector<double> > Profiler::stage_times;
+size_t Profiler::next_frame = 0;
+size_t Profiler::frames = 0;
+
+size_t Profiler::stage( const string& name ) {
+
+  for( size_t i = 0; i < names.size(); i++ ) {
+    if( names[i] == name ) return i;
+  }
+
+  names.push_back( name );
+  current.push_back( 0. );
+  stage_times.push_back( vector<double>( history, 0. ) );
+  return names.size() - 1;
+}
+
+void Profiler::add( size_t stage, double seconds ) {
+  current[stage] += seconds;
+}
+
+void Profiler::end_frame( double seconds ) {
+
+  frame_times[next_frame] = seconds;
+  for( size_t i = 0; i < names.size(); i++ ) {
+    stage_times[i][next_frame] = current[i];
+    current[i] = 0.;
+  }
+
+  next_frame = ( next_frame + 1 ) % history;
+  frames = min( frames + 1, history );
+}
+
+double Profiler::frame_time( size_t age ) {
+  return frame_times[( next_frame + history - 1 - age ) % history];
+}
+
+double Profiler::stage_average( size_t stage ) {
+
+  if( frames == 0 ) return 0.;
+
+  // (stages added later count as 0 in earlier frames)
+  double sum = 0.;
+  for( size_t age = 0; age < frames; age++ ) {
+    sum += stage_times[stage][( next_frame + history - 1 - age ) % history];
+  }
+  return sum / frames;
+}
+
+double Profiler::frame_percentile( double p ) {
+
+  if( frames == 0 ) return 0.;
+
+  vector<double> times( frames );
+  for( size_t age = 0; age < frames; age++ ) times[age] = frame_time( age );
+
+  size_t k = min( frames - 1, (size_t) ( p * frames ) );
+  nth_element( times.begin(), times.begin() + k, times.end() );
+  return times[k];
+}
+
+} // namespace CMU462
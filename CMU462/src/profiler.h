@@ -0,0 +1,124 @@
+#ifndef CMU462_PROFILER_H
+#define CMU462_PROFILER_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "trace.h"
+
+namespace CMU462 {
+
+/**
+ * Collects the CPU time spent in named stages of each frame, over the last
+ * few frames. Stages are timed with ScopedTimer (or PROFILE_SCOPE), from the
+ * thread that draws; the viewer ends every frame and shows the results in
+ * an overlay (toggled with F1).
+ */
+class Profiler {
+ public:
+
+  /**
+   * Number of frames kept.
+   */
+  static const size_t history = 240;
+
+  /**
+   * Returns the index of the stage with the given name, adding it if needed.
+   */
+  static size_t stage( const std::string& name );
+
+  /**
+   * Adds time to a stage of the current frame.
+   * \param stage The index of the stage (see stage()).
+   * \param seconds The time to add.
+   */
+  static void add( size_t stage, double seconds );
+
+  /**
+   * Records the current frame and starts a new one.
+   * \param seconds The time taken by the whole frame.
+   */
+  static void end_frame( double seconds );
+
+  /**
+   * Number of stages, and their names.
+   */
+  static size_t num_stages( void ) { return names.size(); }
+  static const std::string& stage_name( size_t stage ) { return names[stage]; }
+
+  /**
+   * Number of frames recorded (at most history).
+   */
+  static size_t num_frames( void ) { return frames; }
+
+  /**
+   * Time taken by a recent frame, in seconds.
+   * \param age 0 for the last frame recorded, 1 for the one before, etc.
+   */
+  static double frame_time( size_t age );
+
+  /**
+   * Average time spent in a stage per frame, over the recorded frames.
+   */
+  static double stage_average( size_t stage );
+
+  /**
+   * Percentile of the recorded frame times (e.g., .5 for the median).
+   */
+  static double frame_percentile( double p );
+
+ private:
+
+  // stage names
+  static std::vector<std::string> names;
+
+  // stage times of the current frame
+  static std::vector<double> current;
+
+  // times of the recorded frames, and of their stages (one ring buffer of
+  // the same length per stage), indexed by frame number modulo history
+  static std::vector<double> frame_times;
+  static std::vector<std::vector<double> > stage_times;
+  static size_t next_frame;
+  static size_t frames;
+
+}; // class Profiler
+
+/**
+ * Adds the time from its construction to its destruction to a stage of the
+ * current frame (and records it in the trace, if one is being recorded).
+ * The name must outlive the timer (e.g., a string literal).
+ */
+class ScopedTimer {
+ public:
+
+  ScopedTimer( size_t stage, const char* name )
+  : stage( stage ), name( name ), start( std::chrono::steady_clock::now() ) { }
+
+  ~ScopedTimer( void ) {
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    Profiler::add( stage, std::chrono::duration<double>( end - start ).count() );
+    if( Trace::active() ) Trace::record( name, start, end );
+  }
+
+ private:
+  size_t stage;
+  const char* name;
+  std::chrono::steady_clock::time_point start;
+
+}; // class ScopedTimer
+
+} // namespace CMU462
+
+/**
+ * Times the rest of the enclosing scope as the stage with the given name
+ * (a string literal, which is only looked up the first time).
+ */
+#define PROFILE_SCOPE(name) PROFILE_SCOPE_LINE(name, __LINE__)
+#define PROFILE_SCOPE_LINE(name, line) PROFILE_SCOPE_NAMED(name, line)
+#define PROFILE_SCOPE_NAMED(name, line) \
+  static const size_t profile_stage_##line = CMU462::Profiler::stage(name); \
+  CMU462::ScopedTimer profile_timer_##line( profile_stage_##line, name )
+
+#endif // CMU462_PROFILER_H
@@ -0,0 +1,108 @@
+#include "trace.h"
+
+#include <fstream>
+
+using namespace std;
+using namespace chrono;
+
+namespace CMU462 {
+
+atomic<bool> Trace::recording( false );
+mutex Trace::lock;
+steady_clock::time_point Trace::epoch;
+vector<Trace::Event> Trace::events;
+size_t Trace::next_event = 0;
+size_t Trace::num_events = 0;
+map<thread::id, int> Trace::threads;
+map<int, string> Trace::thread_names;
+
+// escapes a string for JSON
+static string quote( const string& s ) {
+  string q = "\"";
+  for( size_t i = 0; i < s.size(); i++ ) {
+    char c = s[i];
+    if( c == '"' || c == '\\' ) { q += '\\'; q += c; }
+    else if( (unsigned char) c < 0x20 ) q += ' ';
+    else q += c;
+  }
+  return q + "\"";
+}
+
+void Trace::start( void ) {
+
+  lock_guard<mutex> guard( lock );
+  events.assign( capacity, Event() );
+  next_event = 0;
+  num_events = 0;
+  epoch = steady_clock::now();
+  recording = true;
+}
+
+void Trace::stop( void ) {
+  recording = false;
+}
+
+void Trace::record( const char* name, steady_clock::time_point begin,
+                                      steady_clock::time_point end ) {
+
+  lock_guard<mutex> guard( lock );
+  if( !recording ) return;
+
+  Event& e = events[next_event];
+  e.name = name;
+  e.begin    = duration<double, micro>( begin - epoch ).count();
+  e.duration = duration<double, micro>( end - begin ).count();
+  e.thread = thread_number();
+
+  next_event = ( next_event + 1 ) % capacity;
+  if( num_events < capacity ) num_events++;
+}
+
+void Trace::name_thread( const string& name ) {
+
+  lock_guard<mutex> guard( lock );
+  thread_names[ thread_number() ] = name;
+}
+
+int Trace::thread_number( void ) {
+
+  thread::id id = this_thread::get_id();
+  map<thread::id, int>::iterator t = threads.find( id );
+  if( t != threads.end() ) return t->second;
+
+  int n = threads.size() + 1;
+  threads[id] = n;
+  return n;
+}
+
+int Trace::save( const string& filename ) {
+
+  ofstream out( filename.c_str() );
+  if( !out.is_open() ) return -1;
+
+  lock_guard<mutex> guard( lock );
+
+  // complete ("X") events, oldest first, then the thread names
+  out << "{\"traceEvents\":[\n";
+  out.setf( ios::fixed );
+  out.precision( 3 );
+  bool first = true;
+  for( size_t i = 0; i < num_events; i++ ) {
+    const Event& e = events[( next_event + capacity - num_events + i ) % capacity];
+    out << ( first ? "" : ",\n" )
+        << "{\"name\":" << quote( e.name ) << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.thread
+        << ",\"ts\":" << e.begin << ",\"dur\":" << e.duration << "}";
+    first = false;
+  }
+  for( map<int, string>::iterator t = thread_names.begin(); t != thread_names.end(); t++ ) {
+    out << ( first ? "" : ",\n" )
+        << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t->first
+        << ",\"args\":{\"name\":" << quote( t->second ) << "}}";
+    first = false;
+  }
+  out << "\n]}\n";
+
+  return out.good() ? 0 : -1;
+}
+
+} // namespace CMU462
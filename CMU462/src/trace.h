@@ -0,0 +1,119 @@
+#ifndef CMU462_TRACE_H
+#define CMU462_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace CMU462 {
+
+/**
+ * Records timed scopes from any thread into a ring buffer, and saves them
+ * in the Chrome trace event format (which chrome://tracing and Perfetto
+ * can open). Scopes are timed with TraceScope (or TRACE_SCOPE), and the
+ * profiler stages (see PROFILE_SCOPE) are recorded as well. While not
+ * recording, a scope costs a single test of active(). The viewer starts
+ * and saves a trace with F2, and saves any trace in progress on exit.
+ */
+class Trace {
+ public:
+
+  /**
+   * Number of scopes kept (the oldest ones are dropped first).
+   */
+  static const size_t capacity = 1 << 16;
+
+  /**
+   * Is a trace being recorded?
+   */
+  static bool active( void ) { return recording.load( std::memory_order_relaxed ); }
+
+  /**
+   * Start recording a new trace (dropping any earlier one), or stop.
+   */
+  static void start( void );
+  static void stop( void );
+
+  /**
+   * Record a scope of the calling thread. Does nothing if not active().
+   */
+  static void record( const char* name,
+                      std::chrono::steady_clock::time_point begin,
+                      std::chrono::steady_clock::time_point end );
+
+  /**
+   * Name the calling thread in the traces.
+   */
+  static void name_thread( const std::string& name );
+
+  /**
+   * Write the scopes recorded so far to a JSON file.
+   * \return 0 if successful, -1 on error.
+   */
+  static int save( const std::string& filename );
+
+ private:
+
+  struct Event {
+    std::string name;
+    double begin, duration; // in microseconds since the start of the trace
+    int thread;
+  };
+
+  // number of the calling thread (from 1, in order of first use), which
+  // must be called with the lock held
+  static int thread_number( void );
+
+  static std::atomic<bool> recording;
+  static std::mutex lock;
+  static std::chrono::steady_clock::time_point epoch;
+
+  // ring buffer of events
+  static std::vector<Event> events;
+  static size_t next_event;
+  static size_t num_events;
+
+  // threads seen so far
+  static std::map<std::thread::id, int> threads;
+  static std::map<int, std::string> thread_names;
+
+}; // class Trace
+
+/**
+ * Records the time from its construction to its destruction as a scope of
+ * the trace, if one is being recorded. The name must outlive the scope
+ * (e.g., a string literal).
+ */
+class TraceScope {
+ public:
+
+  TraceScope( const char* name ) : name( name ) {
+    if( Trace::active() ) begin = std::chrono::steady_clock::now();
+    else this->name = NULL;
+  }
+
+  ~TraceScope( void ) {
+    if( name ) Trace::record( name, begin, std::chrono::steady_clock::now() );
+  }
+
+ private:
+  const char* name;
+  std::chrono::steady_clock::time_point begin;
+
+}; // class TraceScope
+
+} // namespace CMU462
+
+/**
+ * Records the rest of the enclosing scope in the trace, under the given name.
+ */
+#define TRACE_SCOPE(name) TRACE_SCOPE_LINE(name, __LINE__)
+#define TRACE_SCOPE_LINE(name, line) TRACE_SCOPE_NAMED(name, line)
+#define TRACE_SCOPE_NAMED(name, line) \
+  CMU462::TraceScope trace_scope_##line( name )
+
+#endif // CMU462_TRACE_H
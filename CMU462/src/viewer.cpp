@@ -4,6 +4,7 @@
 #include <cmath>
 #include <vector>
 #include <iostream>
+#include <sstream>
 #include <algorithm>
 
 #include "GL/glew.h"
@@ -28,6 +29,15 @@ time_point<system_clock> Viewer::sys_curr;
 
 // draw toggles
 bool Viewer::showInfo = true;
+bool Viewer::showProfiler = false;
+
+// frame scheduling
+bool Viewer::eventDriven = true;
+atomic<bool> Viewer::frameRequested( true );
+void (*Renderer::frame_requester)( void ) = NULL;
+
+// renderer info
+string Viewer::rendererInfo;
 
 // window properties
 GLFWwindow* Viewer::window;
@@ -41,6 +51,7 @@ Renderer* Viewer::renderer;
 OSDText* Viewer::osd_text;
 int Viewer::line_id_renderer;
 int Viewer::line_id_framerate;
+vector<int> Viewer::line_id_profiler;
 
 Viewer::Viewer() {
 
@@ -48,6 +59,9 @@ Viewer::Viewer() {
 
 Viewer::~Viewer() {
 
+  // save the trace in progress, if any
+  if( Trace::active() ) save_trace();
+
   glfwDestroyWindow(window);
   glfwTerminate();
   
@@ -95,6 +109,15 @@ void Viewer::init() {
   glfwSetInputMode(window, GLFW_STICKY_MOUSE_BUTTONS, 1);
   glfwSetMouseButtonCallback(window, mouse_button_callback);
 
+  // redraw when the window contents are damaged (e.g., uncovered)
+  glfwSetWindowRefreshCallback( window, refresh_callback );
+
+  // redraw when the renderer asks for it
+  Renderer::frame_requester = request_frame;
+
+  // name the drawing thread in traces
+  Trace::name_thread( "main" );
+
   // initialize glew
   if (glewInit() != GLEW_OK) {
     out_err("Error: could not initialize GLEW!");
@@ -150,6 +173,18 @@ void Viewer::set_renderer(Renderer *renderer) {
 }
 
 void Viewer::update() {
+
+  // when drawing on demand, sleep until something calls for a frame
+  // (the callbacks, request_frame(), or the renderer itself)
+  if( eventDriven && !frameRequested && !( renderer && renderer->wants_frame() ) ) {
+    glfwWaitEvents();
+    return;
+  }
+  frameRequested = false;
+
+  // time the whole frame, for the profiler
+  steady_clock::time_point frame_start = steady_clock::now();
+  TRACE_SCOPE("frame");
   
   // clear frame
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -165,10 +200,16 @@ void Viewer::update() {
   } 
 
   // swap buffers
-  glfwSwapBuffers(window); 
+  {
+    PROFILE_SCOPE("glfwSwapBuffers");
+    glfwSwapBuffers(window); 
+  }
 
   // poll events
   glfwPollEvents();
+
+  duration<double> frame_time = steady_clock::now() - frame_start;
+  Profiler::end_frame( frame_time.count() );
 }
 
 
@@ -183,6 +224,7 @@ void Viewer::drawInfo() {
     Color c = framecount < 20 ? Color(1.0, 0.35, 0.35) : Color(0.15, 0.5, 0.15);
     osd_text->set_color(line_id_framerate, c);
     string framerate_info = "Framerate: " + to_string(framecount) + " fps";
+    if( eventDriven ) framerate_info += " (on demand)";
     osd_text->set_text(line_id_framerate, framerate_info);
 
     // reset timer and counter
@@ -196,16 +238,21 @@ void Viewer::drawInfo() {
   
   }
 
-  // udpate renderer OSD
-  // TODO: This is done on every update and it shouldn't be!
-  // The viewer should only update when the renderer needs to
-  // update the info text. 
-  if (renderer) {
-    string renderer_info = renderer->info();
-    osd_text->set_text(line_id_renderer, renderer_info);
-  } else {
-    string renderer_info = "No input renderer";
+  // udpate renderer OSD, only when the text changes
+  string renderer_info = renderer ? renderer->info() : "No input renderer";
+  if( renderer_info != rendererInfo ) {
     osd_text->set_text(line_id_renderer, renderer_info);
+    rendererInfo = renderer_info;
+  }
+
+  // update profiler overlay
+  if( showProfiler ) {
+    drawProfiler();
+  } else if( !line_id_profiler.empty() ) {
+    for( size_t i = 0; i < line_id_profiler.size(); i++ ) {
+      osd_text->del_line(line_id_profiler[i]);
+    }
+    line_id_profiler.clear();
   }
 
   // render OSD
@@ -213,17 +260,139 @@ void Viewer::drawInfo() {
 
 }
 
+void Viewer::drawProfiler() {
+
+  // the graph has one column per frame, and 2 pixels per millisecond, in
+  // the bottom left corner (above the framerate)
+  float scale = HDPI ? 2 : 1;
+  float sx = 2.0 / buffer_w, sy = 2.0 / buffer_h;
+  float x0 = -0.98, y0 = -0.90;
+  float w = Profiler::history * scale * sx;
+  float ms = 2 * scale * sy;
+  float max_ms = 50;
+
+  glPushAttrib( GL_ENABLE_BIT | GL_CURRENT_BIT | GL_LINE_BIT );
+  glDisable( GL_DEPTH_TEST );
+  glDisable( GL_LIGHTING );
+  glDisable( GL_TEXTURE_2D );
+  glEnable( GL_BLEND );
+
+  glMatrixMode( GL_PROJECTION );
+  glPushMatrix();
+  glLoadIdentity();
+  glMatrixMode( GL_MODELVIEW );
+  glPushMatrix();
+  glLoadIdentity();
+
+  // background
+  glColor4f( 0.0, 0.0, 0.0, 0.6 );
+  glBegin( GL_QUADS );
+  glVertex2f( x0,     y0 );
+  glVertex2f( x0 + w, y0 );
+  glVertex2f( x0 + w, y0 + max_ms * ms );
+  glVertex2f( x0,     y0 + max_ms * ms );
+  glEnd();
+
+  // one bar per frame, latest on the right, red if it missed 60Hz
+  glLineWidth( scale );
+  glBegin( GL_LINES );
+  for( size_t age = 0; age < Profiler::num_frames(); age++ ) {
+    float t = 1000 * Profiler::frame_time( age );
+    float x = x0 + w - ( age + 0.5 ) * scale * sx;
+    if( t > 1000.0 / 60 ) glColor4f( 1.0, 0.35, 0.35, 0.9 );
+    else                  glColor4f( 0.35, 0.8, 0.35, 0.9 );
+    glVertex2f( x, y0 );
+    glVertex2f( x, y0 + min( t, max_ms ) * ms );
+  }
+  glEnd();
+
+  // marks at 60Hz and 30Hz
+  glColor4f( 1.0, 1.0, 1.0, 0.5 );
+  glBegin( GL_LINES );
+  glVertex2f( x0,     y0 + 1000.0 / 60 * ms );
+  glVertex2f( x0 + w, y0 + 1000.0 / 60 * ms );
+  glVertex2f( x0,     y0 + 1000.0 / 30 * ms );
+  glVertex2f( x0 + w, y0 + 1000.0 / 30 * ms );
+  glEnd();
+
+  glMatrixMode( GL_PROJECTION );
+  glPopMatrix();
+  glMatrixMode( GL_MODELVIEW );
+  glPopMatrix();
+  glPopAttrib();
+
+  // text above the graph: frame time percentiles, then the stages
+  vector<string> text;
+  ostringstream frame;
+  frame.setf( ios::fixed );
+  frame.precision( 2 );
+  frame << "Frame: p50 " << 1000 * Profiler::frame_percentile( 0.5 )
+        << " ms, p99 " << 1000 * Profiler::frame_percentile( 0.99 )
+        << " ms (" << Profiler::num_frames() << " frames)";
+  text.push_back( frame.str() );
+  for( size_t i = 0; i < Profiler::num_stages(); i++ ) {
+    ostringstream stage;
+    stage.setf( ios::fixed );
+    stage.precision( 2 );
+    stage << "  " << Profiler::stage_name( i ) << ": "
+          << 1000 * Profiler::stage_average( i ) << " ms";
+    text.push_back( stage.str() );
+  }
+
+  float y = y0 + max_ms * ms + 8 * scale * sy;
+  float line_height = 18 * scale * sy;
+  for( size_t i = 0; i < text.size(); i++ ) {
+    float line_y = y + ( text.size() - 1 - i ) * line_height;
+    if( i < line_id_profiler.size() ) {
+      osd_text->set_anchor(line_id_profiler[i], x0, line_y);
+      osd_text->set_text(line_id_profiler[i], text[i]);
+    } else {
+      line_id_profiler.push_back( osd_text->add_line(x0, line_y, text[i],
+                                  14, Color(0.8, 0.8, 0.8)) );
+    }
+  }
+}
+
+void Viewer::save_trace( void ) {
+
+  Trace::stop();
+  if( Trace::save( "trace.json" ) < 0 ) {
+    out_err("Error: could not write trace.json");
+  } else {
+    out_msg("Trace saved to trace.json");
+  }
+}
+
+void Viewer::request_frame( void ) {
+
+  // wake up the update loop if it is waiting for events
+  frameRequested = true;
+  glfwPostEmptyEvent();
+}
+
 void Viewer::err_callback( int error, const char* description ) {
     out_err( "GLFW Error: " << description );
 }
 
 void Viewer::key_callback( GLFWwindow* window, 
                            int key, int scancode, int action, int mods ) {
+  frameRequested = true;
   if( action == GLFW_PRESS ) {
     if( key == GLFW_KEY_ESCAPE ) { 
       glfwSetWindowShouldClose( window, true ); 
     } else if( key == GLFW_KEY_GRAVE_ACCENT ) { 
       showInfo = !showInfo; 
+    } else if( key == GLFW_KEY_F1 ) { 
+      showProfiler = !showProfiler; 
+    } else if( key == GLFW_KEY_F2 ) { 
+      if( Trace::active() ) {
+        save_trace();
+      } else {
+        Trace::start();
+        out_msg("Recording a trace (press F2 again to save it)");
+      }
+    } else if( key == GLFW_KEY_F3 ) { 
+      eventDriven = !eventDriven; 
     } else {
       renderer->key_event(key);
     }
@@ -232,6 +401,8 @@ void Viewer::key_callback( GLFWwindow* window,
 
 void Viewer::resize_callback( GLFWwindow* window, int width, int height ) {
 
+  frameRequested = true;
+
   // get framebuffer size
   int w, h; 
   glfwGetFramebufferSize(window, &w, &h );
@@ -247,8 +418,16 @@ void Viewer::resize_callback( GLFWwindow* window, int width, int height ) {
   if (renderer) renderer->resize( buffer_w, buffer_h );  
 }
 
+void Viewer::refresh_callback( GLFWwindow* window ) {
+
+  frameRequested = true;
+
+}
+
 void Viewer::cursor_callback( GLFWwindow* window, double xpos, double ypos ) {
 
+  frameRequested = true;
+
   // get keydown bitmask
   unsigned char keys;
   keys  |= (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT)   == GLFW_PRESS); 
@@ -272,12 +451,14 @@ void Viewer::cursor_callback( GLFWwindow* window, double xpos, double ypos ) {
 
 void Viewer::scroll_callback( GLFWwindow* window, double xoffset, double yoffset) {
 
+  frameRequested = true;
   renderer->scroll_event(xoffset, yoffset);
 
 }
 
 void Viewer::mouse_button_callback( GLFWwindow* window, int button, int action, int mods ) {
 
+  frameRequested = true;
   renderer->mouse_button_event( button, action );
 
 }
@@ -0,0 +1,196 @@
+#include "aabbTree.h"
+
+#include <algorithm>
+
+namespace CMU462
+{
+   // Largest number of triangles stored in a leaf.
+   static const Size maxLeafSize = 4;
+
+   void AABBTree::build( const HalfedgeMesh& mesh )
+   {
+      triangles.clear();
+      nodes.clear();
+
+      for( FaceCIter f = mesh.facesBegin(); f != mesh.facesEnd(); f++ )
+      {
+         // Triangulate each face as a fan around its first vertex.
+         HalfedgeCIter h0 = f->halfedge();
+         HalfedgeCIter h = h0->next();
+         while( h->next() != h0 )
+         {
+            Triangle t;
+            t.p[0] = h0->vertex()->position;
+            t.p[1] = h->vertex()->position;
+            t.p[2] = h->next()->vertex()->position;
+            triangles.push_back( t );
+
+            h = h->next();
+         }
+      }
+
+      if( triangles.empty() ) return;
+
+      vector<Vector3D> centroids( triangles.size() );
+      for( Index i = 0; i < triangles.size(); i++ )
+      {
+         centroids[i] = ( triangles[i].p[0] + triangles[i].p[1] + triangles[i].p[2] ) / 3.;
+      }
+
+      nodes.reserve( 2 * triangles.size() / maxLeafSize + 1 );
+      buildNode( 0, triangles.size(), centroids );
+   }
+
+   Index AABBTree::buildNode( Index start, Index end, vector<Vector3D>& centroids )
+   {
+      Index n = nodes.size();
+      nodes.push_back( Node() );
+
+      BBox box, centroidBox;
+      for( Index i = start; i < end; i++ )
+      {
+         for( int j = 0; j < 3; j++ ) box.expand( triangles[i].p[j] );
+         centroidBox.expand( centroids[i] );
+      }
+      nodes[n].box = box;
+
+      if( end - start <= maxLeafSize )
+      {
+         nodes[n].start = start;
+         nodes[n].count = end - start;
+         nodes[n].right = 0;
+         return n;
+      }
+
+      // Split at the median centroid along the longest axis of the centroids'
+      // bounds; this keeps the tree balanced no matter how the triangles are
+      // distributed.  The triangles and their centroids are permuted together.
+      int axis = centroidBox.longestAxis();
+      Index mid = ( start + end ) / 2;
+
+      vector<Index> order( end - start );
+      for( Index i = 0; i < order.size(); i++ ) order[i] = start + i;
+      nth_element( order.begin(), order.begin() + ( mid - start ), order.end(),
+                   [&]( Index a, Index b ) { return centroids[a][axis] < centroids[b][axis]; } );
+
+      vector<Triangle> t( end - start );
+      vector<Vector3D> c( end - start );
+      for( Index i = 0; i < order.size(); i++ )
+      {
+         t[i] = triangles[ order[i] ];
+         c[i] = centroids[ order[i] ];
+      }
+      copy( t.begin(), t.end(), triangles.begin() + start );
+      copy( c.begin(), c.end(), centroids.begin() + start );
+
+      nodes[n].count = 0;
+      buildNode( start, mid, centroids );
+      Index right = buildNode( mid, end, centroids );
+      nodes[n].right = right;
+
+      return n;
+   }
+
+   Vector3D AABBTree::closestPoint( const Vector3D& p ) const
+   {
+      if( nodes.empty() ) return p;
+
+      Vector3D closest = p;
+      double best = numeric_limits<double>::max();
+
+      // Depth-first traversal, visiting the nearer child first and skipping
+      // any node whose box is farther away than the best point found so far.
+      Index stack[64];
+      int top = 0;
+      stack[top++] = 0;
+
+      while( top > 0 )
+      {
+         const Node& node = nodes[ stack[--top] ];
+         if( node.box.distance2( p ) >= best ) continue;
+
+         if( node.count > 0 )
+         {
+            for( Index i = node.start; i < node.start + node.count; i++ )
+            {
+               const Triangle& t = triangles[i];
+               Vector3D q = closestPointOnTriangle( p, t.p[0], t.p[1], t.p[2] );
+               double d2 = ( q - p ).norm2();
+               if( d2 < best )
+               {
+                  best = d2;
+                  closest = q;
+               }
+            }
+            continue;
+         }
+
+         Index left = &node - &nodes[0] + 1;
+         Index right = node.right;
+         double dLeft = nodes[left].box.distance2( p );
+         double dRight = nodes[right].box.distance2( p );
+
+         // Push the farther child first, so that the nearer one is popped next.
+         if( dLeft <= dRight )
+         {
+            if( dRight < best ) stack[top++] = right;
+            if( dLeft  < best ) stack[top++] = left;
+         }
+         else
+         {
+            if( dLeft  < best ) stack[top++] = left;
+            if( dRight < best ) stack[top++] = right;
+         }
+      }
+
+      return closest;
+   }
+
+   Vector3D closestPointOnTriangle( const Vector3D& p, const Vector3D& a, const Vector3D& b, const Vector3D& c )
+   {
+      // Determine which Voronoi region of the triangle (vertex, edge, or
+      // face) contains p, using barycentric coordinates of its projection;
+      // see Ericson, "Real-Time Collision Detection," Section 5.1.5.
+      Vector3D ab = b - a;
+      Vector3D ac = c - a;
+      Vector3D ap = p - a;
+      double d1 = dot( ab, ap );
+      double d2 = dot( ac, ap );
+      if( d1 <= 0. && d2 <= 0. ) return a;
+
+      Vector3D bp = p - b;
+      double d3 = dot( ab, bp );
+      double d4 = dot( ac, bp );
+      if( d3 >= 0. && d4 <= d3 ) return b;
+
+      double vc = d1*d4 - d3*d2;
+      if( vc <= 0. && d1 >= 0. && d3 <= 0. )
+      {
+         return a + ( d1 / ( d1 - d3 ) ) * ab;
+      }
+
+      Vector3D cp = p - c;
+      double d5 = dot( ab, cp );
+      double d6 = dot( ac, cp );
+      if( d6 >= 0. && d5 <= d6 ) return c;
+
+      double vb = d5*d2 - d1*d6;
+      if( vb <= 0. && d2 >= 0. && d6 <= 0. )
+      {
+         return a + ( d2 / ( d2 - d6 ) ) * ac;
+      }
+
+      double va = d3*d6 - d5*d4;
+      if( va <= 0. && ( d4 - d3 ) >= 0. && ( d5 - d6 ) >= 0. )
+      {
+         return b + ( ( d4 - d3 ) / ( ( d4 - d3 ) + ( d5 - d6 ) ) ) * ( c - b );
+      }
+
+      double denom = va + vb + vc;
+      if( denom == 0. ) return a; // degenerate triangle
+      double v = vb / denom;
+      double w = vc / denom;
+      return a + v * ab + w * ac;
+   }
+
+} // namespace CMU462
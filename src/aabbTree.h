@@ -0,0 +1,76 @@
+/*
+ * Axis-aligned bounding box tree over a static set of triangles.
+ *
+ * An AABBTree stores its own (frozen) copy of the triangles it was built
+ * from, so it remains valid while the mesh it came from is being edited.
+ * This makes it suitable for, e.g., projecting the vertices of a mesh
+ * that is being remeshed back onto the original surface.
+ */
+
+#ifndef CMU462_AABBTREE_H
+#define CMU462_AABBTREE_H
+
+#include <vector>
+
+#include "halfEdgeMesh.h"
+#include "bbox.h"
+
+namespace CMU462
+{
+   class AABBTree
+   {
+      public:
+         AABBTree( void ) {}
+
+         /**
+          * Copies the faces of the given mesh (triangulating any polygons
+          * as fans) and builds a tree over them, replacing any previous
+          * contents.
+          */
+         void build( const HalfedgeMesh& mesh );
+
+         /**
+          * Returns the point on the stored triangles closest to p.  The
+          * query only reads the tree, so it can be called concurrently
+          * from any number of threads.  (If the tree is empty, p itself
+          * is returned.)
+          */
+         Vector3D closestPoint( const Vector3D& p ) const;
+
+         bool empty( void ) const { return triangles.empty(); }
+         Size nTriangles( void ) const { return triangles.size(); }
+
+      protected:
+         struct Triangle
+         {
+            Vector3D p[3];
+         };
+
+         /*
+          * Nodes are stored in depth-first order, so that the left child
+          * of an interior node immediately follows it; only the index of
+          * the right child is stored.  A leaf refers to a contiguous run
+          * of (reordered) triangles.
+          */
+         struct Node
+         {
+            BBox box;
+            Index start;  ///< first triangle (leaves only)
+            Index count;  ///< number of triangles; zero for interior nodes
+            Index right;  ///< right child (interior nodes only)
+         };
+
+         Index buildNode( Index start, Index end, vector<Vector3D>& centroids );
+
+         vector<Triangle> triangles;
+         vector<Node> nodes;
+   };
+
+   /**
+    * Returns the point on triangle abc closest to p.
+    */
+   Vector3D closestPointOnTriangle( const Vector3D& p, const Vector3D& a, const Vector3D& b, const Vector3D& c );
+
+} // namespace CMU462
+
+#endif // CMU462_AABBTREE_H
@@ -0,0 +1,82 @@
+#include "adaptiveRefiner.h"
+#include "meshOps.h"
+
+#include <limits>
+
+namespace CMU462
+{
+   Size AdaptiveRefiner::refine( HalfedgeMesh& mesh, double targetLength, Size faceBudget )
+   {
+      begin( mesh, targetLength, faceBudget );
+      while( !step( numeric_limits<Size>::max() ) );
+      return nSplits();
+   }
+
+   void AdaptiveRefiner::begin( HalfedgeMesh& _mesh, double _targetLength, Size _faceBudget )
+   {
+      mesh = &_mesh;
+      targetLength = _targetLength;
+      faceBudget = _faceBudget;
+      startFaces = mesh->nFaces();
+      splits = 0;
+
+      queue.clear();
+      for( EdgeIter e = mesh->edgesBegin(); e != mesh->edgesEnd(); e++ )
+      {
+         if( e->length() > targetLength )
+         {
+            queue.insert( SplitRecord( e ) );
+         }
+      }
+   }
+
+   bool AdaptiveRefiner::step( Size maxEdges )
+   {
+      for( Size n = 0; n < maxEdges && !queue.empty() && mesh->nFaces() < faceBudget; n++ )
+      {
+         SplitRecord r = queue.top();
+         queue.pop();
+         EdgeIter e = r.edge;
+
+         // Splitting an interior edge adds two faces, and splitting a boundary
+         // edge adds one.  If only one face is left in the budget, keep looking
+         // for a boundary edge, so that the budget can be met exactly.
+         Size newFaces = e->isBoundary() ? 1 : 2;
+         if( mesh->nFaces() + newFaces > faceBudget ) continue;
+         if( !canSplit( e ) ) continue;
+
+         VertexIter m = mesh->splitEdge( e );
+         splits++;
+
+         // Splitting only creates or shortens the edges around the new vertex
+         // (every other edge keeps its length, and hence its queue entry).
+         HalfedgeIter h = m->halfedge();
+         do
+         {
+            EdgeIter ei = h->edge();
+            if( ei->length() > targetLength )
+            {
+               queue.insert( SplitRecord( ei ) );
+            }
+            h = h->twin()->next();
+         }
+         while( h != m->halfedge() );
+      }
+
+      if( queue.empty() || mesh->nFaces() >= faceBudget )
+      {
+         queue.clear();
+         return true;
+      }
+
+      return false;
+   }
+
+   double AdaptiveRefiner::progress( void ) const
+   {
+      // Measured against the face budget, which is usually what runs out first.
+      if( faceBudget <= startFaces ) return 1.;
+      return min( 1., double( mesh->nFaces() - startFaces ) / double( faceBudget - startFaces ) );
+   }
+
+} // namespace CMU462
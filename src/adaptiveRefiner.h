@@ -0,0 +1,81 @@
+/*
+ * Longest-edge-first adaptive refinement.
+ *
+ * The AdaptiveRefiner repeatedly splits the longest edge of a triangle
+ * mesh, using a MutablePriorityQueue of edge lengths, until either every
+ * edge is at most a target length or the mesh reaches a face budget.
+ * Since the longest edge is always split first, stopping early (on the
+ * budget) leaves the most uniform mesh possible for that number of faces,
+ * and the cost is proportional to the number of splits actually performed
+ * (times the logarithm of the queue size).
+ */
+
+#ifndef CMU462_ADAPTIVEREFINER_H
+#define CMU462_ADAPTIVEREFINER_H
+
+#include "halfEdgeMesh.h"
+#include "mutablePriorityQueue.h"
+
+namespace CMU462
+{
+   /**
+    * A queued edge, ordered so that longer edges come first
+    * in a (minimum-) MutablePriorityQueue.
+    */
+   class SplitRecord
+   {
+      public:
+         SplitRecord( void ) {}
+         SplitRecord( EdgeIter _edge ) : edge( _edge ), score( -_edge->length() ) {}
+
+         EdgeIter edge;
+         double score; ///< negative edge length
+   };
+   inline bool operator<( const SplitRecord& r1, const SplitRecord& r2 )
+   {
+      if( r1.score != r2.score )
+      {
+         return (r1.score < r2.score);
+      }
+
+      EdgeIter e1 = r1.edge;
+      EdgeIter e2 = r2.edge;
+      return &*e1 < &*e2;
+   }
+
+   class AdaptiveRefiner
+   {
+      public:
+         AdaptiveRefiner( void ) : mesh( NULL ), targetLength( 0. ), faceBudget( 0 ), startFaces( 0 ), splits( 0 ) {}
+
+         /**
+          * Splits the longest edge of the mesh until no edge is longer than
+          * targetLength, or until the next split would push the number of
+          * faces past faceBudget.  Returns the number of splits performed.
+          */
+         Size refine( HalfedgeMesh& mesh, double targetLength, Size faceBudget );
+
+         /*
+          * Incremental interface, for refining a little at a time: begin()
+          * fills the queue, and each call to step() examines at most the
+          * given number of queued edges, returning true once refinement is
+          * done.  The mesh must not be modified by anyone else in between.
+          */
+         void begin( HalfedgeMesh& mesh, double targetLength, Size faceBudget );
+         bool step( Size maxEdges );
+         Size nSplits( void ) const { return splits; } ///< splits performed since begin()
+         double progress( void ) const;               ///< rough fraction of the work done, in [0,1]
+
+      protected:
+         HalfedgeMesh* mesh;
+         double targetLength;
+         Size faceBudget;
+         Size startFaces;
+         Size splits;
+
+         MutablePriorityQueue<SplitRecord> queue;
+   };
+
+} // namespace CMU462
+
+#endif // CMU462_ADAPTIVEREFINER_H
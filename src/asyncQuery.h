@@ -0,0 +1,192 @@
+/*
+ * Latest-wins evaluation of queries on a background thread.
+ *
+ * An AsyncQuery evaluates queries (e.g., "what is under the cursor?") on
+ * its own thread.  Queries are posted without waiting; if a new query is
+ * posted before the previous one was picked up by the thread, the old
+ * one is dropped (and counted as skipped), so the thread only ever works
+ * on the most recent query.  Results are collected with poll(), typically
+ * once per frame.
+ *
+ * The evaluation runs while holding dataMutex(), so whoever modifies the
+ * data that queries read must hold that mutex while doing so, and should
+ * call discard() before releasing it, so that no result computed from the
+ * old data is returned by poll().
+ *
+ * Typical use, from the render thread:
+ *
+ *    AsyncQuery<Cursor,Feature> picker( []( const Cursor& c, Feature& f ) { ... } );
+ *
+ *    // on every mouse move:
+ *    picker.post( cursor );
+ *
+ *    // every frame:
+ *    picker.poll( hoveredFeature );
+ *
+ *    // when editing:
+ *    {
+ *       lock_guard<mutex> lock( picker.dataMutex() );
+ *       ... modify the data ...
+ *       picker.discard();
+ *    }
+ */
+
+#ifndef CMU462_ASYNCQUERY_H
+#define CMU462_ASYNCQUERY_H
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "CMU462/trace.h"
+#include "halfEdgeMesh.h"
+
+namespace CMU462
+{
+   template<class Query, class Result>
+   class AsyncQuery
+   {
+      public:
+         AsyncQuery( const function<void(const Query&,Result&)>& _evaluate )
+         : evaluate( _evaluate ), stopping( false ), queryPending( false ), resultReady( false ),
+           nPosted( 0 ), nEvaluated( 0 ), nSkipped( 0 ), lastLatency( 0. ), meanLatency( 0. )
+         {}
+
+         ~AsyncQuery( void )
+         {
+            {
+               lock_guard<mutex> lock( state );
+               stopping = true;
+            }
+            wake.notify_one();
+            if( worker.joinable() ) worker.join();
+         }
+
+         /**
+          * Replaces any query that has not been started yet with the given
+          * one, and returns immediately.
+          */
+         void post( const Query& q )
+         {
+            {
+               lock_guard<mutex> lock( state );
+               if( queryPending ) nSkipped++;
+               query = q;
+               queryPending = true;
+               postTime = clock::now();
+               nPosted++;
+
+               // Start the thread on first use.
+               if( !worker.joinable() ) worker = thread( &AsyncQuery::run, this );
+            }
+            wake.notify_one();
+         }
+
+         /**
+          * If a result has been produced since the last call, copies it
+          * into r and returns true; otherwise returns false without waiting.
+          */
+         bool poll( Result& r )
+         {
+            lock_guard<mutex> lock( state );
+            if( !resultReady ) return false;
+            r = result;
+            resultReady = false;
+            return true;
+         }
+
+         /**
+          * Drops any result that has not been collected yet (call while
+          * holding dataMutex(), after modifying the data).
+          */
+         void discard( void )
+         {
+            lock_guard<mutex> lock( state );
+            resultReady = false;
+         }
+
+         mutex& dataMutex( void ) { return data; }
+
+         /**
+          * Sets a function to call (from the background thread) whenever a
+          * new result is ready, e.g., to wake up the render loop.  Must be
+          * set before the first query is posted.
+          */
+         void onReady( const function<void(void)>& f ) { ready = f; }
+
+         /*
+          * Statistics.  Latency is the time from posting a query until its
+          * result is ready, in seconds; the mean is a moving average.
+          */
+         Size queriesPosted( void )    { lock_guard<mutex> lock( state ); return nPosted;    }
+         Size queriesEvaluated( void ) { lock_guard<mutex> lock( state ); return nEvaluated; }
+         Size queriesSkipped( void )   { lock_guard<mutex> lock( state ); return nSkipped;   }
+         double latency( void )        { lock_guard<mutex> lock( state ); return lastLatency; }
+         double averageLatency( void ) { lock_guard<mutex> lock( state ); return meanLatency; }
+
+      protected:
+         typedef chrono::steady_clock clock;
+
+         void run( void )
+         {
+            Trace::name_thread( "AsyncQuery" );
+
+            while( true )
+            {
+               Query q;
+               clock::time_point posted;
+               {
+                  unique_lock<mutex> lock( state );
+                  wake.wait( lock, [this]() { return stopping || queryPending; } );
+                  if( stopping ) return;
+                  q = query;
+                  posted = postTime;
+                  queryPending = false;
+               }
+
+               {
+                  // Publish the result before releasing the data, so that
+                  // any later change to the data also discards this result.
+                  lock_guard<mutex> dataLock( data );
+                  Result r;
+                  evaluate( q, r );
+
+                  lock_guard<mutex> lock( state );
+                  result = r;
+                  resultReady = true;
+                  nEvaluated++;
+                  lastLatency = chrono::duration<double>( clock::now() - posted ).count();
+                  meanLatency = ( nEvaluated == 1 ) ? lastLatency : .9*meanLatency + .1*lastLatency;
+               }
+
+               if( ready ) ready();
+            }
+         }
+
+         function<void(const Query&,Result&)> evaluate;
+         function<void(void)> ready;
+
+         thread worker;
+         mutex data;  ///< held while evaluating a query
+         mutex state; ///< guards everything below
+         condition_variable wake;
+
+         bool stopping;
+         Query query;
+         bool queryPending;
+         clock::time_point postTime;
+         Result result;
+         bool resultReady;
+
+         Size nPosted;
+         Size nEvaluated;
+         Size nSkipped;
+         double lastLatency;
+         double meanLatency;
+   };
+
+} // namespace CMU462
+
+#endif // CMU462_ASYNCQUERY_H
@@ -0,0 +1,79 @@
+#include "bbox.h"
+
+#include <algorithm>
+
+namespace CMU462
+{
+   void BBox::expand( const Vector3D& p )
+   {
+      for( int k = 0; k < 3; k++ )
+      {
+         min[k] = std::min( min[k], p[k] );
+         max[k] = std::max( max[k], p[k] );
+      }
+   }
+
+   void BBox::expand( const BBox& b )
+   {
+      if( b.empty() ) return;
+
+      expand( b.min );
+      expand( b.max );
+   }
+
+   int BBox::longestAxis( void ) const
+   {
+      Vector3D extent = max - min;
+
+      if( extent.x >= extent.y && extent.x >= extent.z ) return 0;
+      if( extent.y >= extent.z ) return 1;
+      return 2;
+   }
+
+   double BBox::area( void ) const
+   {
+      if( empty() ) return 0.;
+
+      Vector3D extent = max - min;
+      return 2. * ( extent.x*extent.y + extent.y*extent.z + extent.z*extent.x );
+   }
+
+   bool BBox::operator==( const BBox& b ) const
+   {
+      for( int k = 0; k < 3; k++ )
+      {
+         if( min[k] != b.min[k] || max[k] != b.max[k] ) return false;
+      }
+      return true;
+   }
+
+   double BBox::distance2( const Vector3D& p ) const
+   {
+      double d2 = 0.;
+      for( int k = 0; k < 3; k++ )
+      {
+         double d = std::max( 0., std::max( min[k] - p[k], p[k] - max[k] ) );
+         d2 += d*d;
+      }
+      return d2;
+   }
+
+   bool BBox::intersect( const Vector3D& o, const Vector3D& invD, double tMin, double tMax, double& tEnter ) const
+   {
+      // Slab test: clip [tMin,tMax] against the slab of each axis in turn.
+      for( int k = 0; k < 3; k++ )
+      {
+         double t0 = ( min[k] - o[k] ) * invD[k];
+         double t1 = ( max[k] - o[k] ) * invD[k];
+         if( t0 > t1 ) std::swap( t0, t1 );
+
+         tMin = std::max( tMin, t0 );
+         tMax = std::min( tMax, t1 );
+         if( tMin > tMax ) return false;
+      }
+
+      tEnter = tMin;
+      return true;
+   }
+
+} // namespace CMU462
@@ -0,0 +1,51 @@
+/*
+ * Axis-aligned bounding boxes, shared by the spatial data structures
+ * (AABBTree, FaceBVH).
+ */
+
+#ifndef CMU462_BBOX_H
+#define CMU462_BBOX_H
+
+#include <limits>
+
+#include "CMU462/vector3D.h"
+
+using namespace std;
+
+namespace CMU462
+{
+   /**
+    * An axis-aligned box, stored as its two extreme corners.
+    */
+   class BBox
+   {
+      public:
+         BBox( void ) : min(  numeric_limits<double>::max(),  numeric_limits<double>::max(),  numeric_limits<double>::max() ),
+                        max( -numeric_limits<double>::max(), -numeric_limits<double>::max(), -numeric_limits<double>::max() ) {}
+
+         void expand( const Vector3D& p ); ///< grow the box to contain the given point
+         void expand( const BBox& b );     ///< grow the box to contain the given box
+         Vector3D centroid( void ) const { return ( min + max ) / 2.; }
+         int longestAxis( void ) const;    ///< 0, 1, or 2 for x, y, or z
+         double area( void ) const;        ///< surface area (zero for an empty box)
+         bool empty( void ) const { return min.x > max.x; } ///< true until something has been added to the box
+         double distance2( const Vector3D& p ) const; ///< squared distance from the given point to the box (zero inside)
+
+         /**
+          * Intersects the box with the ray o + t*d, for t in [tMin,tMax],
+          * given the componentwise inverse invD of the ray direction.  If
+          * the ray hits the box, returns true and sets tEnter to the first
+          * value of t inside the box.
+          */
+         bool intersect( const Vector3D& o, const Vector3D& invD, double tMin, double tMax, double& tEnter ) const;
+
+         bool operator==( const BBox& b ) const;
+         bool operator!=( const BBox& b ) const { return !( *this == b ); }
+
+         Vector3D min; ///< smallest corner
+         Vector3D max; ///< largest corner
+   };
+
+} // namespace CMU462
+
+#endif // CMU462_BBOX_H
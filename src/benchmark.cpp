@@ -0,0 +1,436 @@
+/*
+ * Microbenchmarks for the halfedge mesh (meshedit-bench).
+ *
+ * Times the basic mesh operations on each of the bundled models, and
+ * prints one line of CSV (or one JSON object) per model and benchmark,
+ * so that results can be compared across builds:
+ *
+ *    meshedit-bench                      # every model in dae/, as CSV
+ *    meshedit-bench --json -o bench.json --filter pick dae/cow.dae
+ *
+ * Generated meshes (see meshGenerators.h) can be measured as well, alone
+ * or as a series of sizes from 1K faces up to a given count:
+ *
+ *    meshedit-bench torus:1M --filter copy
+ *    meshedit-bench --series icosphere:10M --filter flip
+ *
+ * Each benchmark is repeated (on a fresh copy of the mesh, where it
+ * modifies the mesh) until it has run at least three times and for at
+ * least --min-time seconds, setup included; the minimum and median times are reported,
+ * along with the number of elements processed by one repetition and the
+ * resulting throughput (elements per second, from the median).
+ *
+ * Random choices use a fixed seed, so every run measures the same work.
+ */
+
+#include "CMU462/trace.h"
+
+#include "collada.h"
+#include "meshGenerators.h"
+#include "student_code.h"
+#include "faceBVH.h"
+#include "edgeBatch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+using namespace std;
+using namespace CMU462;
+
+#define msg(s) cerr << "[meshedit-bench] " << s << endl;
+
+// The models in dae/, from smallest to largest.
+static const char* models[] = { "cube", "quadball", "bean", "teapot", "cow", "beetle", "peter" };
+
+// Face counts of a scaling series of generated meshes.
+static const char* seriesSizes[] = { "1K", "10K", "100K", "1M", "10M", "50M" };
+
+// Seed of every random choice.
+static const unsigned seed = 462;
+
+// Written by the benchmarks, so that the compiler cannot drop their work.
+static volatile double sink;
+
+struct Result {
+  string model;
+  string benchmark;
+  Size elements;    // processed by one repetition
+  Size repetitions;
+  double min_ms;
+  double median_ms;
+};
+
+/**
+ * Runs a benchmark until it has been repeated at least three times and
+ * for at least minSeconds (counting the setup, so that a slow setup does
+ * not multiply the running time).  Before each repetition, setup() is
+ * called (untimed); run() does the timed work and returns the number of
+ * elements it processed.
+ */
+static Result measure( const string& model, const string& benchmark, double minSeconds,
+                       const function<void(void)>& setup, const function<Size(void)>& run ) {
+
+  Result result;
+  result.model = model;
+  result.benchmark = benchmark;
+  result.elements = 0;
+
+  vector<double> times;
+  chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+  while( times.size() < 3 ||
+         ( chrono::duration<double>( chrono::steady_clock::now() - begin ).count() < minSeconds && times.size() < 1000 ) ) {
+    setup();
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    result.elements = run();
+    times.push_back( chrono::duration<double, milli>( chrono::steady_clock::now() - start ).count() );
+  }
+
+  sort( times.begin(), times.end() );
+  result.repetitions = times.size();
+  result.min_ms = times.front();
+  result.median_ms = times[ times.size() / 2 ];
+  return result;
+}
+
+// Builds the halfedge mesh of the first polygon mesh in a file.
+static bool loadModel( const string& filename, vector< vector<Index> >& polygons, vector<Vector3D>& positions ) {
+
+  Scene scene;
+  if( ColladaParser::load( filename.c_str(), &scene ) < 0 ) return false;
+
+  for( size_t i = 0; i < scene.nodes.size(); i++ ) {
+    Instance* instance = scene.nodes[i].instance;
+    if( instance == NULL || instance->type != POLYMESH ) continue;
+
+    Polymesh* polymesh = static_cast<Polymesh*>( instance );
+    polygons.clear();
+    for( PolyListIter p = polymesh->polygons.begin(); p != polymesh->polygons.end(); p++ ) {
+      polygons.push_back( p->vertex_indices );
+    }
+    positions = polymesh->vertices;
+    return true;
+  }
+  return false;
+}
+
+// Picks a random set of legal edges whose neighborhoods do not overlap, so
+// that each one can be operated on regardless of what was done to the
+// others (as in EdgeBatch).
+static void randomEdges( HalfedgeMesh& mesh, EdgeBatch::Operation operation, vector<EdgeIter>& chosen ) {
+
+  vector<VertexIter> vertices;
+  vector<EdgeIter> edges;
+  indexVertices( mesh, vertices );
+  indexEdges( mesh, edges );
+
+  mt19937 random( seed );
+  uniform_real_distribution<float> uniform( 0.f, 1.f );
+  vector<float> score( edges.size() );
+  vector<char> legal( edges.size() );
+  VertexReservation reservation;
+  reservation.reset( vertices.size() );
+
+  vector<Index> region;
+  for( size_t i = 0; i < edges.size(); i++ ) {
+    score[i] = uniform( random );
+    switch( operation ) {
+      case EdgeBatch::FLIP:     legal[i] = canFlip    ( edges[i] ); break;
+      case EdgeBatch::SPLIT:    legal[i] = canSplit   ( edges[i] ); break;
+      case EdgeBatch::COLLAPSE: legal[i] = canCollapse( edges[i] ); break;
+    }
+    if( !legal[i] ) continue;
+
+    if( operation == EdgeBatch::COLLAPSE ) edgeNeighborhood( edges[i], region );
+    else                                   edgeQuad        ( edges[i], region );
+    reservation.reserve( region, VertexReservation::key( score[i], i ) );
+  }
+
+  chosen.clear();
+  for( size_t i = 0; i < edges.size(); i++ ) {
+    if( !legal[i] ) continue;
+
+    if( operation == EdgeBatch::COLLAPSE ) edgeNeighborhood( edges[i], region );
+    else                                   edgeQuad        ( edges[i], region );
+    if( reservation.holds( region, VertexReservation::key( score[i], i ) ) ) chosen.push_back( edges[i] );
+  }
+}
+
+// Runs every benchmark whose name contains filter on one model.
+static void benchmarkModel( const string& model, const vector< vector<Index> >& polygons,
+                            const vector<Vector3D>& positions, const string& filter,
+                            double minSeconds, vector<Result>& results ) {
+
+  HalfedgeMesh original;
+  original.build( polygons, positions );
+
+  HalfedgeMesh mesh;
+  vector<EdgeIter> edges;
+  MeshResampler resampler;
+  FaceBVH bvh;
+  auto none = [](){};
+  auto fresh = [&](){ mesh = original; };
+
+  struct Benchmark {
+    string name;
+    function<void(void)> setup;
+    function<Size(void)> run;
+  };
+  vector<Benchmark> benchmarks;
+
+  benchmarks.push_back( { "build", none, [&](){
+    mesh.build( polygons, positions );
+    return mesh.nFaces();
+  } } );
+
+  benchmarks.push_back( { "copy", none, [&](){
+    mesh = original;
+    return mesh.nFaces();
+  } } );
+
+  // Walk around every vertex, and compute every face normal.
+  benchmarks.push_back( { "traverse", none, [&](){
+    double s = 0.;
+    for( VertexCIter v = original.verticesBegin(); v != original.verticesEnd(); v++ ) {
+      HalfedgeCIter h = v->halfedge();
+      do {
+        s += h->twin()->vertex()->position.x;
+        h = h->twin()->next();
+      } while( h != v->halfedge() );
+    }
+    for( FaceCIter f = original.facesBegin(); f != original.facesEnd(); f++ ) {
+      s += f->normal().x;
+    }
+    sink = s;
+    return original.nVertices() + original.nFaces();
+  } } );
+
+  benchmarks.push_back( { "flip", [&](){ fresh(); randomEdges( mesh, EdgeBatch::FLIP, edges ); }, [&](){
+    for( size_t i = 0; i < edges.size(); i++ ) mesh.flipEdge( edges[i] );
+    return edges.size();
+  } } );
+
+  benchmarks.push_back( { "split", [&](){ fresh(); randomEdges( mesh, EdgeBatch::SPLIT, edges ); }, [&](){
+    for( size_t i = 0; i < edges.size(); i++ ) mesh.splitEdge( edges[i] );
+    return edges.size();
+  } } );
+
+  benchmarks.push_back( { "collapse", [&](){ fresh(); randomEdges( mesh, EdgeBatch::COLLAPSE, edges ); }, [&](){
+    for( size_t i = 0; i < edges.size(); i++ ) mesh.collapseEdge( edges[i] );
+    return edges.size();
+  } } );
+
+  benchmarks.push_back( { "upsample", fresh, [&](){
+    Size n = mesh.nFaces();
+    resampler.upsample( mesh );
+    return n;
+  } } );
+
+  // Simplify to a tenth of the faces; each call to downsample() removes
+  // a fixed fraction, so repeat until done (or until nothing changes).
+  benchmarks.push_back( { "downsample", fresh, [&](){
+    Size n = mesh.nFaces();
+    while( mesh.nFaces() > n / 10 ) {
+      Size before = mesh.nFaces();
+      resampler.downsample( mesh );
+      if( mesh.nFaces() >= before ) break;
+    }
+    return n;
+  } } );
+
+  benchmarks.push_back( { "resample", fresh, [&](){
+    Size n = mesh.nFaces();
+    resampler.resample( mesh );
+    return n;
+  } } );
+
+  benchmarks.push_back( { "bvh_build", none, [&](){
+    bvh.build( original );
+    return original.nFaces();
+  } } );
+
+  // Cast rays from random points around the mesh towards random points
+  // inside its bounding box, as when picking under the cursor.
+  benchmarks.push_back( { "pick", [&](){ if( bvh.empty() ) bvh.build( original ); }, [&](){
+    BBox box;
+    for( VertexCIter v = original.verticesBegin(); v != original.verticesEnd(); v++ ) box.expand( v->position );
+    Vector3D center = box.centroid();
+    Vector3D extent = box.max - box.min;
+    double radius = extent.norm();
+
+    mt19937 random( seed );
+    uniform_real_distribution<double> uniform( -1., 1. );
+    const Size nRays = 10000;
+    Size hits = 0;
+    for( Size i = 0; i < nRays; i++ ) {
+      Vector3D u( uniform( random ), uniform( random ), uniform( random ) );
+      Vector3D o = center + 2. * radius * u.unit();
+      Vector3D target = center + .25 * Vector3D( uniform( random ) * extent.x,
+                                                 uniform( random ) * extent.y,
+                                                 uniform( random ) * extent.z );
+      FaceIter face;
+      double t;
+      Vector3D barycentric;
+      if( bvh.intersect( o, target - o, face, t, barycentric ) ) hits++;
+    }
+    sink = hits;
+    return nRays;
+  } } );
+
+  for( size_t i = 0; i < benchmarks.size(); i++ ) {
+    const Benchmark& b = benchmarks[i];
+    if( b.name.find( filter ) == string::npos ) continue;
+
+    msg( model << ": " << b.name );
+    TraceScope trace( b.name.c_str() );
+    results.push_back( measure( model, b.name, minSeconds, b.setup, b.run ) );
+  }
+}
+
+static void writeCSV( ostream& out, const vector<Result>& results ) {
+  out << "model,benchmark,elements,repetitions,min_ms,median_ms,elements_per_second\n";
+  for( size_t i = 0; i < results.size(); i++ ) {
+    const Result& r = results[i];
+    out << r.model << ',' << r.benchmark << ',' << r.elements << ',' << r.repetitions << ','
+        << r.min_ms << ',' << r.median_ms << ','
+        << ( r.median_ms > 0. ? r.elements / ( r.median_ms / 1000. ) : 0. ) << '\n';
+  }
+}
+
+static void writeJSON( ostream& out, const vector<Result>& results ) {
+  out << "[\n";
+  for( size_t i = 0; i < results.size(); i++ ) {
+    const Result& r = results[i];
+    out << "  { \"model\": \"" << r.model << "\", \"benchmark\": \"" << r.benchmark << "\""
+        << ", \"elements\": " << r.elements
+        << ", \"repetitions\": " << r.repetitions
+        << ", \"min_ms\": " << r.min_ms
+        << ", \"median_ms\": " << r.median_ms
+        << ", \"elements_per_second\": " << ( r.median_ms > 0. ? r.elements / ( r.median_ms / 1000. ) : 0. )
+        << " }" << ( i + 1 < results.size() ? "," : "" ) << "\n";
+  }
+  out << "]\n";
+}
+
+static void usage() {
+  cerr << "Usage: meshedit-bench [options...] [model.dae | shape:faces ...]\n"
+       << "Shapes (generated with about the given number of faces, e.g., torus:2M):\n"
+       << "  icosphere, torus, grid, tube\n"
+       << "Options:\n"
+       << "  --models DIR          directory holding the bundled models (default: dae)\n"
+       << "  --series shape[:max]  a generated mesh of each size from 1K faces up to\n"
+       << "                        max (default: 50M), in steps of about ten\n"
+       << "  --filter NAME         only run the benchmarks whose name contains NAME\n"
+       << "                        (build, copy, traverse, flip, split, collapse,\n"
+       << "                        upsample, downsample, resample, bvh_build, pick)\n"
+       << "  --min-time S          repeat each benchmark for at least S seconds (default: 0.5)\n"
+       << "  --json                write JSON instead of CSV\n"
+       << "  -o, --output FILE     write the results to FILE instead of the standard output\n"
+       << "  --trace FILE          record a trace of the run\n";
+}
+
+int main( int argc, char** argv ) {
+
+  // parse the command line
+  string directory = "dae", filter, output, trace;
+  double minSeconds = .5;
+  bool json = false;
+  vector<string> files;
+  for( int i = 1; i < argc; i++ ) {
+    string arg = argv[i];
+    if( arg == "--models" && i + 1 < argc ) {
+      directory = argv[++i];
+    } else if( arg == "--series" && i + 1 < argc ) {
+      string shape;
+      Size maxFaces = 50000000, nFaces;
+      string spec = argv[++i];
+      if( spec.find( ':' ) == string::npos ) spec += ":" + to_string( maxFaces );
+      if( !parseGeneratorSpec( spec, shape, maxFaces ) ) {
+        msg( "Invalid series: " << argv[i] );
+        usage(); return 1;
+      }
+      for( size_t k = 0; k < sizeof( seriesSizes ) / sizeof( seriesSizes[0] ); k++ ) {
+        string step = shape + ":" + seriesSizes[k];
+        parseGeneratorSpec( step, shape, nFaces );
+        if( nFaces <= maxFaces ) files.push_back( step );
+      }
+    } else if( arg == "--filter" && i + 1 < argc ) {
+      filter = argv[++i];
+    } else if( arg == "--min-time" && i + 1 < argc ) {
+      minSeconds = atof( argv[++i] );
+    } else if( arg == "--json" ) {
+      json = true;
+    } else if( ( arg == "-o" || arg == "--output" ) && i + 1 < argc ) {
+      output = argv[++i];
+    } else if( arg == "--trace" && i + 1 < argc ) {
+      trace = argv[++i];
+    } else if( arg[0] != '-' ) {
+      files.push_back( arg );
+    } else {
+      msg( "Unknown argument: " << arg );
+      usage(); return 1;
+    }
+  }
+  if( files.empty() ) {
+    for( size_t i = 0; i < sizeof( models ) / sizeof( models[0] ); i++ ) {
+      files.push_back( directory + "/" + models[i] + ".dae" );
+    }
+  }
+
+  if( !trace.empty() ) {
+    Trace::name_thread( "main" );
+    Trace::start();
+  }
+
+  vector<Result> results;
+  for( size_t i = 0; i < files.size(); i++ ) {
+    vector< vector<Index> > polygons;
+    vector<Vector3D> positions;
+    string model, shape;
+    Size nFaces;
+    if( parseGeneratorSpec( files[i], shape, nFaces ) ) {
+      // name a generated mesh after its spec
+      generateMesh( files[i], polygons, positions );
+      model = files[i];
+    } else {
+      if( !loadModel( files[i], polygons, positions ) ) {
+        msg( "Could not load a mesh from " << files[i] );
+        return 1;
+      }
+
+      // name the model after the file, without its directory or extension
+      model = files[i].substr( files[i].find_last_of( "/\\" ) + 1 );
+      model = model.substr( 0, model.rfind( '.' ) );
+    }
+    benchmarkModel( model, polygons, positions, filter, minSeconds, results );
+  }
+
+  ofstream file;
+  if( !output.empty() ) {
+    file.open( output.c_str() );
+    if( !file.is_open() ) {
+      msg( "Could not write " << output );
+      return 1;
+    }
+  }
+  ostream& out = output.empty() ? cout : file;
+  out << fixed << setprecision( 4 );
+  if( json ) writeJSON( out, results );
+  else       writeCSV ( out, results );
+
+  if( !trace.empty() ) {
+    Trace::stop();
+    if( Trace::save( trace ) < 0 ) {
+      msg( "Could not write " << trace );
+      return 1;
+    }
+  }
+
+  return 0;
+}
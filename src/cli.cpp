@@ -0,0 +1,661 @@
+/*
+ * Command-line batch processor (meshedit-cli).
+ *
+ * Loads a COLLADA file, runs a pipeline of operations on every mesh in
+ * it, prints how long each step took, and optionally saves the result.
+ * Nothing here creates a window or an OpenGL context, so it runs on
+ * machines without a display.
+ *
+ *    meshedit-cli input.dae --upsample 2 --downsample 0.25 --resample 5 -o output.dae
+ *
+ * Given a directory instead, every .dae file in it is processed the same
+ * way, several at a time, and the results are written to the output
+ * directory under the same names:
+ *
+ *    meshedit-cli models/ --upsample 2 -o results/ --jobs 8 --memory 4096 --summary timings.csv
+ *
+ * Each worker thread processes one file (and builds one mesh) at a time.
+ * Before building, a worker reserves the estimated size of the largest
+ * halfedge mesh the file will produce, and waits while the reservations
+ * of the other workers would exceed the memory budget.
+ *
+ * The input can also be a generated mesh (see meshGenerators.h), named
+ * by its shape and approximate number of faces, e.g., to write it out:
+ *
+ *    meshedit-cli icosphere:1M -o icosphere.dae
+ *
+ * Operations run in the order given; see usage() for the list.
+ */
+
+#include "CMU462/trace.h"
+
+#include "collada.h"
+#include "meshNode.h"
+#include "meshGenerators.h"
+#include "student_code.h"
+#include "remesher.h"
+#include "edgeFlipper.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+using namespace std;
+using namespace CMU462;
+
+#define msg(s) cerr << "[meshedit-cli] " << s << endl;
+
+// One step of the pipeline, e.g., "--upsample 2".
+struct Operation {
+  string name;     // without the leading dashes
+  string value;    // the argument, as given
+  int count;       // number of rounds or iterations (upsample, resample, remesh)
+  double fraction; // fraction of the faces to keep (downsample)
+
+  Operation() : count( 0 ), fraction( 1. ) {}
+};
+
+// What happened to one file.
+struct FileReport {
+
+  struct Step {
+    string name;          // operation and argument, e.g., "upsample 2"
+    double ms;
+    Size faces_before;
+    Size faces_after;
+  };
+
+  string input;
+  string error;           // empty on success
+
+  Size meshes;
+  Size vertices;          // element counts, summed over the meshes
+  Size edges;             // (after the last operation)
+  Size faces;
+  Size input_faces;       // faces before the first operation
+  size_t estimate;        // bytes reserved from the memory budget
+
+  double load_ms;
+  double wait_ms;         // waiting for the memory budget
+  double build_ms;
+  double operations_ms;
+  double save_ms;
+  double total_ms;
+
+  vector<Step> steps;
+
+  FileReport() : meshes( 0 ), vertices( 0 ), edges( 0 ), faces( 0 ), input_faces( 0 ),
+                 estimate( 0 ), load_ms( 0 ), wait_ms( 0 ), build_ms( 0 ),
+                 operations_ms( 0 ), save_ms( 0 ), total_ms( 0 ) {}
+};
+
+/**
+ * Limits the total size of the meshes being processed at once.  A job
+ * larger than the whole budget is let through only when nothing else
+ * holds a reservation, so it runs alone rather than never.
+ */
+class MemoryBudget {
+ public:
+
+  // A limit of zero means no limit.
+  MemoryBudget( size_t limit ) : limit( limit ), used( 0 ) {}
+
+  // Waits until the given number of bytes fits, reserves them, and
+  // returns how long the wait took (in milliseconds).
+  double acquire( size_t bytes ) {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    unique_lock<mutex> lock( m );
+    while( limit > 0 && used > 0 && used + bytes > limit ) released.wait( lock );
+    used += bytes;
+    return chrono::duration<double, milli>( chrono::steady_clock::now() - start ).count();
+  }
+
+  void release( size_t bytes ) {
+    {
+      lock_guard<mutex> lock( m );
+      used -= bytes;
+    }
+    released.notify_all();
+  }
+
+ private:
+  size_t limit;
+  size_t used;
+  mutex m;
+  condition_variable released;
+};
+
+static void usage() {
+  cerr << "Usage: meshedit-cli <input.dae> [operations...] [-o <output.dae>] [--trace <trace.json>]\n"
+       << "       meshedit-cli <shape:faces> [operations...] [-o <output.dae>] [--trace <trace.json>]\n"
+       << "       meshedit-cli <directory> [operations...] [-o <directory>] [options...]\n"
+       << "Shapes (generated with about the given number of faces, e.g., torus:2M):\n"
+       << "  icosphere, torus, grid, tube\n"
+       << "Operations (applied to every mesh, in order):\n"
+       << "  --upsample N          N rounds of subdivision (at most 10)\n"
+       << "  --downsample F        simplify until at most F times as many faces remain\n"
+       << "  --resample N          N rounds of resampling\n"
+       << "  --remesh N            isotropic remeshing with N iterations\n"
+       << "  --flip valence|delaunay\n"
+       << "                        flip edges until no flip improves the criterion\n"
+       << "Options for directories:\n"
+       << "  -j, --jobs N          process N files at a time (default: one per core)\n"
+       << "  --memory MB           keep the estimated size of the meshes being\n"
+       << "                        processed under MB megabytes (default: no limit)\n"
+       << "  --summary FILE        write per-file timings and element counts to FILE\n"
+       << "                        (JSON if it ends in .json, CSV otherwise)\n";
+}
+
+static bool isOperation( const string& name ) {
+  return name == "upsample" || name == "downsample" || name == "resample" ||
+         name == "remesh"   || name == "flip";
+}
+
+// Largest number of rounds of subdivision (each multiplies the number of
+// faces by four), and of any other operation.
+static const long maxUpsample = 10;
+static const long maxRounds = 1000;
+
+// Parses the argument of an operation into count or fraction, returning
+// false if it's invalid.
+static bool parseOperation( Operation& op ) {
+  if( op.name == "flip" ) return op.value == "valence" || op.value == "delaunay";
+
+  // Plain decimal numbers only (no signs, spaces, hex, inf or nan).
+  const string& v = op.value;
+  if( v.empty() || v.find_first_not_of( "0123456789." ) != string::npos ) return false;
+
+  char* end;
+  if( op.name == "downsample" ) {
+    double x = strtod( v.c_str(), &end );
+    if( *end != '\0' || !( x >= 0 && x <= 1 ) ) return false;
+    op.fraction = x;
+    return true;
+  }
+
+  long n = strtol( v.c_str(), &end, 10 );
+  if( *end != '\0' || n > ( op.name == "upsample" ? maxUpsample : maxRounds ) ) return false;
+  op.count = int( n );
+  return true;
+}
+
+// Parses a positive integer, returning false if it's invalid.
+static bool parseCount( const string& s, size_t& n ) {
+  char* end;
+  long x = strtol( s.c_str(), &end, 10 );
+  if( s.empty() || *end != '\0' || x <= 0 ) return false;
+  n = size_t( x );
+  return true;
+}
+
+// Applies one operation to a mesh.
+static void runOperation( const Operation& op, HalfedgeMesh& mesh ) {
+
+  MeshResampler resampler;
+
+  if( op.name == "upsample" ) {
+    for( int i = 0; i < op.count; i++ ) resampler.upsample( mesh );
+  } else if( op.name == "downsample" ) {
+    // Each call simplifies by a fixed factor, so repeat until the target
+    // is reached (or until a call makes no progress).
+    Size target = Size( op.fraction * mesh.nFaces() );
+    while( mesh.nFaces() > target ) {
+      Size before = mesh.nFaces();
+      resampler.downsample( mesh );
+      if( mesh.nFaces() >= before ) break;
+    }
+  } else if( op.name == "resample" ) {
+    for( int i = 0; i < op.count; i++ ) resampler.resample( mesh );
+  } else if( op.name == "remesh" ) {
+    Remesher remesher;
+    remesher.remesh( mesh, op.count );
+  } else if( op.name == "flip" ) {
+    EdgeFlipper flipper;
+    if( op.value == "valence" ) flipper.flipToValence( mesh );
+    else flipper.flipToDelaunay( mesh );
+  }
+}
+
+// How much larger than the input mesh the pipeline can make it: each
+// round of subdivision splits every face into four.
+static double growth( const vector<Operation>& operations ) {
+  double g = 1.;
+  for( size_t i = 0; i < operations.size(); i++ ) {
+    if( operations[i].name == "upsample" ) g *= pow( 4., operations[i].count );
+  }
+  return g;
+}
+
+static double millisecondsSince( chrono::steady_clock::time_point start ) {
+  return chrono::duration<double, milli>( chrono::steady_clock::now() - start ).count();
+}
+
+// Frees a scene returned by ColladaParser::load().
+static void deleteScene( Scene* scene ) {
+  for( size_t i = 0; i < scene->nodes.size(); i++ ) {
+    Instance* instance = scene->nodes[i].instance;
+    if( instance == NULL ) continue;
+    switch( instance->type ) {
+      case CAMERA:
+        delete static_cast<Camera*>( instance );
+        break;
+      case LIGHT:
+        delete static_cast<Light*>( instance );
+        break;
+      case POLYMESH:
+        delete static_cast<Polymesh*>( instance )->material;
+        delete static_cast<Polymesh*>( instance );
+        break;
+      default:
+        break;
+    }
+  }
+  delete scene;
+}
+
+// Loads a file, runs the pipeline on each of its meshes, and saves the
+// result (unless output is empty), filling in the report.  Returns false
+// if the file could not be loaded or saved.
+static bool processFile( const string& input, const string& output,
+                         const vector<Operation>& operations,
+                         MemoryBudget& budget, FileReport& report ) {
+
+  TraceScope trace( input.c_str() );
+  chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+  report.input = input;
+
+  // load (or generate) the scene
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  Scene* scene = new Scene();
+  string shape;
+  Size nFaces;
+  bool loaded = parseGeneratorSpec( input, shape, nFaces ) ? generateScene( input, scene )
+                                                           : ColladaParser::load( input.c_str(), scene ) == 0;
+  if( !loaded ) {
+    report.error = "could not load";
+    delete scene;
+    return false;
+  }
+  report.load_ms = millisecondsSince( start );
+
+  // reserve room for the largest mesh (only one is built at a time)
+  vector<Polymesh*> polymeshes;
+  size_t largest = 0;
+  for( size_t i = 0; i < scene->nodes.size(); i++ ) {
+    Instance* instance = scene->nodes[i].instance;
+    if( instance == NULL || instance->type != POLYMESH ) continue;
+    Polymesh* polymesh = static_cast<Polymesh*>( instance );
+    polymeshes.push_back( polymesh );
+
+    Size corners = 0;
+    for( size_t j = 0; j < polymesh->polygons.size(); j++ ) {
+      corners += polymesh->polygons[j].vertex_indices.size();
+    }
+    largest = max( largest, HalfedgeMesh::estimateSize( polymesh->vertices.size(),
+                                                        polymesh->polygons.size(), corners ) );
+  }
+  report.meshes = polymeshes.size();
+  report.estimate = size_t( largest * growth( operations ) );
+  report.wait_ms = budget.acquire( report.estimate );
+
+  // build the meshes and run the pipeline on each
+  for( size_t i = 0; i < polymeshes.size(); i++ ) {
+    Polymesh& polymesh = *polymeshes[i];
+
+    start = chrono::steady_clock::now();
+    MeshNode node( polymesh );
+    report.build_ms += millisecondsSince( start );
+    report.input_faces += node.mesh.nFaces();
+
+    for( size_t j = 0; j < operations.size(); j++ ) {
+      const Operation& op = operations[j];
+      FileReport::Step step;
+      step.name = op.name + " " + op.value;
+      step.faces_before = node.mesh.nFaces();
+
+      start = chrono::steady_clock::now();
+      runOperation( op, node.mesh );
+      step.ms = millisecondsSince( start );
+      step.faces_after = node.mesh.nFaces();
+
+      report.operations_ms += step.ms;
+      report.steps.push_back( step );
+    }
+
+    report.vertices += node.mesh.nVertices();
+    report.edges    += node.mesh.nEdges();
+    report.faces    += node.mesh.nFaces();
+
+    if( !output.empty() ) node.writePolymesh( polymesh );
+  }
+  budget.release( report.estimate );
+
+  // save the result
+  bool saved = true;
+  if( !output.empty() ) {
+    start = chrono::steady_clock::now();
+    saved = ( ColladaParser::save( output.c_str(), scene ) == 0 );
+    report.save_ms = millisecondsSince( start );
+    if( !saved ) report.error = "could not save " + output;
+  }
+
+  deleteScene( scene );
+  report.total_ms = millisecondsSince( begin );
+  return saved;
+}
+
+// Lists the .dae files in a directory, in alphabetical order.
+static bool listDirectory( const string& path, vector<string>& files ) {
+  files.clear();
+#ifdef _WIN32
+  WIN32_FIND_DATAA entry;
+  HANDLE dir = FindFirstFileA( ( path + "\\*" ).c_str(), &entry );
+  if( dir == INVALID_HANDLE_VALUE ) return false;
+  do {
+    files.push_back( entry.cFileName );
+  } while( FindNextFileA( dir, &entry ) );
+  FindClose( dir );
+#else
+  DIR* dir = opendir( path.c_str() );
+  if( dir == NULL ) return false;
+  while( dirent* entry = readdir( dir ) ) {
+    files.push_back( entry->d_name );
+  }
+  closedir( dir );
+#endif
+
+  vector<string> models;
+  for( size_t i = 0; i < files.size(); i++ ) {
+    const string& name = files[i];
+    if( name.size() < 4 ) continue;
+    string extension = name.substr( name.size() - 4 );
+    transform( extension.begin(), extension.end(), extension.begin(), ::tolower );
+    if( extension == ".dae" ) models.push_back( name );
+  }
+  sort( models.begin(), models.end() );
+  files.swap( models );
+  return true;
+}
+
+static bool isDirectory( const string& path ) {
+  struct stat info;
+  return stat( path.c_str(), &info ) == 0 && ( info.st_mode & S_IFDIR );
+}
+
+static bool makeDirectory( const string& path ) {
+  if( isDirectory( path ) ) return true;
+#ifdef _WIN32
+  return _mkdir( path.c_str() ) == 0;
+#else
+  return mkdir( path.c_str(), 0777 ) == 0;
+#endif
+}
+
+static string csvField( const string& s ) {
+  if( s.find_first_of( ",\"\n" ) == string::npos ) return s;
+  string quoted = "\"";
+  for( size_t i = 0; i < s.size(); i++ ) {
+    if( s[i] == '"' ) quoted += '"';
+    quoted += s[i];
+  }
+  return quoted + "\"";
+}
+
+static string jsonString( const string& s ) {
+  string quoted = "\"";
+  for( size_t i = 0; i < s.size(); i++ ) {
+    if( s[i] == '"' || s[i] == '\\' ) quoted += '\\';
+    if( s[i] == '\n' ) { quoted += "\\n"; continue; }
+    quoted += s[i];
+  }
+  return quoted + "\"";
+}
+
+// Writes one row (or object) per file, as JSON if the file name ends in
+// .json, or CSV otherwise.  Returns 0 on success, -1 on failure.
+static int writeSummary( const string& filename, const vector<FileReport>& reports ) {
+
+  ofstream out( filename.c_str() );
+  if( !out.is_open() ) return -1;
+  out << fixed << setprecision( 3 );
+
+  bool json = filename.size() >= 5 && filename.substr( filename.size() - 5 ) == ".json";
+  if( json ) {
+    out << "[\n";
+    for( size_t i = 0; i < reports.size(); i++ ) {
+      const FileReport& r = reports[i];
+      out << "  { \"file\": " << jsonString( r.input )
+          << ", \"status\": " << jsonString( r.error.empty() ? "ok" : r.error )
+          << ", \"meshes\": " << r.meshes
+          << ", \"input_faces\": " << r.input_faces
+          << ", \"vertices\": " << r.vertices
+          << ", \"edges\": " << r.edges
+          << ", \"faces\": " << r.faces
+          << ", \"estimated_bytes\": " << r.estimate
+          << ",\n    \"load_ms\": " << r.load_ms
+          << ", \"wait_ms\": " << r.wait_ms
+          << ", \"build_ms\": " << r.build_ms
+          << ", \"operations_ms\": " << r.operations_ms
+          << ", \"save_ms\": " << r.save_ms
+          << ", \"total_ms\": " << r.total_ms
+          << ",\n    \"steps\": [";
+      for( size_t j = 0; j < r.steps.size(); j++ ) {
+        const FileReport::Step& s = r.steps[j];
+        out << ( j ? ", " : "" )
+            << "{ \"operation\": " << jsonString( s.name )
+            << ", \"ms\": " << s.ms
+            << ", \"faces_before\": " << s.faces_before
+            << ", \"faces_after\": " << s.faces_after << " }";
+      }
+      out << "] }" << ( i + 1 < reports.size() ? "," : "" ) << "\n";
+    }
+    out << "]\n";
+  } else {
+    out << "file,status,meshes,input_faces,vertices,edges,faces,estimated_bytes,"
+        << "load_ms,wait_ms,build_ms,operations_ms,save_ms,total_ms\n";
+    for( size_t i = 0; i < reports.size(); i++ ) {
+      const FileReport& r = reports[i];
+      out << csvField( r.input ) << ','
+          << csvField( r.error.empty() ? "ok" : r.error ) << ','
+          << r.meshes << ',' << r.input_faces << ','
+          << r.vertices << ',' << r.edges << ',' << r.faces << ','
+          << r.estimate << ','
+          << r.load_ms << ',' << r.wait_ms << ',' << r.build_ms << ','
+          << r.operations_ms << ',' << r.save_ms << ',' << r.total_ms << '\n';
+    }
+  }
+
+  out.close();
+  return out.fail() ? -1 : 0;
+}
+
+// Processes every .dae file in a directory on a pool of worker threads.
+// Returns the number of files that failed.
+static int processDirectory( const string& input, const string& output,
+                             const vector<Operation>& operations,
+                             size_t jobs, size_t memoryMB, const string& summary ) {
+
+  vector<string> files;
+  if( !listDirectory( input, files ) ) {
+    msg( "Could not open " << input );
+    return 1;
+  }
+  if( files.empty() ) {
+    msg( "No .dae files in " << input );
+    return 0;
+  }
+  if( !output.empty() && !makeDirectory( output ) ) {
+    msg( "Could not create " << output );
+    return 1;
+  }
+
+  jobs = min( jobs, files.size() );
+  cout << "processing " << files.size() << " files with " << jobs << " workers";
+  if( memoryMB > 0 ) cout << " within " << memoryMB << " MB";
+  cout << endl;
+
+  MemoryBudget budget( memoryMB << 20 );
+  vector<FileReport> reports( files.size() );
+  atomic<size_t> next( 0 );
+  atomic<int> failures( 0 );
+  mutex printing;
+  size_t done = 0;
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+  vector<thread> workers;
+  for( size_t w = 0; w < jobs; w++ ) {
+    workers.push_back( thread( [&, w]() {
+      ostringstream name;
+      name << "Worker " << w;
+      Trace::name_thread( name.str() );
+
+      for( size_t i = next++; i < files.size(); i = next++ ) {
+        FileReport& r = reports[i];
+        string path = input + "/" + files[i];
+        string result = output.empty() ? string() : output + "/" + files[i];
+        if( !processFile( path, result, operations, budget, r ) ) failures++;
+
+        lock_guard<mutex> lock( printing );
+        cout << "[" << ++done << "/" << files.size() << "] " << files[i] << ": ";
+        if( r.error.empty() ) {
+          cout << r.input_faces << " -> " << r.faces << " faces, "
+               << r.total_ms << " ms";
+          if( r.wait_ms >= 1. ) cout << " (waited " << r.wait_ms << " ms for memory)";
+        } else {
+          cout << r.error;
+        }
+        cout << endl;
+      }
+    } ) );
+  }
+  for( size_t w = 0; w < workers.size(); w++ ) workers[w].join();
+
+  cout << "done in " << millisecondsSince( start ) << " ms";
+  if( failures > 0 ) cout << ", " << failures << " failed";
+  cout << endl;
+
+  if( !summary.empty() && writeSummary( summary, reports ) < 0 ) {
+    msg( "Could not write " << summary );
+    return failures + 1;
+  }
+  return failures;
+}
+
+int main( int argc, char** argv ) {
+
+  // parse the command line
+  string input, output, trace, summary;
+  size_t jobs = max( 1u, thread::hardware_concurrency() );
+  size_t memoryMB = 0;
+  bool batchOptions = false;
+  vector<Operation> operations;
+  for( int i = 1; i < argc; i++ ) {
+    string arg = argv[i];
+    if( ( arg == "-o" || arg == "--output" ) && i + 1 < argc ) {
+      output = argv[++i];
+    } else if( arg == "--trace" && i + 1 < argc ) {
+      trace = argv[++i];
+    } else if( ( arg == "-j" || arg == "--jobs" ) && i + 1 < argc ) {
+      if( !parseCount( argv[++i], jobs ) ) {
+        msg( "Invalid number of jobs: " << argv[i] );
+        usage(); return 1;
+      }
+      batchOptions = true;
+    } else if( arg == "--memory" && i + 1 < argc ) {
+      if( !parseCount( argv[++i], memoryMB ) ) {
+        msg( "Invalid memory budget: " << argv[i] );
+        usage(); return 1;
+      }
+      batchOptions = true;
+    } else if( arg == "--summary" && i + 1 < argc ) {
+      summary = argv[++i];
+      batchOptions = true;
+    } else if( arg.compare( 0, 2, "--" ) == 0 && isOperation( arg.substr( 2 ) ) && i + 1 < argc ) {
+      Operation op;
+      op.name = arg.substr( 2 );
+      op.value = argv[++i];
+      if( !parseOperation( op ) ) {
+        msg( "Invalid argument for " << arg << ": " << op.value );
+        usage(); return 1;
+      }
+      operations.push_back( op );
+    } else if( input.empty() && arg[0] != '-' ) {
+      input = arg;
+    } else {
+      msg( "Unknown argument: " << arg );
+      usage(); return 1;
+    }
+  }
+  if( input.empty() ) {
+    usage(); return 1;
+  }
+
+  bool batch = isDirectory( input );
+  if( batchOptions && !batch ) {
+    msg( "--jobs, --memory and --summary apply only to directories" );
+    usage(); return 1;
+  }
+
+  if( !trace.empty() ) {
+    Trace::name_thread( "main" );
+    Trace::start();
+  }
+
+  cout << fixed << setprecision( 2 );
+
+  int status = 0;
+  if( batch ) {
+    status = processDirectory( input, output, operations, jobs, memoryMB, summary ) == 0 ? 0 : 1;
+  } else {
+    MemoryBudget unlimited( 0 );
+    FileReport r;
+    bool ok = processFile( input, output, operations, unlimited, r );
+    if( r.error == "could not load" ) {
+      msg( "Could not open " << input );
+      return 1;
+    }
+
+    cout << "load " << input << ": " << r.load_ms << " ms" << endl;
+    cout << "build " << r.meshes << ( r.meshes == 1 ? " mesh: " : " meshes: " )
+         << r.input_faces << " faces in " << r.build_ms << " ms" << endl;
+    for( size_t j = 0; j < r.steps.size(); j++ ) {
+      const FileReport::Step& s = r.steps[j];
+      cout << "  " << left << setw( 22 ) << s.name << right
+           << setw( 10 ) << s.ms << " ms   "
+           << s.faces_before << " -> " << s.faces_after << " faces" << endl;
+    }
+    if( !ok ) {
+      msg( "Could not write " << output );
+      return 1;
+    }
+    if( !output.empty() ) cout << "save " << output << ": " << r.save_ms << " ms" << endl;
+  }
+
+  if( !trace.empty() ) {
+    Trace::stop();
+    if( Trace::save( trace ) < 0 ) {
+      msg( "Could not write " << trace );
+      return 1;
+    }
+  }
+
+  return status;
+}
@@ -1,4 +1,5 @@
 #include "collada.h"
+#include "CMU462/trace.h"
 
 #include <assert.h>
 #include <map>
@@ -8,6 +9,7 @@
 #include <sstream>
 #include <iostream>
 #include <algorithm>
+#include <mutex>
 
 #define PI 3.14159265
 
@@ -29,6 +31,9 @@ XMLElement* ColladaParser::e_geometries;   // COLLADA library: geometries
 XMLElement* ColladaParser::e_materials;    // COLLADA library: materials
 XMLElement* ColladaParser::e_effects;      // COLLADA library: effects
 
+// The entry points above are shared, so files are parsed one at a time
+static mutex load_mutex;
+
 XMLElement* find_instance( XMLElement* entry, string id ) {
 
   assert( entry );
@@ -85,6 +90,9 @@ Color rgba_from_string ( string color_string ) {
 
 int ColladaParser::load( const char* filename, Scene* scene ) {
 
+  TRACE_SCOPE( "ColladaParser::load" );
+  lock_guard<mutex> lock( load_mutex );
+
   ifstream in( filename );
   if ( !in.is_open() ) {
     return -1;
@@ -94,13 +102,13 @@ int ColladaParser::load( const char* filename, Scene* scene ) {
   doc.LoadFile( filename );
   if ( doc.Error() ) {
     doc.PrintError();
-    exit( 1 );
+    return -1;
   }
 
   XMLElement* root = doc.FirstChildElement("COLLADA");
   if ( !root ) {
     stat("Error: not a COLLADA file!")
-    exit( 1 );
+    return -1;
   } else {
     stat("Loading COLLADA file...");
   }
@@ -172,11 +180,321 @@ int ColladaParser::load( const char* filename, Scene* scene ) {
 
 }
 
+// Writer //
+
+// writes a list of numbers as the text of the current element
+template<typename T>
+static void push_array( XMLPrinter& printer, const vector<T>& values ) {
+
+  ostringstream ss;
+  ss.precision( 9 );
+  for ( size_t i = 0; i < values.size(); ++i ) {
+    if ( i > 0 ) ss << ' ';
+    ss << values[i];
+  }
+  printer.PushText( ss.str().c_str() );
+}
+
+static string color_string( const Color& c ) {
+  ostringstream ss;
+  ss << c.r << " " << c.g << " " << c.b << " " << c.a;
+  return ss.str();
+}
+
+static void write_color( XMLPrinter& printer, const char* name, const Color& c ) {
+  printer.OpenElement( name );
+  printer.OpenElement( "color" );
+  printer.PushText( color_string( c ).c_str() );
+  printer.CloseElement();
+  printer.CloseElement();
+}
+
+static void write_float( XMLPrinter& printer, const char* name, float f ) {
+  printer.OpenElement( name );
+  printer.OpenElement( "float" );
+  printer.PushText( f );
+  printer.CloseElement();
+  printer.CloseElement();
+}
+
 int ColladaParser::save( const char* filename, const Scene* scene ) {
 
-  // TODO: not yet supported
-  return 0;
+  TRACE_SCOPE( "ColladaParser::save" );
+
+  FILE* file = fopen( filename, "w" );
+  if ( !file ) {
+    return -1;
+  }
+
+  // Note:
+  // This writes what the parser reads back: cameras, lights, and polygon
+  // meshes with their node transforms and phong materials. Meshes are
+  // written with positions only, since edits invalidate any normals or
+  // texture coordinates loaded with them.
+  const vector<Node>& nodes = scene->nodes;
+
+  // every object gets an id of its own (the loaded ids may be shared)
+  vector<string> ids( nodes.size() );
+  for ( size_t i = 0; i < nodes.size(); ++i ) {
+    ostringstream ss; ss << "object" << i;
+    ids[i] = ss.str();
+  }
+
+  XMLPrinter printer( file );
+  printer.PushHeader( false, true );
+  printer.OpenElement( "COLLADA" );
+  printer.PushAttribute( "xmlns", "http://www.collada.org/2005/11/COLLADASchema" );
+  printer.PushAttribute( "version", "1.4.1" );
+
+  printer.OpenElement( "asset" );
+  printer.OpenElement( "up_axis" );
+  printer.PushText( "Y_UP" );
+  printer.CloseElement();
+  printer.CloseElement();
+
+  // cameras
+  printer.OpenElement( "library_cameras" );
+  for ( size_t i = 0; i < nodes.size(); ++i ) {
+    if ( !nodes[i].instance || nodes[i].instance->type != CAMERA ) continue;
+    const Camera& camera = static_cast<const Camera&>( *nodes[i].instance );
+
+    printer.OpenElement( "camera" );
+    printer.PushAttribute( "id",   ( ids[i] + "-camera" ).c_str() );
+    printer.PushAttribute( "name", camera.name.c_str() );
+    printer.OpenElement( "optics" );
+    printer.OpenElement( "technique_common" );
+    printer.OpenElement( "perspective" );
+    printer.OpenElement( "xfov"  ); printer.PushText( camera.hfov  ); printer.CloseElement();
+    printer.OpenElement( "yfov"  ); printer.PushText( camera.vfov  ); printer.CloseElement();
+    printer.OpenElement( "znear" ); printer.PushText( camera.nclip ); printer.CloseElement();
+    printer.OpenElement( "zfar"  ); printer.PushText( camera.fclip ); printer.CloseElement();
+    printer.CloseElement();
+    printer.CloseElement();
+    printer.CloseElement();
+    printer.CloseElement();
+  }
+  printer.CloseElement();
+
+  // lights
+  printer.OpenElement( "library_lights" );
+  for ( size_t i = 0; i < nodes.size(); ++i ) {
+    if ( !nodes[i].instance || nodes[i].instance->type != LIGHT ) continue;
+    const Light& light = static_cast<const Light&>( *nodes[i].instance );
+
+    printer.OpenElement( "light" );
+    printer.PushAttribute( "id",   ( ids[i] + "-light" ).c_str() );
+    printer.PushAttribute( "name", light.name.c_str() );
+    printer.OpenElement( "technique_common" );
+    switch ( light.light_type ) {
+      case AMBIENT:     printer.OpenElement( "ambient"     ); break;
+      case POINT:       printer.OpenElement( "point"       ); break;
+      case DIRECTIONAL: printer.OpenElement( "directional" ); break;
+      default:          printer.OpenElement( "point"       ); break;
+    }
+    ostringstream ss; ss << light.color.r << " " << light.color.g << " " << light.color.b;
+    printer.OpenElement( "color" ); printer.PushText( ss.str().c_str() ); printer.CloseElement();
+    if ( light.light_type == POINT ) {
+      printer.OpenElement( "constant_attenuation" );
+      printer.PushText( light.attenuation );
+      printer.CloseElement();
+    }
+    printer.CloseElement();
+    printer.CloseElement();
+    printer.CloseElement();
+  }
+  printer.CloseElement();
+
+  // materials (one per mesh, since the parser makes one per mesh), and
+  // their effects
+  printer.OpenElement( "library_effects" );
+  for ( size_t i = 0; i < nodes.size(); ++i ) {
+    if ( !nodes[i].instance || nodes[i].instance->type != POLYMESH ) continue;
+    const Polymesh& polymesh = static_cast<const Polymesh&>( *nodes[i].instance );
+
+    Material material;
+    if ( polymesh.material ) {
+      material = *polymesh.material;
+    } else {
+      material.emit = Color( 0, 0, 0, 1 );
+      material.ambi = Color( 0, 0, 0, 1 );
+      material.diff = Color( .8, .8, .8, 1 );
+      material.spec = Color( .5, .5, .5, 1 );
+      material.shininess = 50;
+      material.refractive_index = 1;
+    }
+
+    printer.OpenElement( "effect" );
+    printer.PushAttribute( "id", ( ids[i] + "-effect" ).c_str() );
+    printer.OpenElement( "profile_COMMON" );
+    printer.OpenElement( "technique" );
+    printer.PushAttribute( "sid", "common" );
+    printer.OpenElement( "phong" );
+    write_color( printer, "emission", material.emit );
+    write_color( printer, "ambient",  material.ambi );
+    write_color( printer, "diffuse",  material.diff );
+    write_color( printer, "specular", material.spec );
+    write_float( printer, "shininess", material.shininess );
+    write_float( printer, "index_of_refraction", material.refractive_index );
+    printer.CloseElement();
+    printer.CloseElement();
+    printer.CloseElement();
+    printer.CloseElement();
+  }
+  printer.CloseElement();
+
+  printer.OpenElement( "library_materials" );
+  for ( size_t i = 0; i < nodes.size(); ++i ) {
+    if ( !nodes[i].instance || nodes[i].instance->type != POLYMESH ) continue;
+    const Polymesh& polymesh = static_cast<const Polymesh&>( *nodes[i].instance );
+    string name = polymesh.material ? polymesh.material->name : "material";
+
+    printer.OpenElement( "material" );
+    printer.PushAttribute( "id",   ( ids[i] + "-material" ).c_str() );
+    printer.PushAttribute( "name", name.c_str() );
+    printer.OpenElement( "instance_effect" );
+    printer.PushAttribute( "url", ( "#" + ids[i] + "-effect" ).c_str() );
+    printer.CloseElement();
+    printer.CloseElement();
+  }
+  printer.CloseElement();
+
+  // geometries
+  printer.OpenElement( "library_geometries" );
+  for ( size_t i = 0; i < nodes.size(); ++i ) {
+    if ( !nodes[i].instance || nodes[i].instance->type != POLYMESH ) continue;
+    const Polymesh& polymesh = static_cast<const Polymesh&>( *nodes[i].instance );
+    string id = ids[i] + "-mesh";
+
+    printer.OpenElement( "geometry" );
+    printer.PushAttribute( "id",   id.c_str() );
+    printer.PushAttribute( "name", polymesh.name.c_str() );
+    printer.OpenElement( "mesh" );
+
+    // positions
+    vector<double> positions;
+    positions.reserve( 3 * polymesh.vertices.size() );
+    for ( size_t j = 0; j < polymesh.vertices.size(); ++j ) {
+      positions.push_back( polymesh.vertices[j].x );
+      positions.push_back( polymesh.vertices[j].y );
+      positions.push_back( polymesh.vertices[j].z );
+    }
+    printer.OpenElement( "source" );
+    printer.PushAttribute( "id", ( id + "-positions" ).c_str() );
+    printer.OpenElement( "float_array" );
+    printer.PushAttribute( "id", ( id + "-positions-array" ).c_str() );
+    printer.PushAttribute( "count", (unsigned) positions.size() );
+    push_array( printer, positions );
+    printer.CloseElement();
+    printer.OpenElement( "technique_common" );
+    printer.OpenElement( "accessor" );
+    printer.PushAttribute( "source", ( "#" + id + "-positions-array" ).c_str() );
+    printer.PushAttribute( "count", (unsigned) polymesh.vertices.size() );
+    printer.PushAttribute( "stride", 3 );
+    const char* axes[] = { "X", "Y", "Z" };
+    for ( int k = 0; k < 3; ++k ) {
+      printer.OpenElement( "param" );
+      printer.PushAttribute( "name", axes[k] );
+      printer.PushAttribute( "type", "float" );
+      printer.CloseElement();
+    }
+    printer.CloseElement();
+    printer.CloseElement();
+    printer.CloseElement();
+
+    printer.OpenElement( "vertices" );
+    printer.PushAttribute( "id", ( id + "-vertices" ).c_str() );
+    printer.OpenElement( "input" );
+    printer.PushAttribute( "semantic", "POSITION" );
+    printer.PushAttribute( "source", ( "#" + id + "-positions" ).c_str() );
+    printer.CloseElement();
+    printer.CloseElement();
+
+    // polygons
+    vector<size_t> sizes, indices;
+    sizes.reserve( polymesh.polygons.size() );
+    for ( size_t j = 0; j < polymesh.polygons.size(); ++j ) {
+      const vector<size_t>& v = polymesh.polygons[j].vertex_indices;
+      sizes.push_back( v.size() );
+      indices.insert( indices.end(), v.begin(), v.end() );
+    }
+    printer.OpenElement( "polylist" );
+    printer.PushAttribute( "material", ( ids[i] + "-material" ).c_str() );
+    printer.PushAttribute( "count", (unsigned) sizes.size() );
+    printer.OpenElement( "input" );
+    printer.PushAttribute( "semantic", "VERTEX" );
+    printer.PushAttribute( "source", ( "#" + id + "-vertices" ).c_str() );
+    printer.PushAttribute( "offset", 0 );
+    printer.CloseElement();
+    printer.OpenElement( "vcount" ); push_array( printer, sizes   ); printer.CloseElement();
+    printer.OpenElement( "p"      ); push_array( printer, indices ); printer.CloseElement();
+    printer.CloseElement();
+
+    printer.CloseElement();
+    printer.CloseElement();
+  }
+  printer.CloseElement();
+
+  // the scene
+  printer.OpenElement( "library_visual_scenes" );
+  printer.OpenElement( "visual_scene" );
+  printer.PushAttribute( "id",   "scene" );
+  printer.PushAttribute( "name", "scene" );
+  for ( size_t i = 0; i < nodes.size(); ++i ) {
+    const Node& node = nodes[i];
+    if ( !node.instance ) continue;
+
+    printer.OpenElement( "node" );
+    printer.PushAttribute( "id",   ids[i].c_str() );
+    printer.PushAttribute( "name", node.name.c_str() );
+
+    // collada uses row-majored representation
+    vector<double> matrix;
+    for ( int r = 0; r < 4; ++r ) {
+      for ( int c = 0; c < 4; ++c ) {
+        matrix.push_back( node.transform(r,c) );
+      }
+    }
+    printer.OpenElement( "matrix" );
+    printer.PushAttribute( "sid", "transform" );
+    push_array( printer, matrix );
+    printer.CloseElement();
+
+    switch ( node.instance->type ) {
+      case CAMERA:
+        printer.OpenElement( "instance_camera" );
+        printer.PushAttribute( "url", ( "#" + ids[i] + "-camera" ).c_str() );
+        printer.CloseElement();
+        break;
+      case LIGHT:
+        printer.OpenElement( "instance_light" );
+        printer.PushAttribute( "url", ( "#" + ids[i] + "-light" ).c_str() );
+        printer.CloseElement();
+        break;
+      case POLYMESH:
+        printer.OpenElement( "instance_geometry" );
+        printer.PushAttribute( "url", ( "#" + ids[i] + "-mesh" ).c_str() );
+        printer.CloseElement();
+        break;
+      default:
+        break;
+    }
+
+    printer.CloseElement();
+  }
+  printer.CloseElement();
+  printer.CloseElement();
+
+  printer.OpenElement( "scene" );
+  printer.OpenElement( "instance_visual_scene" );
+  printer.PushAttribute( "url", "#scene" );
+  printer.CloseElement();
+  printer.CloseElement();
+
+  printer.CloseElement();
 
+  bool ok = !ferror( file );
+  ok = ( fclose( file ) == 0 ) && ok;
+  return ok ? 0 : -1;
 }
 
 void ColladaParser::parseScene( XMLElement* xml, Scene& scene ) {
@@ -4,7 +4,6 @@
 #include <string>
 #include <vector>
 
-#include "CMU462/CMU462.h"
 #include "CMU462/tinyxml2.h"
 
 #include "scene.h"
@@ -0,0 +1,108 @@
+#include "edgeBatch.h"
+#include "CMU462/trace.h"
+
+namespace CMU462
+{
+   Size EdgeBatch::apply( HalfedgeMesh& mesh, const vector<EdgeIter>& edges, Operation operation )
+   {
+      TRACE_SCOPE( "EdgeBatch::apply" );
+
+      indexVertices( mesh, vertices );
+      reservation.reset( vertices.size() );
+
+      const long n = edges.size();
+      legal.assign( n, 0 );
+      candidate.assign( n, 0 );
+      score.resize( n );
+
+      #pragma omp parallel
+      {
+         vector<Index> region;
+
+         // Test every edge up front, and let the legal ones claim
+         // the vertices their operation touches.
+         #pragma omp for schedule(static)
+         for( long i = 0; i < n; i++ )
+         {
+            EdgeIter e = edges[i];
+            switch( operation )
+            {
+               case FLIP:
+                  legal[i] = canFlip( e );
+                  score[i] = 0.;
+                  if( legal[i] ) edgeQuad( e, region );
+                  break;
+               case SPLIT:
+                  legal[i] = canSplit( e );
+                  score[i] = 1. / e->length();
+                  if( legal[i] ) edgeQuad( e, region );
+                  break;
+               case COLLAPSE:
+                  legal[i] = canCollapse( e );
+                  score[i] = e->length();
+                  if( legal[i] ) edgeNeighborhood( e, region );
+                  break;
+            }
+
+            if( legal[i] )
+            {
+               reservation.reserve( region, VertexReservation::key( score[i], i ) );
+            }
+         }
+
+         // Keep the edges that hold their entire neighborhood.
+         #pragma omp for schedule(static)
+         for( long i = 0; i < n; i++ )
+         {
+            if( legal[i] )
+            {
+               if( operation == COLLAPSE ) edgeNeighborhood( edges[i], region );
+               else                        edgeQuad        ( edges[i], region );
+               candidate[i] = reservation.holds( region, VertexReservation::key( score[i], i ) );
+            }
+         }
+      }
+
+      long nApplied = 0;
+      if( operation == FLIP )
+      {
+         // The winning quads are disjoint, and a flip only rewires
+         // the two triangles on either side of the edge.
+         #pragma omp parallel for schedule(static) reduction(+:nApplied)
+         for( long i = 0; i < n; i++ )
+         {
+            if( candidate[i] )
+            {
+               mesh.flipEdge( edges[i] );
+               nApplied++;
+            }
+         }
+      }
+      else
+      {
+         // Splits and collapses allocate or delete elements, so the
+         // winners are applied in sequence.  Since their neighborhoods
+         // are disjoint, no winner deletes another winning edge.
+         for( long i = 0; i < n; i++ )
+         {
+            if( candidate[i] )
+            {
+               if( operation == SPLIT ) mesh.splitEdge( edges[i] );
+               else                     mesh.collapseEdge( edges[i] );
+               nApplied++;
+            }
+         }
+      }
+
+      nIllegal = 0;
+      nConflicting = 0;
+      for( long i = 0; i < n; i++ )
+      {
+         if( !legal[i] ) nIllegal++;
+         else if( !candidate[i] ) nConflicting++;
+      }
+
+      return nApplied;
+   }
+
+} // namespace CMU462
@@ -0,0 +1,70 @@
+/*
+ * Flips, splits or collapses of many selected edges in one pass.
+ *
+ * An EdgeBatch applies the same local operation to a set of edges (e.g.,
+ * a box or lasso selection).  The batch is processed in three parallel
+ * steps, in the same way as a round of the Remesher:
+ *
+ *  - every edge is tested for legality (see canFlip() and friends), and
+ *    illegal edges are dropped;
+ *
+ *  - the remaining edges claim the vertices their operation touches (the
+ *    quad around the edge for flips and splits, both one-rings for
+ *    collapses) with a VertexReservation, so that only operations with
+ *    disjoint neighborhoods are kept;
+ *
+ *  - the winners are applied: concurrently for flips, which neither
+ *    allocate nor delete elements, and one after the other for splits
+ *    and collapses.
+ *
+ * Edges that lose the reservation are skipped rather than retried, since
+ * a neighboring operation may have changed (or, for collapses, deleted)
+ * them.
+ */
+
+#ifndef CMU462_EDGEBATCH_H
+#define CMU462_EDGEBATCH_H
+
+#include <vector>
+
+#include "halfEdgeMesh.h"
+#include "meshOps.h"
+
+namespace CMU462
+{
+   class EdgeBatch
+   {
+      public:
+         enum Operation
+         {
+            FLIP,
+            SPLIT,    ///< longer edges take precedence
+            COLLAPSE  ///< shorter edges take precedence
+         };
+
+         EdgeBatch( void ) : nIllegal( 0 ), nConflicting( 0 ) {}
+
+         /**
+          * Applies the given operation to as many of the given edges (which
+          * must belong to the given mesh, and be distinct) as possible, and
+          * returns the number of operations applied.  Numbers the vertices of
+          * the mesh as a side effect (see indexVertices()).
+          */
+         Size apply( HalfedgeMesh& mesh, const vector<EdgeIter>& edges, Operation operation );
+
+         // Edges skipped by the last call to apply().
+         Size nIllegal;     ///< the operation was not legal
+         Size nConflicting; ///< the operation overlapped one that took precedence
+
+      protected:
+         // Scratch space, kept around to avoid reallocation.
+         VertexReservation reservation;
+         vector<VertexIter> vertices;
+         vector<char> legal;
+         vector<char> candidate;
+         vector<float> score;
+   };
+
+} // namespace CMU462
+
+#endif // CMU462_EDGEBATCH_H
@@ -0,0 +1,165 @@
+#include "edgeFlipper.h"
+
+#include <cstdlib>
+#include <limits>
+
+namespace CMU462
+{
+   Size EdgeFlipper::flipToValence( HalfedgeMesh& mesh )
+   {
+      begin( mesh, VALENCE );
+      while( !step( numeric_limits<Size>::max() ) );
+      return nFlips();
+   }
+
+   Size EdgeFlipper::flipToDelaunay( HalfedgeMesh& mesh )
+   {
+      begin( mesh, DELAUNAY );
+      while( !step( numeric_limits<Size>::max() ) );
+      return nFlips();
+   }
+
+   void EdgeFlipper::enqueue( EdgeIter e )
+   {
+      if( !queued[ e->index ] )
+      {
+         queued[ e->index ] = 1;
+         queue.push_back( e );
+      }
+   }
+
+   // Returns the cotangent of the angle at vertex c of triangle abc.
+   static double cotan( const Vector3D& a, const Vector3D& b, const Vector3D& c )
+   {
+      Vector3D u = a - c;
+      Vector3D v = b - c;
+      double s = cross( u, v ).norm();
+      if( s == 0. ) return 0.;
+      return dot( u, v ) / s;
+   }
+
+   bool EdgeFlipper::improves( EdgeIter e ) const
+   {
+      HalfedgeIter h0 = e->halfedge();
+      HalfedgeIter h1 = h0->twin();
+      if( h0->isBoundary() || h1->isBoundary() ) return false;
+
+      VertexIter a = h0->vertex();
+      VertexIter b = h1->vertex();
+      VertexIter c = h0->next()->next()->vertex();
+      VertexIter d = h1->next()->next()->vertex();
+
+      if( criterion == VALENCE )
+      {
+         // The endpoints each lose an edge, and the opposite vertices each gain one.
+         const Index v[4] = { a->index, b->index, c->index, d->index };
+         const int change[4] = { -1, -1, 1, 1 };
+
+         int before = 0, after = 0;
+         for( int i = 0; i < 4; i++ )
+         {
+            int target = boundary[v[i]] ? 4 : 6;
+            before += abs( valences[v[i]] - target );
+            after  += abs( valences[v[i]] + change[i] - target );
+         }
+         return after < before;
+      }
+
+      // The opposite angles sum to more than pi if and only if the sum of
+      // their cotangents is negative; a small tolerance keeps (nearly)
+      // cocircular quads from being flipped back and forth.
+      double cotSum = cotan( a->position, b->position, c->position ) +
+                      cotan( a->position, b->position, d->position );
+      return cotSum < -1e-9;
+   }
+
+   void EdgeFlipper::begin( HalfedgeMesh& _mesh, Criterion _criterion )
+   {
+      mesh = &_mesh;
+      criterion = _criterion;
+      flips = 0;
+
+      indexVertices( *mesh, vertices );
+      indexEdges( *mesh, edges );
+
+      // Flips neither create nor delete elements, so these numberings
+      // (and the boundary flags) stay valid for the whole pass.
+      valences.resize( vertices.size() );
+      boundary.resize( vertices.size() );
+      for( Index i = 0; i < vertices.size(); i++ )
+      {
+         valences[i] = valence( vertices[i] );
+         boundary[i] = vertices[i]->isBoundary();
+      }
+
+      queue.clear();
+      queued.assign( edges.size(), 0 );
+      for( Index i = 0; i < edges.size(); i++ )
+      {
+         if( improves( edges[i] ) )
+         {
+            enqueue( edges[i] );
+         }
+      }
+
+      maxFlips = maxFlipsPerEdge * edges.size();
+   }
+
+   bool EdgeFlipper::step( Size maxEdges )
+   {
+      for( Size n = 0; n < maxEdges && !queue.empty() && flips < maxFlips; n++ )
+      {
+         EdgeIter e = queue.front();
+         queue.pop_front();
+         queued[ e->index ] = 0;
+
+         // The neighborhood may have changed since e was queued.
+         if( !improves( e ) || !canFlip( e ) ) continue;
+
+         HalfedgeIter h0 = e->halfedge();
+         HalfedgeIter h1 = h0->twin();
+         VertexIter a = h0->vertex();
+         VertexIter b = h1->vertex();
+         VertexIter c = h0->next()->next()->vertex();
+         VertexIter d = h1->next()->next()->vertex();
+         EdgeIter quad[4] = { h0->next()->edge(), h0->next()->next()->edge(),
+                              h1->next()->edge(), h1->next()->next()->edge() };
+
+         mesh->flipEdge( e );
+         flips++;
+
+         valences[ a->index ]--;
+         valences[ b->index ]--;
+         valences[ c->index ]++;
+         valences[ d->index ]++;
+
+         if( criterion == DELAUNAY )
+         {
+            // Only the angles opposite the four edges of the quad changed.
+            for( int i = 0; i < 4; i++ )
+            {
+               if( improves( quad[i] ) ) enqueue( quad[i] );
+            }
+         }
+         else
+         {
+            // The valences of all four vertices changed, which affects
+            // every edge touching one of them.
+            VertexIter touched[4] = { a, b, c, d };
+            for( int i = 0; i < 4; i++ )
+            {
+               HalfedgeIter h = touched[i]->halfedge();
+               do
+               {
+                  if( improves( h->edge() ) ) enqueue( h->edge() );
+                  h = h->twin()->next();
+               }
+               while( h != touched[i]->halfedge() );
+            }
+         }
+      }
+
+      return queue.empty() || flips >= maxFlips;
+   }
+
+} // namespace CMU462
@@ -0,0 +1,85 @@
+/*
+ * Worklist-driven edge flipping.
+ *
+ * Rather than sweeping over every edge until nothing changes, the
+ * EdgeFlipper keeps a queue of edges that might benefit from a flip.
+ * Every edge is examined once to seed the queue; after that, only edges
+ * near a flip are re-examined: the four edges of the flipped quad for
+ * the Delaunay criterion, and the edges touching any of its four
+ * vertices for the valence criterion.  Vertex valences are cached and
+ * updated incrementally, so the valence test for an edge takes constant
+ * time.
+ */
+
+#ifndef CMU462_EDGEFLIPPER_H
+#define CMU462_EDGEFLIPPER_H
+
+#include <deque>
+#include <vector>
+
+#include "halfEdgeMesh.h"
+#include "meshOps.h"
+
+namespace CMU462
+{
+   class EdgeFlipper
+   {
+      public:
+         enum Criterion
+         {
+            VALENCE,  ///< bring the valences of the four vertices involved closer to 6 (or 4, for boundary vertices)
+            DELAUNAY  ///< make the two angles opposite each interior edge sum to at most pi
+         };
+
+         EdgeFlipper( void ) : maxFlipsPerEdge( 10 ), mesh( NULL ), criterion( VALENCE ), flips( 0 ), maxFlips( 0 ) {}
+
+         /**
+          * Flips edges until no flip brings the valences of the four
+          * vertices involved closer to 6 (or 4, for boundary vertices).
+          * Returns the number of flips performed.
+          */
+         Size flipToValence( HalfedgeMesh& mesh );
+
+         /**
+          * Flips edges until every interior edge satisfies the Delaunay
+          * condition: the two angles opposite the edge sum to at most pi.
+          * Returns the number of flips performed.
+          */
+         Size flipToDelaunay( HalfedgeMesh& mesh );
+
+         /*
+          * Incremental interface, for running a pass a little at a time:
+          * begin() seeds the queue, and each call to step() examines at most
+          * the given number of queued edges, returning true once the pass is
+          * done.
+          * The mesh must not be modified by anyone else in between.
+          */
+         void begin( HalfedgeMesh& mesh, Criterion criterion );
+         bool step( Size maxEdges );
+         Size nFlips( void ) const { return flips; }          ///< flips performed since begin()
+         Size nQueued( void ) const { return queue.size(); }  ///< edges still waiting to be examined
+
+         /// On a curved surface, Delaunay flips are not guaranteed to terminate;
+         /// each pass performs at most this many flips per edge of the mesh.
+         Size maxFlipsPerEdge;
+
+      protected:
+         bool improves( EdgeIter e ) const; ///< would flipping e improve the mesh under the current criterion?
+         void enqueue( EdgeIter e );
+
+         HalfedgeMesh* mesh;
+         Criterion criterion;
+         Size flips;
+         Size maxFlips;
+
+         deque<EdgeIter> queue;
+         vector<char> queued;      ///< per edge: is the edge currently in the queue?
+         vector<VertexIter> vertices;
+         vector<EdgeIter> edges;
+         vector<int> valences;     ///< per vertex: cached valence
+         vector<char> boundary;    ///< per vertex: is the vertex on the boundary?
+   };
+
+} // namespace CMU462
+
+#endif // CMU462_EDGEFLIPPER_H
@@ -0,0 +1,509 @@
+#include "faceBVH.h"
+#include "CMU462/trace.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace CMU462
+{
+   // Largest number of faces placed in a leaf by build().
+   static const Size maxLeafSize = 4;
+
+   // Number of slots per leaf; the spare slots let faces be inserted
+   // into a leaf without moving the faces of any other leaf.
+   static const Size leafCapacity = 8;
+
+   // Depth beyond which insertion rebuilds the whole hierarchy rather than
+   // splitting a leaf (which also bounds the traversal stack in intersect()).
+   static const Index maxDepth = 48;
+
+   void FaceBVH::build( HalfedgeMesh& mesh )
+   {
+      TRACE_SCOPE( "FaceBVH::build" );
+
+      vector<FaceIter> f;
+      f.reserve( mesh.nFaces() );
+      for( FaceIter i = mesh.facesBegin(); i != mesh.facesEnd(); i++ )
+      {
+         f.push_back( i );
+      }
+
+      build( f );
+   }
+
+   void FaceBVH::clear( void )
+   {
+      nodes.clear();
+      faces.clear();
+      blockLeaf.clear();
+      slots.clear();
+      area = builtArea = 0.;
+   }
+
+   void FaceBVH::build( vector<FaceIter>& f )
+   {
+      clear();
+      if( f.empty() ) return;
+
+      vector<BBox> boxes( f.size() );
+      vector<Vector3D> centroids( f.size() );
+      for( Index i = 0; i < f.size(); i++ )
+      {
+         boxes[i] = faceBox( f[i] );
+         centroids[i] = boxes[i].centroid();
+      }
+
+      nodes.reserve( 2 * f.size() / maxLeafSize + 1 );
+      faces.reserve( leafCapacity * ( f.size() / maxLeafSize + 1 ) );
+      slots.reserve( f.size() );
+      buildNode( 0, f.size(), 0, f, boxes, centroids );
+
+      builtArea = area;
+   }
+
+   Index FaceBVH::buildNode( Index start, Index end, Index parent, vector<FaceIter>& f, vector<BBox>& boxes, vector<Vector3D>& centroids )
+   {
+      if( end - start <= maxLeafSize )
+      {
+         Index n = newLeaf( parent );
+         Node& leaf = nodes[n];
+         BBox box;
+         for( Index i = start; i < end; i++ )
+         {
+            Index slot = leaf.block * leafCapacity + leaf.count++;
+            faces[slot] = f[i];
+            slots[ &*f[i] ] = slot;
+            box.expand( boxes[i] );
+         }
+         setBox( n, box );
+         return n;
+      }
+
+      Index n = nodes.size();
+      nodes.push_back( Node() );
+      nodes[n].parent = parent;
+      nodes[n].count = 0;
+
+      BBox box, centroidBox;
+      for( Index i = start; i < end; i++ )
+      {
+         box.expand( boxes[i] );
+         centroidBox.expand( centroids[i] );
+      }
+      setBox( n, box );
+
+      // Median split along the longest axis of the centroids' bounds,
+      // permuting the faces, boxes, and centroids together.
+      int axis = centroidBox.longestAxis();
+      Index mid = ( start + end ) / 2;
+
+      vector<Index> order( end - start );
+      for( Index i = 0; i < order.size(); i++ ) order[i] = start + i;
+      nth_element( order.begin(), order.begin() + ( mid - start ), order.end(),
+                   [&]( Index a, Index b ) { return centroids[a][axis] < centroids[b][axis]; } );
+
+      vector<FaceIter> tf( end - start );
+      vector<BBox> tb( end - start );
+      vector<Vector3D> tc( end - start );
+      for( Index i = 0; i < order.size(); i++ )
+      {
+         tf[i] = f[ order[i] ];
+         tb[i] = boxes[ order[i] ];
+         tc[i] = centroids[ order[i] ];
+      }
+      copy( tf.begin(), tf.end(), f.begin() + start );
+      copy( tb.begin(), tb.end(), boxes.begin() + start );
+      copy( tc.begin(), tc.end(), centroids.begin() + start );
+
+      Index left = buildNode( start, mid, n, f, boxes, centroids );
+      Index right = buildNode( mid, end, n, f, boxes, centroids );
+      nodes[n].left = left;
+      nodes[n].right = right;
+
+      return n;
+   }
+
+   Index FaceBVH::newLeaf( Index parent )
+   {
+      Index n = nodes.size();
+      nodes.push_back( Node() );
+      nodes[n].parent = parent;
+      nodes[n].left = 0;
+      nodes[n].right = 0;
+      nodes[n].block = blockLeaf.size();
+      nodes[n].count = 0;
+
+      blockLeaf.push_back( n );
+      faces.resize( faces.size() + leafCapacity );
+
+      return n;
+   }
+
+   bool FaceBVH::intersect( const Vector3D& o, const Vector3D& d, FaceIter& face, double& t, Vector3D& barycentric ) const
+   {
+      if( nodes.empty() ) return false;
+
+      // (Division by zero gives an infinite inverse, which the slab test handles.)
+      Vector3D invD( 1. / d.x, 1. / d.y, 1. / d.z );
+
+      bool hit = false;
+      double tBest = numeric_limits<double>::max();
+
+      // Depth-first traversal, visiting the nearer child first, and
+      // skipping any node whose box starts beyond the closest hit.
+      Index stack[ maxDepth + 2 ];
+      int top = 0;
+      stack[top++] = 0;
+
+      while( top > 0 )
+      {
+         Index n = stack[--top];
+         const Node& node = nodes[n];
+
+         double tEnter;
+         if( !node.box.intersect( o, invD, 0., tBest, tEnter ) ) continue;
+
+         if( node.left == 0 )
+         {
+            Index first = node.block * leafCapacity;
+            for( Index i = first; i < first + node.count; i++ )
+            {
+               // Test each triangle of a fan around the first vertex.
+               HalfedgeIter h0 = faces[i]->halfedge();
+               HalfedgeIter h = h0->next();
+               bool firstTriangle = true;
+               while( h->next() != h0 )
+               {
+                  double tHit;
+                  Vector3D b;
+                  if( intersectTriangle( o, d, h0->vertex()->position,
+                                               h->vertex()->position,
+                                               h->next()->vertex()->position,
+                                         tBest, tHit, b ) )
+                  {
+                     hit = true;
+                     tBest = tHit;
+                     face = faces[i];
+                     barycentric = firstTriangle ? b : Vector3D( 1./3., 1./3., 1./3. );
+                  }
+                  h = h->next();
+                  firstTriangle = false;
+               }
+            }
+            continue;
+         }
+
+         Index left = node.left;
+         Index right = node.right;
+         double tLeft, tRight;
+         bool hitLeft  = nodes[left ].box.intersect( o, invD, 0., tBest, tLeft  );
+         bool hitRight = nodes[right].box.intersect( o, invD, 0., tBest, tRight );
+
+         // Push the farther child first, so that the nearer one is popped next.
+         if( hitLeft && hitRight )
+         {
+            if( tLeft <= tRight ) { stack[top++] = right; stack[top++] = left;  }
+            else                  { stack[top++] = left;  stack[top++] = right; }
+         }
+         else if( hitLeft  ) stack[top++] = left;
+         else if( hitRight ) stack[top++] = right;
+      }
+
+      t = tBest;
+      return hit;
+   }
+
+   void FaceBVH::insert( FaceIter f )
+   {
+      if( f->isBoundary() || contains( f ) ) return;
+
+      if( nodes.empty() )
+      {
+         newLeaf( 0 );
+      }
+
+      // Descend toward the child whose box grows the least (in surface
+      // area) to contain the new face, splitting any full leaf on the way.
+      BBox box = faceBox( f );
+      Index n = 0;
+      while( true )
+      {
+         if( nodes[n].left == 0 )
+         {
+            if( nodes[n].count < leafCapacity ) break;
+
+            if( depth( n ) >= maxDepth )
+            {
+               // Too many insertions into one region; start over.
+               vector<FaceIter> all;
+               all.reserve( slots.size() + 1 );
+               for( Index b = 0; b < blockLeaf.size(); b++ )
+               {
+                  const Node& leaf = nodes[ blockLeaf[b] ];
+                  for( Index i = 0; i < leaf.count; i++ ) all.push_back( faces[ b * leafCapacity + i ] );
+               }
+               all.push_back( f );
+               build( all );
+               return;
+            }
+
+            splitLeaf( n );
+         }
+
+         BBox l = nodes[ nodes[n].left  ].box; l.expand( box );
+         BBox r = nodes[ nodes[n].right ].box; r.expand( box );
+         double growLeft  = l.area() - nodes[ nodes[n].left  ].box.area();
+         double growRight = r.area() - nodes[ nodes[n].right ].box.area();
+         n = ( growLeft <= growRight ) ? nodes[n].left : nodes[n].right;
+      }
+
+      Node& leaf = nodes[n];
+      Index slot = leaf.block * leafCapacity + leaf.count++;
+      faces[slot] = f;
+      slots[ &*f ] = slot;
+
+      refitFrom( n );
+   }
+
+   void FaceBVH::remove( FaceIter f )
+   {
+      unordered_map<const Face*,Index>::iterator s = slots.find( &*f );
+      if( s == slots.end() ) return;
+
+      Index slot = s->second;
+      slots.erase( s );
+
+      // Fill the hole with the last face of the leaf.
+      Index n = blockLeaf[ slot / leafCapacity ];
+      Node& leaf = nodes[n];
+      Index last = leaf.block * leafCapacity + leaf.count - 1;
+      if( slot != last )
+      {
+         faces[slot] = faces[last];
+         slots[ &*faces[slot] ] = slot;
+      }
+      faces[last] = FaceIter();
+      leaf.count--;
+
+      refitFrom( n );
+   }
+
+   void FaceBVH::splitLeaf( Index n )
+   {
+      // Split the faces at the median centroid along the longest axis
+      // of the centroids' bounds, as in build().  The left child keeps
+      // the leaf's block of slots.
+      Index first = nodes[n].block * leafCapacity;
+      Index count = nodes[n].count;
+
+      vector<FaceIter> f( faces.begin() + first, faces.begin() + first + count );
+      vector<Vector3D> centroids( count );
+      BBox centroidBox;
+      for( Index i = 0; i < count; i++ )
+      {
+         centroids[i] = faceBox( f[i] ).centroid();
+         centroidBox.expand( centroids[i] );
+      }
+
+      int axis = centroidBox.longestAxis();
+      vector<Index> order( count );
+      for( Index i = 0; i < count; i++ ) order[i] = i;
+      nth_element( order.begin(), order.begin() + count/2, order.end(),
+                   [&]( Index a, Index b ) { return centroids[a][axis] < centroids[b][axis]; } );
+
+      Index block = nodes[n].block;
+      Index left = nodes.size();
+      nodes.push_back( Node() );
+      nodes[left].parent = n;
+      nodes[left].left = 0;
+      nodes[left].right = 0;
+      nodes[left].block = block;
+      nodes[left].count = 0;
+      blockLeaf[block] = left;
+      Index right = newLeaf( n );
+
+      for( Index i = 0; i < count; i++ )
+      {
+         Node& child = nodes[ i < count/2 ? left : right ];
+         Index slot = child.block * leafCapacity + child.count++;
+         faces[slot] = f[ order[i] ];
+         slots[ &*faces[slot] ] = slot;
+      }
+      for( Index i = nodes[left].count; i < leafCapacity; i++ )
+      {
+         faces[ first + i ] = FaceIter();
+      }
+
+      nodes[n].left = left;
+      nodes[n].right = right;
+      nodes[n].count = 0;
+
+      setBox( left,  leafBox( left  ) );
+      setBox( right, leafBox( right ) );
+   }
+
+   Index FaceBVH::depth( Index n ) const
+   {
+      Index d = 0;
+      while( n != 0 )
+      {
+         n = nodes[n].parent;
+         d++;
+      }
+      return d;
+   }
+
+   void FaceBVH::refit( VertexIter v )
+   {
+      HalfedgeIter h = v->halfedge();
+      do
+      {
+         FaceIter f = h->face();
+         unordered_map<const Face*,Index>::const_iterator s = slots.find( &*f );
+         if( s != slots.end() )
+         {
+            refitFrom( blockLeaf[ s->second / leafCapacity ] );
+         }
+         h = h->twin()->next();
+      }
+      while( h != v->halfedge() );
+   }
+
+   void FaceBVH::beginEdit( EdgeIter e )
+   {
+      editBoundary.clear();
+
+      VertexIter ends[2] = { e->halfedge()->vertex(), e->halfedge()->twin()->vertex() };
+      for( int k = 0; k < 2; k++ )
+      {
+         HalfedgeIter h = ends[k]->halfedge();
+         do
+         {
+            FaceIter f = h->face();
+            if( !f->isBoundary() )
+            {
+               // Remember the vertices of the face, other than the endpoints.
+               HalfedgeIter g = f->halfedge();
+               do
+               {
+                  VertexIter u = g->vertex();
+                  if( u != ends[0] && u != ends[1] ) editBoundary.push_back( u );
+                  g = g->next();
+               }
+               while( g != f->halfedge() );
+
+               remove( f );
+            }
+            h = h->twin()->next();
+         }
+         while( h != ends[k]->halfedge() );
+      }
+   }
+
+   void FaceBVH::endEdit( void )
+   {
+      // Every face created or modified by the operation touches at least
+      // one of the remembered vertices; faces that are already in the
+      // hierarchy are skipped by insert().
+      for( Index i = 0; i < editBoundary.size(); i++ )
+      {
+         VertexIter u = editBoundary[i];
+         HalfedgeIter h = u->halfedge();
+         do
+         {
+            insert( h->face() );
+            h = h->twin()->next();
+         }
+         while( h != u->halfedge() );
+      }
+
+      editBoundary.clear();
+   }
+
+   bool FaceBVH::degraded( void ) const
+   {
+      return area > rebuildRatio * builtArea;
+   }
+
+   void FaceBVH::setBox( Index n, const BBox& box )
+   {
+      area += box.area() - nodes[n].box.area();
+      nodes[n].box = box;
+   }
+
+   void FaceBVH::refitFrom( Index n )
+   {
+      while( true )
+      {
+         BBox box;
+         if( nodes[n].left == 0 )
+         {
+            box = leafBox( n );
+         }
+         else
+         {
+            box.expand( nodes[ nodes[n].left  ].box );
+            box.expand( nodes[ nodes[n].right ].box );
+         }
+
+         if( box == nodes[n].box ) return;
+         setBox( n, box );
+
+         if( n == 0 ) return;
+         n = nodes[n].parent;
+      }
+   }
+
+   BBox FaceBVH::leafBox( Index n ) const
+   {
+      BBox box;
+      Index first = nodes[n].block * leafCapacity;
+      for( Index i = first; i < first + nodes[n].count; i++ )
+      {
+         box.expand( faceBox( faces[i] ) );
+      }
+      return box;
+   }
+
+   BBox faceBox( FaceCIter f )
+   {
+      BBox box;
+      HalfedgeCIter h = f->halfedge();
+      do
+      {
+         box.expand( h->vertex()->position );
+         h = h->next();
+      }
+      while( h != f->halfedge() );
+      return box;
+   }
+
+   bool intersectTriangle( const Vector3D& o, const Vector3D& d,
+                           const Vector3D& a, const Vector3D& b, const Vector3D& c,
+                           double tMax, double& t, Vector3D& barycentric )
+   {
+      // Moller-Trumbore: solve o + t*d = a + v*(b-a) + w*(c-a) by Cramer's rule.
+      Vector3D e1 = b - a;
+      Vector3D e2 = c - a;
+      Vector3D p = cross( d, e2 );
+      double det = dot( e1, p );
+      if( fabs( det ) < 1e-20 ) return false; // ray parallel to the triangle
+
+      double invDet = 1. / det;
+      Vector3D s = o - a;
+      double v = dot( s, p ) * invDet;
+      if( v < 0. || v > 1. ) return false;
+
+      Vector3D q = cross( s, e1 );
+      double w = dot( d, q ) * invDet;
+      if( w < 0. || v + w > 1. ) return false;
+
+      double tHit = dot( e2, q ) * invDet;
+      if( tHit <= 0. || tHit >= tMax ) return false;
+
+      t = tHit;
+      barycentric = Vector3D( 1. - v - w, v, w );
+      return true;
+   }
+
+} // namespace CMU462
@@ -0,0 +1,146 @@
+/*
+ * Bounding volume hierarchy over the faces of a HalfedgeMesh.
+ *
+ * Unlike the AABBTree (which stores a frozen copy of its triangles), a
+ * FaceBVH refers to the live faces of a mesh, and reads vertex positions
+ * from the mesh whenever it is queried.  It is used to pick the face
+ * under the cursor by casting a ray into the scene, which takes time
+ * roughly logarithmic in the number of faces rather than linear.
+ *
+ * The hierarchy can follow edits to the mesh at a cost proportional to
+ * the size of the edit, rather than that of the mesh:
+ *
+ *    - after moving a vertex, call refit() to update the bounding boxes
+ *      of the faces around it (and of their ancestors);
+ *
+ *    - around a local operation on an edge (flip, split, or collapse),
+ *      call beginEdit() before and endEdit() after the operation, which
+ *      remove the faces the operation may modify, then insert the faces
+ *      that it has created or modified.
+ *
+ * Incremental edits gradually make the hierarchy less efficient; once
+ * degraded() returns true, the hierarchy should be rebuilt from scratch.
+ */
+
+#ifndef CMU462_FACEBVH_H
+#define CMU462_FACEBVH_H
+
+#include <unordered_map>
+#include <vector>
+
+#include "halfEdgeMesh.h"
+#include "bbox.h"
+
+namespace CMU462
+{
+   class FaceBVH
+   {
+      public:
+         FaceBVH( void ) : rebuildRatio( 1.5 ), area( 0. ), builtArea( 0. ) {}
+
+         /**
+          * Builds a hierarchy over all (non-boundary) faces of the given
+          * mesh, replacing any previous contents.
+          */
+         void build( HalfedgeMesh& mesh );
+
+         void clear( void );
+         bool empty( void ) const { return slots.empty(); }
+         Size size( void ) const { return slots.size(); } ///< number of faces in the hierarchy
+
+         /**
+          * Finds the first face hit by the ray o + t*d with t > 0.  If there
+          * is one, returns true, and sets face to the face that was hit, t
+          * to the ray parameter of the hit, and barycentric to the weights
+          * of the hit point with respect to the first three vertices of
+          * the face (or to (1/3,1/3,1/3), for a hit on some other part of
+          * a polygon with more than three sides).
+          */
+         bool intersect( const Vector3D& o, const Vector3D& d, FaceIter& face, double& t, Vector3D& barycentric ) const;
+
+         void insert( FaceIter f ); ///< adds a face to the hierarchy
+         void remove( FaceIter f ); ///< removes a face from the hierarchy (if present)
+         bool contains( FaceIter f ) const { return slots.count( &*f ) != 0; }
+
+         /**
+          * Updates the bounds of every face incident on v, after v has moved.
+          */
+         void refit( VertexIter v );
+
+         /*
+          * Brackets a local operation on the edge e, which may only create,
+          * delete, or modify faces incident on the endpoints of e (as is the
+          * case for flipEdge(), splitEdge() and collapseEdge()).  Before the
+          * operation, beginEdit() removes those faces, and remembers the
+          * vertices surrounding them (which the operation leaves in place).
+          * Afterwards, endEdit() inserts every face incident on those
+          * vertices that is missing from the hierarchy.
+          */
+         void beginEdit( EdgeIter e );
+         void endEdit( void );
+
+         /**
+          * Returns true once edits have made the hierarchy much less
+          * efficient than it was when it was built, i.e., once the total
+          * surface area of the nodes has grown by more than rebuildRatio.
+          */
+         bool degraded( void ) const;
+
+         double rebuildRatio; ///< growth in surface area after which degraded() returns true
+
+      protected:
+         /*
+          * Nodes refer to their children and parent by index; the root is
+          * node 0, so a node whose left child is 0 is a leaf.  Each leaf
+          * owns a block of slots in the faces array, of which the first
+          * count are in use; slots records the slot holding each face.
+          */
+         struct Node
+         {
+            BBox box;
+            Index parent; ///< parent node (unused for the root)
+            Index left;   ///< left child, or 0 for a leaf
+            Index right;  ///< right child (interior nodes only)
+            Index block;  ///< block of slots (leaves only)
+            Index count;  ///< number of slots in use (leaves only)
+         };
+
+         void build( vector<FaceIter>& f );
+         Index buildNode( Index start, Index end, Index parent, vector<FaceIter>& f, vector<BBox>& boxes, vector<Vector3D>& centroids );
+         Index newLeaf( Index parent );
+         void splitLeaf( Index n );
+         Index depth( Index n ) const;
+
+         void setBox( Index n, const BBox& box ); ///< updates a node's box, and the total area
+         void refitFrom( Index n ); ///< recomputes boxes from node n up to the root, stopping early once one is unchanged
+         BBox leafBox( Index n ) const;
+
+         vector<Node> nodes;
+         vector<FaceIter> faces;  ///< slots, grouped into blocks of fixed size
+         vector<Index> blockLeaf; ///< leaf that owns each block
+         unordered_map<const Face*,Index> slots;
+
+         double area;      ///< total surface area of all node boxes
+         double builtArea; ///< value of area just after the last build
+
+         vector<VertexIter> editBoundary; ///< vertices remembered by beginEdit()
+   };
+
+   /**
+    * Returns the bounding box of a face.
+    */
+   BBox faceBox( FaceCIter f );
+
+   /**
+    * Intersects the ray o + t*d with triangle abc.  If the ray hits the
+    * triangle at some t in (0,tMax), returns true and sets t and the
+    * barycentric coordinates (u,v,w) of the hit point (with respect to
+    * a, b, and c, respectively).
+    */
+   bool intersectTriangle( const Vector3D& o, const Vector3D& d,
+                           const Vector3D& a, const Vector3D& b, const Vector3D& c,
+                           double tMax, double& t, Vector3D& barycentric );
+
+} // namespace CMU462
+
+#endif // CMU462_FACEBVH_H
@@ -1,4 +1,5 @@
 #include "halfEdgeMesh.h"
+#include "CMU462/trace.h"
 
 namespace CMU462 {
 
@@ -51,6 +52,8 @@ namespace CMU462 {
    // lowest index appearing in any polygon corresponds to the first entry of the list
    // of positions and so on).
    {
+      TRACE_SCOPE( "HalfedgeMesh::build" );
+
       // define some types, to improve readability
       typedef vector<Index> IndexList;
       typedef IndexList::const_iterator IndexListCIter;
@@ -448,4 +451,17 @@ namespace CMU462 {
       *this = mesh;
    }
 
+   size_t HalfedgeMesh :: estimateSize( Size nVertices, Size nFaces, Size nCorners )
+   // Every corner of a polygon is the start of one halfedge, and every edge has two
+   // halfedges (boundary halfedges and faces are ignored).  Each element is stored in
+   // its own list node, behind a pair of links.
+   {
+      const size_t link = 2 * sizeof( void* );
+
+      return nVertices       * ( sizeof( Vertex   ) + link ) +
+             nFaces          * ( sizeof( Face     ) + link ) +
+             nCorners        * ( sizeof( Halfedge ) + link ) +
+             ( nCorners / 2 ) * ( sizeof( Edge     ) + link );
+   }
+
 } // End of CMU 462 namespace.
@@ -146,7 +146,8 @@
 #include <utility>
 #include <iostream>
 
-#include "CMU462/CMU462.h" // Standard 462 Vectors, etc.
+#include "CMU462/vector3D.h" // Standard 462 Vectors, etc.
+#include "CMU462/matrix4x4.h"
 
 #include "mesh.h"
 
@@ -404,6 +405,8 @@ namespace CMU462
 
          Matrix4x4 quadric;
 
+         Index index; ///< scratch index, assigned by algorithms that need to number the faces (e.g., to run a parallel loop over them)
+
       protected:
          HalfedgeIter _halfedge; ///< one of the halfedges of this face
          bool _isBoundary;       ///< boundary flag
@@ -492,6 +495,8 @@ namespace CMU462
 
         Matrix4x4 quadric;
 
+        Index index; ///< scratch index, assigned by algorithms that need to number the vertices (e.g., to run a parallel loop over them)
+
       protected:
          HalfedgeIter _halfedge; ///< one of the halfedges "rooted" or "based" at this vertex
    };
@@ -525,6 +530,8 @@ namespace CMU462
 
          EdgeRecord record;
 
+         Index index; ///< scratch index, assigned by algorithms that need to number the edges (e.g., to run a parallel loop over them)
+
       protected:
          HalfedgeIter _halfedge; ///< one of the two halfedges associated with this edge
    };
@@ -561,6 +568,27 @@ namespace CMU462
           */
          void build( const vector< vector<Index> >& polygons, const vector<Vector3D>& vertexPositions );
 
+         /**
+          * Exchanges the contents of this mesh with those of another mesh in constant
+          * time.  Unlike assignment, no elements are copied: every iterator remains
+          * valid, but refers to an element of the other mesh after the swap.
+          */
+         void swap( HalfedgeMesh& mesh )
+         {
+            halfedges.swap( mesh.halfedges );
+             vertices.swap( mesh.vertices );
+                edges.swap( mesh.edges );
+                faces.swap( mesh.faces );
+           boundaries.swap( mesh.boundaries );
+         }
+
+         /**
+          * Estimates the number of bytes taken by the elements of a mesh built from polygons
+          * with the given number of vertices, faces, and corners (i.e., the sum of the polygon
+          * degrees), e.g., to decide whether a mesh will fit in memory before building it.
+          */
+         static size_t estimateSize( Size nVertices, Size nFaces, Size nCorners );
+
          // These methods return the total number of elements of each type.
          Size nHalfedges  ( void ) const { return  halfedges.size(); } ///< get the number of halfedges
          Size nVertices   ( void ) const { return   vertices.size(); } ///< get the number of vertices
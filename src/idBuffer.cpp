@@ -0,0 +1,187 @@
+#include "idBuffer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace CMU462
+{
+   // Side length of a tile, in image pixels.
+   static const int tileSize = 32;
+
+   // ID of an empty pixel.
+   static const uint32_t noID = 0xffffffff;
+
+   void IDBuffer::render( const vector<const ScreenProjection*>& meshes, size_t screenWidth, size_t screenHeight )
+   {
+      width  = ( screenWidth  + downsample - 1 ) / downsample;
+      height = ( screenHeight + downsample - 1 ) / downsample;
+      tilesX = ( width  + tileSize - 1 ) / tileSize;
+      tilesY = ( height + tileSize - 1 ) / tileSize;
+
+      ids.assign( width * height, noID );
+      depth.assign( width * height, numeric_limits<float>::max() );
+
+      // Keep the bins' storage from one frame to the next.
+      bins.resize( tilesX * tilesY );
+      for( Index i = 0; i < bins.size(); i++ ) bins[i].clear();
+
+      meshOf.clear();
+      triangleOf.clear();
+      this->meshes = meshes;
+
+      // Sort the triangles into the tiles their bounding boxes overlap.
+      const double scale = 1. / downsample;
+      for( Index m = 0; m < meshes.size(); m++ )
+      {
+         const ScreenProjection& mesh( *meshes[m] );
+         const double* x = mesh.x();
+         const double* y = mesh.y();
+         const double* z = mesh.z();
+         const double* w = mesh.w();
+
+         for( Index t = 0; t < mesh.nTriangles(); t++ )
+         {
+            const Index* v = mesh.triangle( t );
+            if( w[v[0]] <= 0. || w[v[1]] <= 0. || w[v[2]] <= 0. ) continue;
+            if( z[v[0]] < -1. || z[v[1]] < -1. || z[v[2]] < -1. ) continue;
+            if( z[v[0]] >  1. && z[v[1]] >  1. && z[v[2]] >  1. ) continue;
+
+            double x0 = scale * min( x[v[0]], min( x[v[1]], x[v[2]] ) );
+            double x1 = scale * max( x[v[0]], max( x[v[1]], x[v[2]] ) );
+            double y0 = scale * min( y[v[0]], min( y[v[1]], y[v[2]] ) );
+            double y1 = scale * max( y[v[0]], max( y[v[1]], y[v[2]] ) );
+            if( x1 < 0. || y1 < 0. || x0 >= width || y0 >= height ) continue;
+
+            // (Clamp before converting, since vertices near the eye
+            // can project arbitrarily far off the screen.)
+            int tx0 = int( max( 0., x0 ) ) / tileSize, tx1 = int( min( width  - 1., x1 ) ) / tileSize;
+            int ty0 = int( max( 0., y0 ) ) / tileSize, ty1 = int( min( height - 1., y1 ) ) / tileSize;
+
+            uint32_t id = meshOf.size();
+            meshOf.push_back( m );
+            triangleOf.push_back( t );
+
+            for( int ty = ty0; ty <= ty1; ty++ )
+            for( int tx = tx0; tx <= tx1; tx++ )
+            {
+               bins[ ty*tilesX + tx ].push_back( id );
+            }
+         }
+      }
+
+      // Tiles don't share pixels, so they can be drawn independently.
+      long nTiles = tilesX * tilesY;
+      #pragma omp parallel for schedule(dynamic)
+      for( long i = 0; i < nTiles; i++ )
+      {
+         rasterizeTile( i % tilesX, i / tilesX, meshes );
+      }
+   }
+
+   void IDBuffer::rasterizeTile( int tx, int ty, const vector<const ScreenProjection*>& meshes )
+   {
+      const vector<uint32_t>& bin( bins[ ty*tilesX + tx ] );
+
+      int px0 = tx * tileSize, px1 = min( int( width  ), px0 + tileSize ) - 1;
+      int py0 = ty * tileSize, py1 = min( int( height ), py0 + tileSize ) - 1;
+
+      const double scale = 1. / downsample;
+      for( Index k = 0; k < bin.size(); k++ )
+      {
+         uint32_t id = bin[k];
+         const ScreenProjection& mesh( *meshes[ meshOf[id] ] );
+         const Index* v = mesh.triangle( triangleOf[id] );
+
+         double x[3], y[3], z[3];
+         for( int j = 0; j < 3; j++ )
+         {
+            x[j] = scale * mesh.x()[ v[j] ];
+            y[j] = scale * mesh.y()[ v[j] ];
+            z[j] = mesh.z()[ v[j] ];
+         }
+
+         // Twice the signed area; triangles of either orientation are drawn.
+         double area = ( x[1]-x[0] )*( y[2]-y[0] ) - ( y[1]-y[0] )*( x[2]-x[0] );
+         if( area == 0. ) continue;
+         double invArea = 1. / area;
+
+         // Pixels whose centers lie inside the triangle, clipped to the tile.
+         int i0 = int( max( double( px0 ), ceil ( min( x[0], min( x[1], x[2] ) ) - .5 ) ) );
+         int i1 = int( min( double( px1 ), floor( max( x[0], max( x[1], x[2] ) ) - .5 ) ) );
+         int j0 = int( max( double( py0 ), ceil ( min( y[0], min( y[1], y[2] ) ) - .5 ) ) );
+         int j1 = int( min( double( py1 ), floor( max( y[0], max( y[1], y[2] ) ) - .5 ) ) );
+
+         for( int j = j0; j <= j1; j++ )
+         {
+            double cy = j + .5;
+            for( int i = i0; i <= i1; i++ )
+            {
+               double cx = i + .5;
+
+               // Barycentric coordinates, from the edge functions.
+               double b0 = ( ( x[2]-x[1] )*( cy-y[1] ) - ( y[2]-y[1] )*( cx-x[1] ) ) * invArea;
+               double b1 = ( ( x[0]-x[2] )*( cy-y[2] ) - ( y[0]-y[2] )*( cx-x[2] ) ) * invArea;
+               double b2 = 1. - b0 - b1;
+               if( b0 < 0. || b1 < 0. || b2 < 0. ) continue;
+
+               // Normalized depth is affine in screen space.
+               float d = b0*z[0] + b1*z[1] + b2*z[2];
+               Index p = j*width + i;
+               if( d < depth[p] )
+               {
+                  depth[p] = d;
+                  ids[p] = id;
+               }
+            }
+         }
+      }
+   }
+
+   bool IDBuffer::lookup( double x, double y, Index& mesh, Index& triangle ) const
+   {
+      if( x < 0. || y < 0. ) return false;
+
+      long i = long( x / downsample );
+      long j = long( y / downsample );
+      if( i >= long( width ) || j >= long( height ) ) return false;
+
+      // The pixel only records the triangle covering its center, which
+      // near an edge may not be the one under (x,y).  So among the
+      // triangles drawn at this pixel and its neighbors, take the nearest
+      // one that contains (x,y) exactly, if any.
+      uint32_t best = ids[ j*width + i ];
+      double bestDepth = numeric_limits<double>::max();
+      for( long nj = max( 0L, j-1 ); nj <= min( long( height ) - 1, j+1 ); nj++ )
+      for( long ni = max( 0L, i-1 ); ni <= min( long( width  ) - 1, i+1 ); ni++ )
+      {
+         uint32_t id = ids[ nj*width + ni ];
+         if( id == noID ) continue;
+
+         const ScreenProjection& m( *meshes[ meshOf[id] ] );
+         const Index* v = m.triangle( triangleOf[id] );
+         const double* px = m.x();
+         const double* py = m.y();
+
+         double area = ( px[v[1]]-px[v[0]] )*( py[v[2]]-py[v[0]] ) - ( py[v[1]]-py[v[0]] )*( px[v[2]]-px[v[0]] );
+         if( area == 0. ) continue;
+         double b0 = ( ( px[v[2]]-px[v[1]] )*( y-py[v[1]] ) - ( py[v[2]]-py[v[1]] )*( x-px[v[1]] ) ) / area;
+         double b1 = ( ( px[v[0]]-px[v[2]] )*( y-py[v[2]] ) - ( py[v[0]]-py[v[2]] )*( x-px[v[2]] ) ) / area;
+         double b2 = 1. - b0 - b1;
+         if( b0 < 0. || b1 < 0. || b2 < 0. ) continue;
+
+         double d = b0*m.z()[v[0]] + b1*m.z()[v[1]] + b2*m.z()[v[2]];
+         if( d < bestDepth )
+         {
+            bestDepth = d;
+            best = id;
+         }
+      }
+
+      if( best == noID ) return false;
+
+      mesh = meshOf[best];
+      triangle = triangleOf[best];
+      return true;
+   }
+
+} // namespace CMU462
@@ -0,0 +1,73 @@
+/*
+ * CPU-side ID buffer, for picking by table lookup.
+ *
+ * An IDBuffer rasterizes the triangles of one or more projected meshes
+ * (see ScreenProjection) into an image that stores, for every pixel, the
+ * nearest triangle covering it.  Once the image is rendered, finding the
+ * triangle under the cursor is a single lookup, no matter how large the
+ * meshes are; the image only has to be rendered again when the view or
+ * the geometry changes.
+ *
+ * To keep rendering cheap, the image has a lower resolution than the
+ * screen (see downsample).  It is split into square tiles: triangles
+ * are first sorted into the tiles they overlap, then the tiles are
+ * rasterized in parallel.
+ */
+
+#ifndef CMU462_IDBUFFER_H
+#define CMU462_IDBUFFER_H
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "screenProjection.h"
+
+namespace CMU462
+{
+   class IDBuffer
+   {
+      public:
+         IDBuffer( void ) : downsample( 2 ), width( 0 ), height( 0 ), tilesX( 0 ), tilesY( 0 ) {}
+
+         /**
+          * Rasterizes the given meshes, which must have been projected onto
+          * a screen of the given size.  Triangles are not clipped; instead,
+          * those with a vertex in front of the near plane (or behind the
+          * eye) are not drawn at all.
+          */
+         void render( const vector<const ScreenProjection*>& meshes, size_t screenWidth, size_t screenHeight );
+
+         /**
+          * Looks up the triangle drawn at screen point (x,y) (with the origin
+          * at the bottom left), using the projections passed to render(),
+          * which must not have changed since.  Returns false if there is
+          * none; otherwise,
+          * sets mesh to the index of its mesh (in the list passed to render())
+          * and triangle to its index within that mesh.
+          */
+         bool lookup( double x, double y, Index& mesh, Index& triangle ) const;
+
+         int downsample; ///< number of screen pixels per image pixel, along each axis
+
+      protected:
+         void rasterizeTile( int tx, int ty, const vector<const ScreenProjection*>& meshes );
+
+         size_t width, height;  ///< size of the image
+         int tilesX, tilesY;    ///< number of tiles in each direction
+
+         vector<uint32_t> ids;  ///< triangle drawn at each pixel (as an index into the lists below), or noID
+         vector<float> depth;   ///< normalized depth of the triangle drawn at each pixel
+
+         vector<vector<uint32_t>> bins; ///< triangles overlapping each tile
+
+         vector<const ScreenProjection*> meshes;
+
+         // Meshes and triangles, by ID.
+         vector<uint32_t> meshOf;
+         vector<uint32_t> triangleOf;
+   };
+
+} // namespace CMU462
+
+#endif // CMU462_IDBUFFER_H
@@ -0,0 +1,585 @@
+#include "meshBuffers.h"
+#include "meshOps.h"
+#include "vertexCache.h"
+#include "CMU462/trace.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace CMU462
+{
+   // Floats per triangle corner: position, then normal.
+   static const int cornerSize = 6;
+
+   // Floats per face slot (which holds one triangle).
+   static const int faceSize = 3 * cornerSize;
+
+   // Size of the vertex cache that slots are ordered for.
+   static const Size cacheSize = 16;
+
+   // Puts groups of n consecutive elements in the given order: group
+   // order[i] becomes group i.
+   template<typename T>
+   static void permute( vector<T>& elements, const vector<Index>& order, Size n = 1 )
+   {
+      vector<T> permuted;
+      permuted.reserve( elements.size() );
+      for( Index i = 0; i < order.size(); i++ )
+      {
+         for( Index j = 0; j < n; j++ ) permuted.push_back( elements[ n*order[i] + j ] );
+      }
+      elements.swap( permuted );
+   }
+
+   // Above this many separate ranges, a buffer is uploaded as one range
+   // spanning all changes instead.
+   static const Size maxRanges = 64;
+
+   bool MeshBuffers::supported( void )
+   {
+      return GLEW_VERSION_1_5;
+   }
+
+   void MeshBuffers::update( HalfedgeMesh& mesh )
+   {
+      TRACE_SCOPE( "MeshBuffers::update" );
+
+      indexVertices( mesh, vertices );
+      indexFaces( mesh, faces );
+      indexEdges( mesh, edges );
+      freeVertices.clear();
+
+      const long nF = faces.size();
+      triangles = true;
+      for( long i = 0; i < nF && triangles; i++ )
+      {
+         if( faces[i]->degree() != 3 ) triangles = false;
+      }
+
+      reorder();
+
+      // Count the corners of the triangle fan of each face first,
+      // so that the faces can then be packed in parallel.
+      firstCorner.resize( nF + 1 );
+      firstCorner[0] = 0;
+      for( long i = 0; i < nF; i++ )
+      {
+         Size degree = faces[i]->degree();
+         firstCorner[i+1] = firstCorner[i] + ( degree >= 3 ? 3*( degree - 2 ) : 0 );
+      }
+      corners.resize( cornerSize * firstCorner[nF] );
+
+      #pragma omp parallel for schedule(static)
+      for( long i = 0; i < nF; i++ )
+      {
+         FaceIter f = faces[i];
+         Vector3D N = f->normal();
+
+         GLfloat* c = &corners[ cornerSize * firstCorner[i] ];
+         HalfedgeIter h0 = f->halfedge();
+         HalfedgeIter h = h0->next();
+         while( h->next() != h0 )
+         {
+            const Vector3D* p[3] = { &h0->vertex()->position,
+                                     &h->vertex()->position,
+                                     &h->next()->vertex()->position };
+            for( int k = 0; k < 3; k++ )
+            {
+               c[0] = p[k]->x; c[1] = p[k]->y; c[2] = p[k]->z;
+               c[3] = N.x;     c[4] = N.y;     c[5] = N.z;
+               c += cornerSize;
+            }
+            h = h->next();
+         }
+      }
+
+      const long nV = vertices.size();
+      positions.resize( 3 * nV );
+      #pragma omp parallel for schedule(static)
+      for( long i = 0; i < nV; i++ )
+      {
+         const Vector3D& p( vertices[i]->position );
+         positions[3*i+0] = p.x;
+         positions[3*i+1] = p.y;
+         positions[3*i+2] = p.z;
+      }
+
+      const long nE = edges.size();
+      edgeIndices.resize( 2 * nE );
+      #pragma omp parallel for schedule(static)
+      for( long i = 0; i < nE; i++ )
+      {
+         edgeIndices[2*i+0] = edges[i]->halfedge()->vertex()->index;
+         edgeIndices[2*i+1] = edges[i]->halfedge()->twin()->vertex()->index;
+      }
+
+      // Slot i holds element i, in the order the elements were numbered
+      // above.  (Slots are then only maintained for triangle meshes.)
+      vertexSlot.clear();
+      faceSlot.clear();
+      edgeSlot.clear();
+      vertexSlot.reserve( nV );
+      faceSlot.reserve( nF );
+      edgeSlot.reserve( nE );
+      for( long i = 0; i < nV; i++ ) vertexSlot[ &*vertices[i] ] = i;
+      for( long i = 0; i < nF; i++ ) faceSlot[ &*faces[i] ] = i;
+      for( long i = 0; i < nE; i++ ) edgeSlot[ &*edges[i] ] = i;
+      changedVertices.clear();
+      changedFaces.clear();
+      changedEdges.clear();
+
+      if( faceBuffer == 0 )
+      {
+         glGenBuffers( 1, &faceBuffer );
+         glGenBuffers( 1, &vertexBuffer );
+         glGenBuffers( 1, &edgeBuffer );
+      }
+
+      // Reallocate all three buffers (upload() leaves some room to grow,
+      // so that splits don't immediately force another reallocation).
+      // Every face slot holds one triangle, so a fan packs into slots too.
+      faceCapacity = 0;
+      vertexCapacity = 0;
+      edgeCapacity = 0;
+      uploadRanges = 0;
+      uploadBytes = 0;
+      upload( GL_ARRAY_BUFFER, faceBuffer, faceCapacity, corners.empty() ? NULL : &corners[0], faceSize * sizeof( GLfloat ), corners.size() / faceSize, changedFaces );
+      upload( GL_ARRAY_BUFFER, vertexBuffer, vertexCapacity, positions.empty() ? NULL : &positions[0], 3 * sizeof( GLfloat ), nV, changedVertices );
+      upload( GL_ELEMENT_ARRAY_BUFFER, edgeBuffer, edgeCapacity, edgeIndices.empty() ? NULL : &edgeIndices[0], 2 * sizeof( GLuint ), nE, changedEdges );
+
+      valid = true;
+   }
+
+   void MeshBuffers::reorder( void )
+   {
+      const Size nV = vertices.size();
+      vector<Index> indices, order;
+
+      // Faces, as triangles indexing the vertices.  (Faces of other meshes
+      // are packed as fans, in their original order.)
+      faceACMR[0] = faceACMR[1] = 0.;
+      if( triangles )
+      {
+         indices.resize( 3 * faces.size() );
+         for( Index i = 0; i < faces.size(); i++ )
+         {
+            HalfedgeIter h = faces[i]->halfedge();
+            for( int k = 0; k < 3; k++ )
+            {
+               indices[3*i+k] = h->vertex()->index;
+               h = h->next();
+            }
+         }
+         faceACMR[0] = acmr( indices, nV, 3, cacheSize );
+
+         orderPrimitives( indices, nV, 3, cacheSize, order );
+         permute( faces, order );
+         permute( indices, order, 3 );
+         faceACMR[1] = acmr( indices, nV, 3, cacheSize );
+      }
+
+      // Edges, as lines.
+      indices.resize( 2 * edges.size() );
+      for( Index i = 0; i < edges.size(); i++ )
+      {
+         indices[2*i+0] = edges[i]->halfedge()->vertex()->index;
+         indices[2*i+1] = edges[i]->halfedge()->twin()->vertex()->index;
+      }
+      edgeACMR[0] = acmr( indices, nV, 2, cacheSize );
+
+      orderPrimitives( indices, nV, 2, cacheSize, order );
+      permute( edges, order );
+      permute( indices, order, 2 );
+      edgeACMR[1] = acmr( indices, nV, 2, cacheSize );
+
+      // Vertices, in order of first use by the edges (the faces are not
+      // drawn from the vertex buffer).
+      vector<Index> remap;
+      orderVertices( indices, nV, remap );
+      vector<VertexIter> ordered( nV );
+      for( Index i = 0; i < nV; i++ ) ordered[ remap[i] ] = vertices[i];
+      vertices.swap( ordered );
+      for( Index i = 0; i < nV; i++ ) vertices[i]->index = i;
+      for( Index i = 0; i < faces.size(); i++ ) faces[i]->index = i;
+      for( Index i = 0; i < edges.size(); i++ ) edges[i]->index = i;
+   }
+
+   void MeshBuffers::flush( void )
+   {
+      uploadRanges = 0;
+      uploadBytes = 0;
+      if( !valid ) return;
+
+      upload( GL_ARRAY_BUFFER, faceBuffer, faceCapacity, corners.empty() ? NULL : &corners[0], faceSize * sizeof( GLfloat ), faces.size(), changedFaces );
+      upload( GL_ARRAY_BUFFER, vertexBuffer, vertexCapacity, positions.empty() ? NULL : &positions[0], 3 * sizeof( GLfloat ), vertices.size(), changedVertices );
+      upload( GL_ELEMENT_ARRAY_BUFFER, edgeBuffer, edgeCapacity, edgeIndices.empty() ? NULL : &edgeIndices[0], 2 * sizeof( GLuint ), edges.size(), changedEdges );
+   }
+
+   void MeshBuffers::upload( GLenum target, GLuint buffer, Size& capacity, const void* data, Size slotBytes, Size nSlots, vector<Index>& changed )
+   {
+      const char* bytes = (const char*) data;
+      glBindBuffer( target, buffer );
+
+      if( nSlots > capacity || capacity == 0 )
+      {
+         capacity = max( nSlots + nSlots/4, 2*capacity );
+         glBufferData( target, capacity * slotBytes, NULL, GL_DYNAMIC_DRAW );
+         if( nSlots > 0 ) glBufferSubData( target, 0, nSlots * slotBytes, bytes );
+         uploadRanges++;
+         uploadBytes += nSlots * slotBytes;
+      }
+      else if( !changed.empty() )
+      {
+         // Slots past the end have been vacated since they were changed.
+         sort( changed.begin(), changed.end() );
+         changed.erase( unique( changed.begin(), changed.end() ), changed.end() );
+         changed.erase( lower_bound( changed.begin(), changed.end(), nSlots ), changed.end() );
+
+         Size nRanges = 0;
+         for( Index i = 0; i < changed.size(); i++ )
+         {
+            if( i == 0 || changed[i] != changed[i-1] + 1 ) nRanges++;
+         }
+
+         if( nRanges > maxRanges )
+         {
+            Index first = changed.front();
+            Index end = changed.back() + 1;
+            glBufferSubData( target, first * slotBytes, ( end - first ) * slotBytes, bytes + first * slotBytes );
+            uploadRanges++;
+            uploadBytes += ( end - first ) * slotBytes;
+         }
+         else
+         {
+            Index i = 0;
+            while( i < changed.size() )
+            {
+               Index j = i + 1;
+               while( j < changed.size() && changed[j] == changed[j-1] + 1 ) j++;
+
+               Index first = changed[i];
+               Index end = changed[j-1] + 1;
+               glBufferSubData( target, first * slotBytes, ( end - first ) * slotBytes, bytes + first * slotBytes );
+               uploadRanges++;
+               uploadBytes += ( end - first ) * slotBytes;
+
+               i = j;
+            }
+         }
+      }
+
+      changed.clear();
+      glBindBuffer( target, 0 );
+   }
+
+   void MeshBuffers::vertexMoved( VertexIter v )
+   {
+      if( !valid ) return;
+      if( !triangles ) { valid = false; return; }
+
+      writeVertex( vertexSlot[ &*v ] );
+
+      // The corners and normals of the faces around v change too.
+      HalfedgeIter h = v->halfedge();
+      do
+      {
+         FaceIter f = h->face();
+         if( !f->isBoundary() ) writeFace( faceSlot[ &*f ] );
+         h = h->twin()->next();
+      }
+      while( h != v->halfedge() );
+   }
+
+   void MeshBuffers::beginEdit( EdgeIter e )
+   {
+      editBoundary.clear();
+      if( !valid ) return;
+      if( !triangles ) { valid = false; return; }
+
+      // Release every face around the endpoints, along with its edges,
+      // and remember the vertices of those faces (other than the endpoints),
+      // as FaceBVH::beginEdit() does.
+      VertexIter ends[2] = { e->halfedge()->vertex(), e->halfedge()->twin()->vertex() };
+      for( int k = 0; k < 2; k++ )
+      {
+         HalfedgeIter h = ends[k]->halfedge();
+         do
+         {
+            FaceIter f = h->face();
+            if( !f->isBoundary() && faceSlot.count( &*f ) )
+            {
+               HalfedgeIter g = f->halfedge();
+               do
+               {
+                  VertexIter u = g->vertex();
+                  if( u != ends[0] && u != ends[1] ) editBoundary.push_back( u );
+                  removeEdge( g->edge() );
+                  g = g->next();
+               }
+               while( g != f->halfedge() );
+
+               removeFace( f );
+            }
+            h = h->twin()->next();
+         }
+         while( h != ends[k]->halfedge() );
+      }
+
+      removeVertex( ends[0] );
+      removeVertex( ends[1] );
+   }
+
+   void MeshBuffers::endEdit( void )
+   {
+      if( !valid ) { editBoundary.clear(); return; }
+
+      // Every element created or modified by the operation belongs to a
+      // face around one of the remembered vertices; elements that still
+      // have a slot are skipped by insert*().
+      for( Index i = 0; i < editBoundary.size() && valid; i++ )
+      {
+         VertexIter u = editBoundary[i];
+         HalfedgeIter h = u->halfedge();
+         do
+         {
+            FaceIter f = h->face();
+            if( !f->isBoundary() )
+            {
+               HalfedgeIter g = f->halfedge();
+               do { insertVertex( g->vertex() ); g = g->next(); } while( g != f->halfedge() );
+               do { insertEdge  ( g->edge()   ); g = g->next(); } while( g != f->halfedge() );
+               insertFace( f );
+            }
+            h = h->twin()->next();
+         }
+         while( h != u->halfedge() );
+      }
+      editBoundary.clear();
+
+      // Repack once a quarter of the vertex slots are unused.
+      if( freeVertices.size() > vertices.size() / 4 + 16 ) valid = false;
+   }
+
+   void MeshBuffers::writeVertex( Index slot )
+   {
+      const Vector3D& p( vertices[slot]->position );
+      positions[3*slot+0] = p.x;
+      positions[3*slot+1] = p.y;
+      positions[3*slot+2] = p.z;
+      changedVertices.push_back( slot );
+   }
+
+   void MeshBuffers::writeFace( Index slot )
+   {
+      FaceIter f = faces[slot];
+      Vector3D N = f->normal();
+
+      GLfloat* c = &corners[ faceSize * slot ];
+      HalfedgeIter h = f->halfedge();
+      for( int k = 0; k < 3; k++ )
+      {
+         const Vector3D& p( h->vertex()->position );
+         c[0] = p.x; c[1] = p.y; c[2] = p.z;
+         c[3] = N.x; c[4] = N.y; c[5] = N.z;
+         c += cornerSize;
+         h = h->next();
+      }
+      changedFaces.push_back( slot );
+   }
+
+   void MeshBuffers::writeEdge( Index slot )
+   {
+      EdgeIter e = edges[slot];
+      edgeIndices[2*slot+0] = vertexSlot[ &*e->halfedge()->vertex() ];
+      edgeIndices[2*slot+1] = vertexSlot[ &*e->halfedge()->twin()->vertex() ];
+      changedEdges.push_back( slot );
+   }
+
+   void MeshBuffers::insertVertex( VertexIter v )
+   {
+      if( vertexSlot.count( &*v ) ) return;
+
+      Index slot;
+      if( !freeVertices.empty() )
+      {
+         slot = freeVertices.back();
+         freeVertices.pop_back();
+         vertices[slot] = v;
+      }
+      else
+      {
+         slot = vertices.size();
+         vertices.push_back( v );
+         positions.resize( positions.size() + 3 );
+      }
+      vertexSlot[ &*v ] = slot;
+      writeVertex( slot );
+   }
+
+   void MeshBuffers::insertFace( FaceIter f )
+   {
+      if( faceSlot.count( &*f ) ) return;
+      if( f->degree() != 3 ) { valid = false; return; }
+
+      Index slot = faces.size();
+      faces.push_back( f );
+      corners.resize( corners.size() + faceSize );
+      faceSlot[ &*f ] = slot;
+      writeFace( slot );
+   }
+
+   void MeshBuffers::insertEdge( EdgeIter e )
+   {
+      if( edgeSlot.count( &*e ) ) return;
+
+      Index slot = edges.size();
+      edges.push_back( e );
+      edgeIndices.resize( edgeIndices.size() + 2 );
+      edgeSlot[ &*e ] = slot;
+      writeEdge( slot );
+   }
+
+   void MeshBuffers::removeVertex( VertexIter v )
+   {
+      unordered_map<const Vertex*,Index>::iterator i = vertexSlot.find( &*v );
+      if( i == vertexSlot.end() ) return;
+
+      // (No edge refers to the slot anymore, so its contents don't matter.)
+      freeVertices.push_back( i->second );
+      vertexSlot.erase( i );
+   }
+
+   void MeshBuffers::removeFace( FaceIter f )
+   {
+      unordered_map<const Face*,Index>::iterator i = faceSlot.find( &*f );
+      if( i == faceSlot.end() ) return;
+
+      // Move the last face into the hole.
+      Index slot = i->second;
+      Index last = faces.size() - 1;
+      faceSlot.erase( i );
+      if( slot != last )
+      {
+         faces[slot] = faces[last];
+         memcpy( &corners[ faceSize * slot ], &corners[ faceSize * last ], faceSize * sizeof( GLfloat ) );
+         faceSlot[ &*faces[slot] ] = slot;
+         changedFaces.push_back( slot );
+      }
+      faces.pop_back();
+      corners.resize( corners.size() - faceSize );
+   }
+
+   void MeshBuffers::removeEdge( EdgeIter e )
+   {
+      unordered_map<const Edge*,Index>::iterator i = edgeSlot.find( &*e );
+      if( i == edgeSlot.end() ) return;
+
+      // Move the last edge into the hole.
+      Index slot = i->second;
+      Index last = edges.size() - 1;
+      edgeSlot.erase( i );
+      if( slot != last )
+      {
+         edges[slot] = edges[last];
+         edgeIndices[2*slot+0] = edgeIndices[2*last+0];
+         edgeIndices[2*slot+1] = edgeIndices[2*last+1];
+         edgeSlot[ &*edges[slot] ] = slot;
+         changedEdges.push_back( slot );
+      }
+      edges.pop_back();
+      edgeIndices.resize( edgeIndices.size() - 2 );
+   }
+
+   void MeshBuffers::faceCorners( FaceIter f, Index& first, Size& count ) const
+   {
+      Index slot = faceSlot.at( &*f );
+      if( triangles )
+      {
+         first = 3 * slot;
+         count = 3;
+      }
+      else
+      {
+         first = firstCorner[slot];
+         count = firstCorner[slot+1] - firstCorner[slot];
+      }
+   }
+
+   void MeshBuffers::edgeVertices( EdgeIter e, GLuint& a, GLuint& b ) const
+   {
+      Index slot = edgeSlot.at( &*e );
+      a = edgeIndices[2*slot+0];
+      b = edgeIndices[2*slot+1];
+   }
+
+   void MeshBuffers::drawFaces( void )
+   {
+      GLsizei nCorners = corners.size() / cornerSize;
+      if( nCorners == 0 ) return;
+
+      glBindBuffer( GL_ARRAY_BUFFER, faceBuffer );
+      glEnableClientState( GL_VERTEX_ARRAY );
+      glEnableClientState( GL_NORMAL_ARRAY );
+      glVertexPointer( 3, GL_FLOAT, cornerSize * sizeof( GLfloat ), (const GLvoid*) 0 );
+      glNormalPointer(    GL_FLOAT, cornerSize * sizeof( GLfloat ), (const GLvoid*) ( 3 * sizeof( GLfloat ) ) );
+
+      glDrawArrays( GL_TRIANGLES, 0, nCorners );
+
+      glDisableClientState( GL_NORMAL_ARRAY );
+      glDisableClientState( GL_VERTEX_ARRAY );
+      glBindBuffer( GL_ARRAY_BUFFER, 0 );
+   }
+
+   void MeshBuffers::drawEdges( void )
+   {
+      GLsizei nEdgeIndices = edgeIndices.size();
+      if( nEdgeIndices == 0 ) return;
+
+      glBindBuffer( GL_ARRAY_BUFFER, vertexBuffer );
+      glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, edgeBuffer );
+      glEnableClientState( GL_VERTEX_ARRAY );
+      glVertexPointer( 3, GL_FLOAT, 3 * sizeof( GLfloat ), (const GLvoid*) 0 );
+
+      glDrawElements( GL_LINES, nEdgeIndices, GL_UNSIGNED_INT, (const GLvoid*) 0 );
+
+      glDisableClientState( GL_VERTEX_ARRAY );
+      glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+      glBindBuffer( GL_ARRAY_BUFFER, 0 );
+   }
+
+   void MeshBuffers::drawFaces( GLuint indexBuffer, const vector<GLsizei>& counts, const vector<const GLvoid*>& offsets )
+   {
+      if( counts.empty() || corners.empty() ) return;
+
+      glBindBuffer( GL_ARRAY_BUFFER, faceBuffer );
+      glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, indexBuffer );
+      glEnableClientState( GL_VERTEX_ARRAY );
+      glEnableClientState( GL_NORMAL_ARRAY );
+      glVertexPointer( 3, GL_FLOAT, cornerSize * sizeof( GLfloat ), (const GLvoid*) 0 );
+      glNormalPointer(    GL_FLOAT, cornerSize * sizeof( GLfloat ), (const GLvoid*) ( 3 * sizeof( GLfloat ) ) );
+
+      glMultiDrawElements( GL_TRIANGLES, &counts[0], GL_UNSIGNED_INT, (const GLvoid**) &offsets[0], counts.size() );
+
+      glDisableClientState( GL_NORMAL_ARRAY );
+      glDisableClientState( GL_VERTEX_ARRAY );
+      glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+      glBindBuffer( GL_ARRAY_BUFFER, 0 );
+   }
+
+   void MeshBuffers::drawEdges( GLuint indexBuffer, const vector<GLsizei>& counts, const vector<const GLvoid*>& offsets )
+   {
+      if( counts.empty() || positions.empty() ) return;
+
+      glBindBuffer( GL_ARRAY_BUFFER, vertexBuffer );
+      glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, indexBuffer );
+      glEnableClientState( GL_VERTEX_ARRAY );
+      glVertexPointer( 3, GL_FLOAT, 3 * sizeof( GLfloat ), (const GLvoid*) 0 );
+
+      glMultiDrawElements( GL_LINES, &counts[0], GL_UNSIGNED_INT, (const GLvoid**) &offsets[0], counts.size() );
+
+      glDisableClientState( GL_VERTEX_ARRAY );
+      glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+      glBindBuffer( GL_ARRAY_BUFFER, 0 );
+   }
+
+} // namespace CMU462
@@ -0,0 +1,200 @@
+/*
+ * Retained-mode drawing of a HalfedgeMesh with OpenGL buffer objects.
+ *
+ * MeshBuffers packs the faces and edges of a mesh into vertex and index
+ * buffers, so that the whole mesh can be drawn with one call per pass,
+ * rather than with one glBegin()/glEnd() pair per face and per edge:
+ *
+ *  - faces are split into triangles (as a fan around their first vertex),
+ *    and every triangle corner stores its position and the normal of its
+ *    face, so that faces are flat shaded as before;
+ *
+ *  - edges are stored as pairs of indices into a separate array holding
+ *    one position per vertex.
+ *
+ * Only the default appearance is stored; hovered and selected elements
+ * are drawn on top by the caller.  All methods other than the
+ * constructors must be called with the OpenGL context current, except
+ * for those reporting changes (vertexMoved(), beginEdit(), endEdit()),
+ * which only touch the copy kept in memory.
+ *
+ * After a small change to a triangle mesh, the buffers need not be
+ * repacked from scratch.  Every vertex, face and edge owns a slot in
+ * its buffer, and the changes reported through the methods below only
+ * rewrite the slots involved:
+ *
+ *    - after moving a vertex, call vertexMoved();
+ *
+ *    - around a local operation on an edge (flip, split, or collapse),
+ *      call beginEdit() before and endEdit() after the operation, in the
+ *      same way as for FaceBVH.
+ *
+ * flush() then uploads just the slots that changed, as a few contiguous
+ * ranges.  Face and edge slots are kept contiguous (the last one moves
+ * into any hole); vertex slots are recycled.  After any other change to
+ * the mesh, clear 'valid', and the buffers will be repacked; they also
+ * ask to be repacked (by clearing 'valid' themselves) if the mesh has
+ * non-triangular faces, or if too many vertex slots lie unused.
+ */
+
+#ifndef CMU462_MESHBUFFERS_H
+#define CMU462_MESHBUFFERS_H
+
+#include <unordered_map>
+#include <vector>
+
+#include "GL/glew.h"
+
+#include "halfEdgeMesh.h"
+
+namespace CMU462
+{
+   class MeshBuffers
+   {
+      public:
+         MeshBuffers( void ) : valid( false ), uploadRanges( 0 ), uploadBytes( 0 ), faceBuffer( 0 ), vertexBuffer( 0 ), edgeBuffer( 0 ), faceCapacity( 0 ), vertexCapacity( 0 ), edgeCapacity( 0 ), triangles( false ) { edgeACMR[0] = edgeACMR[1] = faceACMR[0] = faceACMR[1] = 0.; }
+
+         // Buffer objects belong to the OpenGL context, not to the mesh,
+         // so copies start out empty (and will be filled on first use).
+         MeshBuffers( const MeshBuffers& other ) : valid( false ), uploadRanges( 0 ), uploadBytes( 0 ), faceBuffer( 0 ), vertexBuffer( 0 ), edgeBuffer( 0 ), faceCapacity( 0 ), vertexCapacity( 0 ), edgeCapacity( 0 ), triangles( false ) { edgeACMR[0] = edgeACMR[1] = faceACMR[0] = faceACMR[1] = 0.; }
+         MeshBuffers& operator=( const MeshBuffers& other ) { valid = false; return *this; }
+
+         /**
+          * Returns true if and only if this OpenGL implementation supports
+          * buffer objects (OpenGL 1.5).
+          */
+         static bool supported( void );
+
+         /**
+          * Packs the given mesh and uploads it, then sets valid.  Numbers
+          * the vertices, edges and faces of the mesh (in slot order) as a
+          * side effect.  Slots are ordered for the vertex cache first.
+          */
+         void update( HalfedgeMesh& mesh );
+
+         /**
+          * Uploads the parts of the buffers changed since the last call
+          * to update() or flush().
+          */
+         void flush( void );
+
+         /*
+          * Change tracking (see above).  These do nothing unless valid is
+          * set, and may clear it.
+          */
+         void vertexMoved( VertexIter v );
+         void beginEdit( EdgeIter e );
+         void endEdit( void );
+
+         /**
+          * Draws all faces, with the current color and material, in a
+          * single call.
+          */
+         void drawFaces( void );
+
+         /**
+          * Draws all edges, with the current color and line width, in a
+          * single call.
+          */
+         void drawEdges( void );
+
+         /*
+          * Same as above, but drawing only parts of the buffers, listed in
+          * the given index buffer: faces from triangle corners, as numbered
+          * by faceCorners(), and edges from vertex slots, as returned by
+          * edgeVertices().  Part i consists of counts[i] indices, starting
+          * at byte offsets[i] of the index buffer (as for glMultiDrawElements()).
+          */
+         void drawFaces( GLuint indexBuffer, const vector<GLsizei>& counts, const vector<const GLvoid*>& offsets );
+         void drawEdges( GLuint indexBuffer, const vector<GLsizei>& counts, const vector<const GLvoid*>& offsets );
+
+         /**
+          * Gets the range of triangle corners packed for the given face (a
+          * multiple of three).  Valid until the buffers are changed.
+          */
+         void faceCorners( FaceIter f, Index& first, Size& count ) const;
+
+         /**
+          * Gets the slots of the vertex buffer holding the endpoints of the
+          * given edge.  Valid until the buffers are changed.
+          */
+         void edgeVertices( EdgeIter e, GLuint& a, GLuint& b ) const;
+
+         bool valid; ///< whether the buffers match the mesh
+
+         /*
+          * Statistics about the last call to flush(): number of ranges
+          * uploaded, and their total size in bytes.
+          */
+         Size uploadRanges;
+         Size uploadBytes;
+
+         /*
+          * Average cache miss ratio (see vertexCache.h) of the edges, and of
+          * the faces taken as triangles indexing the vertices (or zero if
+          * some faces are not triangles), before and after the last call to
+          * update() reordered them.
+          */
+         double edgeACMR[2];
+         double faceACMR[2];
+
+      protected:
+         // Writing individual slots; each one is also marked as changed.
+         void writeVertex( Index slot );
+         void writeFace( Index slot );
+         void writeEdge( Index slot );
+
+         // Assigning and releasing slots.
+         void insertVertex( VertexIter v );
+         void insertFace( FaceIter f );
+         void insertEdge( EdgeIter e );
+         void removeVertex( VertexIter v );
+         void removeFace( FaceIter f );
+         void removeEdge( EdgeIter e );
+
+         // Orders the slots of a freshly numbered mesh for the vertex cache:
+         // faces and edges with orderPrimitives(), and vertices in order of
+         // first use by the edges (which are drawn indexed); then numbers
+         // the elements in slot order.
+         void reorder( void );
+
+         // Uploads the changed slots of one buffer, or all of it if it has
+         // outgrown its capacity (which is then doubled).
+         void upload( GLenum target, GLuint buffer, Size& capacity, const void* data, Size slotBytes, Size nSlots, vector<Index>& changed );
+
+         GLuint faceBuffer;   ///< position and normal of each triangle corner
+         GLuint vertexBuffer; ///< position of each vertex
+         GLuint edgeBuffer;   ///< two vertex slots per edge
+         Size faceCapacity, vertexCapacity, edgeCapacity; ///< allocated sizes of the buffers, in slots
+
+         // Elements in each slot.  (Slots listed in freeVertices hold no vertex.)
+         vector<VertexIter> vertices;
+         vector<FaceIter> faces;
+         vector<EdgeIter> edges;
+         vector<Index> freeVertices;
+
+         // Slot of each element.  (Without slots, the number of each element.)
+         unordered_map<const Vertex*,Index> vertexSlot;
+         unordered_map<const Face*,Index> faceSlot;
+         unordered_map<const Edge*,Index> edgeSlot;
+
+         // Packed data.
+         vector<GLfloat> corners;
+         vector<GLfloat> positions;
+         vector<GLuint> edgeIndices;
+
+         // Slots changed since the last upload.
+         vector<Index> changedVertices;
+         vector<Index> changedFaces;
+         vector<Index> changedEdges;
+
+         bool triangles; ///< whether every face is a triangle (otherwise, slots are not maintained)
+         vector<VertexIter> editBoundary; ///< vertices remembered by beginEdit()
+
+         // Used by update() for meshes with non-triangular faces.
+         vector<Index> firstCorner;
+   };
+
+} // namespace CMU462
+
+#endif // CMU462_MESHBUFFERS_H
@@ -27,6 +27,32 @@ namespace CMU462 {
       mouse_rotate = false;
 
       showHUD = true;
+      nMessages = 0;
+
+      // Pick by casting rays against each mesh's face BVH,
+      // on a background thread.
+      pickEngine = PICK_BVH;
+      asyncPicking = true;
+      idBufferValid = false;
+
+      // Clicks select one element at a time until a region mode is chosen.
+      regionMode = REGION_OFF;
+      regionElements = REGION_VERTICES;
+      regionDragging = false;
+
+      // Draw meshes from buffer objects, if OpenGL supports them.
+      useBuffers = MeshBuffers::supported();
+      repackSeconds = 0.;
+      lastRepack = chrono::steady_clock::now();
+
+      // Run heavy operations on a background thread by default.
+      useWorker = true;
+      workerMesh = NULL;
+
+      // The viewer may be waiting for input when background work produces
+      // a result, so ask it for a new frame to show it.
+      hoverPicker.onReady( request_frame );
+      worker.onFinished( request_frame );
       camera_angles = Vector3D(0.0, 0.0, 0.0);
 
       // 3D applications really like enabling the depth test,
@@ -79,34 +105,51 @@ namespace CMU462 {
       defaultStyle.halfedgeColor = Color( 0.5, 0.5, 0.5 );
         hoverStyle.halfedgeColor = Color( 0.9, 0.9, 0.9 );
        selectStyle.halfedgeColor = Color( 1.0, 1.0, 1.0 );
+       regionStyle.halfedgeColor = Color( 1.0, 0.8, 0.2 );
 
       defaultStyle.faceColor = Color( 0.5, 0.50, 0.90 );
         hoverStyle.faceColor = Color( 0.9, 0.75, 0.75 );
        selectStyle.faceColor = Color( 1.0, 1.00, 1.00 );
+       regionStyle.faceColor = Color( 1.0, 0.80, 0.20 );
 
       defaultStyle.edgeColor = Color( 0.5, 0.5, 0.50 );
         hoverStyle.edgeColor = Color( 0.9, 0.0, 0.75 );
        selectStyle.edgeColor = Color( 1.0, 1.0, 1.00 );
+       regionStyle.edgeColor = Color( 1.0, 0.8, 0.20 );
 
       defaultStyle.vertexColor = Color( 0.0, 0.0, 0.00 );
         hoverStyle.vertexColor = Color( 0.8, 0.0, 0.75 );
        selectStyle.vertexColor = Color( 1.0, 1.0, 1.00 );
+       regionStyle.vertexColor = Color( 1.0, 0.8, 0.20 );
 
       // Primitive sizes.
       defaultStyle.strokeWidth = 1.0;
         hoverStyle.strokeWidth = 4.0;
        selectStyle.strokeWidth = 8.0;
+       regionStyle.strokeWidth = 3.0;
 
       defaultStyle.vertexRadius = 2.0;
         hoverStyle.vertexRadius = 10.0;
        selectStyle.vertexRadius = 20.0;
+       regionStyle.vertexRadius = 6.0;
    }
 
    void MeshEdit::render()
    {
       update_camera();
+      collectWorker();
+      runTask();
+
+      // Show the latest result of the background hover picker.
+      hoverPicker.poll( hoveredFeature );
+
       draw_meshes();
 
+      if( regionDragging )
+      {
+         drawRegion();
+      }
+
       // // Draw the helpful picking messages.
 	  if (showHUD)
 	  {
@@ -118,6 +161,8 @@ namespace CMU462 {
 
    void MeshEdit::update_camera()
    {
+      PROFILE_SCOPE( "update_camera" );
+
       // Call resize() every time we draw, since it doesn't seem
       // to get called by the Viewer upon intial window creation
       // (this should probably be fixed!).
@@ -171,9 +216,31 @@ namespace CMU462 {
 
    void MeshEdit::draw_meshes()
    {
-      for( vector<MeshNode>::iterator n = meshNodes.begin(); n != meshNodes.end(); n++ )
+      // The view set up by update_camera() and resize(), for culling.
+      GLdouble projMatrix[16];
+      GLdouble modelMatrix[16];
+      glGetDoublev(GL_PROJECTION_MATRIX, projMatrix);
+      glGetDoublev(GL_MODELVIEW_MATRIX,  modelMatrix);
+
+      Matrix4x4 P, M;
+      for(int r = 0; r < 4; r++)
+      for(int c = 0; c < 4; c++)
       {
-         renderMesh( n->mesh );
+         P(r, c) = projMatrix [4*c + r];
+         M(r, c) = modelMatrix[4*c + r];
+      }
+      Matrix4x4 transform = P * M;
+
+      for( vector<DrawnMeshNode>::iterator n = meshNodes.begin(); n != meshNodes.end(); n++ )
+      {
+         if( useBuffers )
+         {
+            renderMeshBuffers( *n, transform );
+         }
+         else
+         {
+            renderMesh( n->mesh );
+         }
       }
 
       // Execute all of the OpenGL commands.
@@ -206,8 +273,40 @@ namespace CMU462 {
 	 return "Assignment 2: MeshEdit";
    }
 
+   bool MeshEdit::wants_frame()
+   {
+      // Operations in progress advance by one time slice per frame.
+      return task != nullptr;
+   }
+
    void MeshEdit::key_event( char key )
    {
+      // While an operation is in progress, the mesh belongs to the
+      // operation; only the view can be changed (or the operation canceled).
+      if( task || worker.busy() )
+      {
+         switch( key ) {
+            case ' ':
+               reset_camera();
+               break;
+            case 'i':
+            case 'I':
+               showHUD = !showHUD;
+               break;
+            case 'b':
+            case 'B':
+               useBuffers = !useBuffers && MeshBuffers::supported();
+               break;
+            case 'x':
+            case 'X':
+               cancelTask();
+               break;
+            default:
+               break;
+         }
+         return;
+      }
+
       switch( key ) {
 
          // reset view transformation
@@ -229,6 +328,22 @@ namespace CMU462 {
          case 'R':
             mesh_resample();
             break;
+         case 'p':
+         case 'P':
+            mesh_remesh();
+            break;
+         case 'v':
+         case 'V':
+            mesh_flip_valence();
+            break;
+         case 'l':
+         case 'L':
+            mesh_flip_delaunay();
+            break;
+         case 'a':
+         case 'A':
+            mesh_refine();
+            break;
          case 'i':
          case 'I':
             showHUD = !showHUD;
@@ -253,6 +368,34 @@ namespace CMU462 {
          case 'T':
             selectTwinHalfedge();
             break;
+         case 'x':
+         case 'X':
+            cancelTask();
+            break;
+         case 'k':
+         case 'K':
+            pickEngine = PickEngine( ( pickEngine + 1 ) % N_PICK_ENGINES );
+            break;
+         case 'h':
+         case 'H':
+            asyncPicking = !asyncPicking;
+            break;
+         case 'w':
+         case 'W':
+            useWorker = !useWorker;
+            break;
+         case 'b':
+         case 'B':
+            useBuffers = !useBuffers && MeshBuffers::supported();
+            break;
+         case 'g':
+         case 'G':
+            regionMode = RegionMode( ( regionMode + 1 ) % N_REGION_MODES );
+            break;
+         case 'e':
+         case 'E':
+            regionElements = RegionElements( ( regionElements + 1 ) % N_REGION_ELEMENTS );
+            break;
          default:
             break;
       }
@@ -477,7 +620,7 @@ namespace CMU462 {
    void MeshEdit::init_polymesh( Polymesh& polymesh )
    {
       // Create and store a mesh node object.
-      MeshNode meshNode( polymesh );
+      DrawnMeshNode meshNode( polymesh );
       meshNodes.push_back( meshNode );
 
       // Ensure that the current selection always has a valid mesh pointer.
@@ -515,7 +658,13 @@ namespace CMU462 {
    {
       switch (b) {
         case LEFT:
-          if(!hoveredFeature.element) {
+          if(regionMode != REGION_OFF && !task) {
+            // Start outlining a region at the cursor.
+            regionDragging = true;
+            region.clear();
+            region.push_back( Vector2D( mouse_x, mouse_y ) );
+          }
+          else if(!hoveredFeature.element) {
             mouse_rotate = true;
           }
 		  else
@@ -539,6 +688,11 @@ namespace CMU462 {
           {
             mouse_rotate = false;
           }
+          if(regionDragging)
+          {
+            regionDragging = false;
+            selectRegion();
+          }
           break;
         case RIGHT:
           mouse_rotate = false;
@@ -554,10 +708,30 @@ namespace CMU462 {
        float dx = (x - mouse_x);
        float dy = (y - mouse_y);
 
+       if(regionDragging)
+       {
+         // A box is given by its two opposite corners; a lasso
+         // gets a new point every few pixels.
+         Vector2D p( x, y );
+         if( regionMode == REGION_BOX )
+         {
+            region.resize( 1 );
+            region.push_back( p );
+         }
+         else if( ( p - region.back() ).norm() >= 4. )
+         {
+            region.push_back( p );
+         }
+         return;
+       }
+
 	   Vertex* v = selectedFeature.element -> getVertex();
-       if(!mouse_rotate && v != NULL)
+       // (The mesh can't be edited while a background operation reads it.)
+       if(!mouse_rotate && v != NULL && !worker.busy())
 	   {
+		 lock_guard<mutex> lock( hoverPicker.dataMutex() );
 		 dragPosition(dx, dy, v->position);
+		 vertexMoved( static_cast<DrawnMeshNode*>( selectedFeature.node ), v->halfedge()->vertex() );
 		 return;
 	   }
 
@@ -581,8 +755,9 @@ namespace CMU462 {
 
    void MeshEdit::mouseM(float x, float y)
    {
-      // Highlight the mesh element the mouse is hovering over.
-      findMouseSelection(x, y);
+      // Highlight the mesh element the mouse is hovering over
+      // (unless a task is running; see startTask()).
+      if( !task ) findMouseSelection(x, y);
    }
 
    void MeshEdit::updateMouseCoordinates(float x, float y)
@@ -597,263 +772,250 @@ namespace CMU462 {
       return Vector2D(V.x, V.y);
    }
 
-   // Returns true iff the given point is inside of this triangle.
-   // Stores barycentric coordinates in A if return is true.
-   inline bool point_in_triangle_and_barycentric_coordinates(
-         Vector2D & A, Vector2D & B, Vector2D & C, Vector2D point)
+   // Picking algorithm entry point.
+   void MeshEdit::findMouseSelection(float x, float y)
    {
+      PROFILE_SCOPE( "findMouseSelection" );
 
-      // Compute vectors
-      Vector2D v0 = C - A;
-      Vector2D v1 = B - A;
-      Vector2D v2 = point - A;
-
-      // Compute dot products
-      double dot00 = dot(v0, v0);
-      double dot01 = dot(v0, v1);
-      double dot02 = dot(v0, v2);
-      double dot11 = dot(v1, v1);
-      double dot12 = dot(v1, v2);
+      // The view is read here, since only this thread may make OpenGL calls.
+      PickQuery query = pickQuery( x, y );
 
-      // Compute barycentric coordinates
-      double invDenom = 1.0 / (dot00 * dot11 - dot01 * dot01);
-      double u = (dot11 * dot02 - dot01 * dot12) * invDenom;
-      double v = (dot00 * dot12 - dot01 * dot02) * invDenom;
-
-      // Check if point is in triangle.
-      bool output = (u >= 0) && (v >= 0) && (u + v < 1);
-
-      if(output)
+      if( asyncPicking )
       {
-         A.x = u;
-         A.y = v;
+         // The result is collected by render().
+         hoverPicker.post( query );
+      }
+      else
+      {
+         // A query posted before async picking was turned off may still
+         // be running on the picker's thread, against the same data.
+         lock_guard<mutex> lock( hoverPicker.dataMutex() );
+         pick( query, hoveredFeature );
       }
-
-      return output;
-   }
-
-   inline Vector2D MeshEdit::unitCubeToScreenSpace(Vector4D & in)
-   {
-      return Vector2D(screen_w*(in.x + 1)/2, screen_h*(in.y + 1)/2);
    }
 
-   // IN :
-   //    selectionPoint --- coordinates of the cursor in screen space.
-   //    A,B,C --- vertex coordinates of the triangle in model space.
-   //
-   // IN/OUT :
-   //
-   //    w --- The value of w passed in is the smallest w value seen so far.
-   //    The method will return false if the current triangle is further away than this value (greater w value ) -OR- if
-   //    the point selectionPoint is not inside the triangle ABC, projected onto screen space.
-   //    Otherwise, it updates the w value with the w value of the current triangle (which is closer than anything seen before).
-   //
-   // OUT :
-   //    barycentricCoordinates --- contains the screen space barycentric coordinates of selectionPoint.
-   //
-   inline bool MeshEdit::triangleSelectionTest(
-         const Vector2D & selectionPoint,
-         Vector4D & A, Vector4D & B, Vector4D & C,
-         float & w,
-         Vector3D& barycentricCoordinates )
+   MeshEdit::PickQuery MeshEdit::pickQuery(float x, float y)
    {
-      /*
-       * Algorithm for computing from model space coordinates X to
-       * screen space with a depth value using opengl.
-       *
-       * Start with Vector X.
-       * 1. Get P = opengl projection Matrix.
-       *    Get M = opengl Model transform matrix.
-       *
-       * 2. Convert into our personal 462 library matrix representation.
-       *
-       * 3. Model to world space: X = M*X;
-       *
-       * 4. World to homogenous space X = P*X;
-       *
-       * 5. Projection divide.(homogenesous space to 3D unit cube space.)
-       *
-       *  - X.x = X.x/X.w;
-       *  - X.y = X.y/X.w;
-       *  - X.z = X.z/X.w;
-       *
-       * x, y, and z are now in the range [-1, 1].
-       *
-       * 6. Unit cube space to screen space.
-       * screen_x = viewport.x + viewport.width  * (X.x +1)/2;
-       * screen_y = viewport.y + viewport.height * (X.y +1)/2;
-       *
-       * In our case, the input screen coordinates are already in
-       * window space, so we can omit the viewport offset values.
-       *
-       * 7. Note that opengl coordinate shceme is from lower left corner.
-       */
-
-      // -- Step 1, extract relevant opengl matrices.
-
+      PickQuery query;
+      query.x = x;
+      query.y = y;
+      query.screen_w = screen_w;
+      query.screen_h = screen_h;
+      query.engine = pickEngine;
+
+      // Fetch the current transformation.
       GLdouble projMatrix[16];
       GLdouble modelMatrix[16];
-
-      for(int i = 0; i < 16; i++)
-      {
-         projMatrix[i]  = 0.0;
-         modelMatrix[i] = 0.0;
-      }
-
       glGetDoublev(GL_PROJECTION_MATRIX, projMatrix);
       glGetDoublev(GL_MODELVIEW_MATRIX,  modelMatrix);
 
-
-      Matrix4x4 P;
-      Matrix4x4 M;
-
       for(int r = 0; r < 4; r++)
-	  for(int c = 0; c < 4; c++)
+      for(int c = 0; c < 4; c++)
       {
-         P(r, c) = projMatrix [4*c + r];
-         M(r, c) = modelMatrix[4*c + r];
+         query.P(r, c) = projMatrix [4*c + r];
+         query.M(r, c) = modelMatrix[4*c + r];
       }
 
-      // -- Step 3 & 4. Apply Model transform, then Projection transform.
-
-      A = P*M*A;
-      B = P*M*B;
-      C = P*M*C;
-
-      // -- Step 5. Projection divide.
-      A /= A.w;
-      B /= B.w;
-      C /= C.w;
-
-      // -- Step 6.  Unit cube space to screen space.
-      /* screen_x = viewport.x + viewport.width  * (X.x +1)/2;
-       * screen_y = viewport.y + viewport.height * (X.y +1)/2;
-       */
+      return query;
+   }
 
-      Vector2D A_out = unitCubeToScreenSpace(A);
-      Vector2D b_2d  = unitCubeToScreenSpace(B);
-      Vector2D c_2d  = unitCubeToScreenSpace(C);
-      bool inside = point_in_triangle_and_barycentric_coordinates(A_out, b_2d, c_2d, selectionPoint);
+   void MeshEdit::pick( const PickQuery& query, MeshFeature& feature )
+   {
+      TRACE_SCOPE( "MeshEdit::pick" );
 
-      // If inside, then we need to go and compute the meta data.
-      if(inside)
+      switch( query.engine )
       {
-         // Percentage towards C.
-         float bary_u = A_out.x;// u
-
-         // Percentage towards B.
-         float bary_v = A_out.y;// v
-
-         // During the projection the z component becomes indicative of depth.
-         /*A.w = A.z;
-           B.w = B.z;
-           C.w = C.z;
-           */
-
-         // Change in u over 1 u.
-         float dwu = C.w - A.w;
-         // Change in v over 1 v.
-         float dwv = B.w - A.w;
-
-         /* Interpolate Along the linear plane in the plane aligned
-          * coordinate system.
-          */
-         float w_new = A.w + dwu*bary_u + dwv*bary_v;
+         case PICK_BVH:
+            findMouseSelectionBVH( query, feature );
+            break;
+         case PICK_ID_BUFFER:
+            findMouseSelectionIDBuffer( query, feature );
+            break;
+         case PICK_LINEAR:
+         default:
+            findMouseSelectionLinear( query, feature );
+            break;
+      }
+   }
 
+   // Casts a ray through the cursor, and intersects it with each mesh
+   // using the mesh's face BVH (which is built on demand).  Roughly
+   // logarithmic in the number of triangles in the scene.
+   void MeshEdit::findMouseSelectionBVH( const PickQuery& query, MeshFeature& feature )
+   {
+      const Matrix4x4& P = query.P;
+      const Matrix4x4& M = query.M;
+
+      // Unproject the cursor at the near and far planes of the unit cube,
+      // to get a ray in model space.  (Screen y points down, but y in the
+      // unit cube points up.)
+      Matrix4x4 unproject = ( P*M ).inv();
+      double sx = 2.*query.x/query.screen_w - 1.;
+      double sy = 1. - 2.*query.y/query.screen_h;
+      Vector4D nearPoint = unproject * Vector4D( sx, sy, -1., 1. );
+      Vector4D  farPoint = unproject * Vector4D( sx, sy,  1., 1. );
+      Vector3D o = nearPoint.to3D() / nearPoint.w;
+      Vector3D d = farPoint.to3D() / farPoint.w - o;
+
+      // Find the closest hit over all meshes.
+      bool foundSelection = false;
+      MeshFeature closestFeature;
+      Vector3D barycentric_min;
+      double t_min = 0.;
 
-         /* Determine whether this triangle is closer to the viewer within
-          * the view frustrum using its homogeneous w coordinate,
-          * which is NOT the same as its z coordinate.
-          * NOTE: w < 0.0 implies no previous satisfactory triangle
-          *       has been seen.
-          */
-         if(w < 0.0 || (w_new > 0 && w_new < w))
+      for( vector<DrawnMeshNode>::iterator node = meshNodes.begin(); node != meshNodes.end(); node++ )
+      {
+         if( !node->bvhValid )
          {
+            node->bvh.build( node->mesh );
+            node->bvhValid = true;
+         }
 
-            // VERY IMPORTANT! We need to update the minnumum.
-            w = w_new;
-
-            barycentricCoordinates.x = 1.0 - bary_u - bary_v;// percentage towards A.
-            barycentricCoordinates.y = bary_v;// % B. (=1 --> on B, =0 --> on opposite edge from B.
-            barycentricCoordinates.z = bary_u;// % C
-            return true;
+         FaceIter f;
+         double t;
+         Vector3D barycentricCoordinates;
+         if( node->bvh.intersect( o, d, f, t, barycentricCoordinates ) &&
+             ( !foundSelection || t < t_min ) )
+         {
+            closestFeature.element = elementAddress( f );
+            closestFeature.node = &*node;
+            barycentric_min = barycentricCoordinates;
+            t_min = t;
+            foundSelection = true;
          }
       }
 
-      // The point is not inside of the triangle,
-      // or the triangle is not at a good depth.
-      return false;
+      // Update the Current hoveredFeature values.
+      if( foundSelection )
+      {
+         closestFeature.node->fillFeatureStructure( feature, closestFeature, barycentric_min, t_min );
+      }
+      else // If the cursor is not hovering over any element, clear the selection.
+      {
+         feature.invalidate();
+      }
    }
 
-   // Picking algorithm entry point.
+   // Projects every triangle onto the screen.
    // Linear in the number of triangles in the scene.
-   void MeshEdit::findMouseSelection(float x, float y)
+   void MeshEdit::findMouseSelectionLinear( const PickQuery& query, MeshFeature& feature )
    {
+      // Combine the transformation once per query (see ScreenProjection
+      // for a description of the steps).
+      Matrix4x4 PM = query.P*query.M;
+
       bool foundSelection = false; // Will be true if and only if we find a selection.
 
       MeshFeature closestFeature;
-      MeshFeature currentFeature;
-      MeshNode* closestNode;
-
-      Vector4D A, B, C;
       Vector3D barycentric_min;
 
       /*
        * IMPORTANT NOTE: OpenGL coordinate system orgin at bottom left of
        * screen. Y points up, so we need to flip y by screen_h - y.
        */
-      const Vector2D selectionPoint = Vector2D( x, screen_h - y );
+      const Vector2D selectionPoint = Vector2D( query.x, query.screen_h - query.y );
 
       // Start out behind the camera.
       float w = -1.0;
 
       // Iterate through all meshes.
-      int num_meshes = meshNodes.size();
-      for(int mesh_index = 0; mesh_index < num_meshes; mesh_index++)
+      for( vector<DrawnMeshNode>::iterator node = meshNodes.begin(); node != meshNodes.end(); node++ )
       {
-         MeshNode& node = meshNodes[mesh_index];
+         // Copy the mesh into flat arrays if it has changed, then
+         // project all of its vertices onto the screen at once.
+         if( !node->projectionValid )
+         {
+            node->projection.gather( node->mesh );
+            node->projectionValid = true;
+         }
+         node->projection.project( PM, query.screen_w, query.screen_h );
+
+         // If the cursor is inside some triangle of this mesh --AND-- that triangle is closer
+         // to the viewer than anything we've seen so far, update the record of the closest
+         // feature seen so far (the value of w is updated by pick()).
+         FaceIter f;
+         Vector3D barycentricCoordinates;
+         if( node->projection.pick( selectionPoint, w, f, barycentricCoordinates ) )
+         {
+            closestFeature.element = elementAddress( f );
+            closestFeature.node = &*node;
+            barycentric_min = barycentricCoordinates;
 
-         // Iterate through all triangles.
-         for( FaceIter f = node.mesh.facesBegin(); f != node.mesh.facesEnd(); f++ )
+            foundSelection = true;
+         }
+      }
+
+      // Update the Current hoveredFeature values.
+      if( foundSelection )
+      {
+         closestFeature.node->fillFeatureStructure( feature, closestFeature, barycentric_min, w );
+      }
+      else // If the cursor is not hovering over any element, clear the selection.
+      {
+         feature.invalidate();
+      }
+   }
+
+   static bool sameTransform( const Matrix4x4& A, const Matrix4x4& B )
+   {
+      for( int i = 0; i < 4; i++ )
+      for( int j = 0; j < 4; j++ )
+      {
+         if( A(i,j) != B(i,j) ) return false;
+      }
+      return true;
+   }
+
+   // Looks up the triangle under the cursor in an ID buffer, which is
+   // rendered again only when the view or the geometry has changed.
+   // Constant time for a static view.
+   void MeshEdit::findMouseSelectionIDBuffer( const PickQuery& query, MeshFeature& feature )
+   {
+      Matrix4x4 PM = query.P*query.M;
+
+      if( !idBufferValid ||
+          query.screen_w != idBufferWidth || query.screen_h != idBufferHeight ||
+          !sameTransform( PM, idBufferTransform ) )
+      {
+         vector<const ScreenProjection*> projections;
+         for( vector<DrawnMeshNode>::iterator node = meshNodes.begin(); node != meshNodes.end(); node++ )
          {
-            // Build a mesh feature corresponding to the current face.
-            currentFeature.element = elementAddress( f );
-            currentFeature.node = &node;
-
-            // Copy the three vertex coordinates of the face into 4D homogeneous coordinates.
-            A = Vector4D( f->halfedge()->vertex()->position );
-            B = Vector4D( f->halfedge()->next()->vertex()->position );
-            C = Vector4D( f->halfedge()->next()->next()->vertex()->position );
-            A.w = B.w = C.w = 1.;
-
-            Vector3D barycentricCoordinates;
-            if( triangleSelectionTest( selectionPoint, A, B, C, w, barycentricCoordinates ) )
-               // If the cursor is inside triangle ABC --AND-- this triangle is closer to the viewer
-               // than anything we've seen so far, we'll update the record of the closest feature
-               // we've seen so far.
+            if( !node->projectionValid )
             {
-               // Update the record of the closest feature seen so far; note that the value of w
-               // was already updated in our call to triangleSelectionTest.
-               barycentric_min = barycentricCoordinates;
-               closestFeature = currentFeature;
-               closestNode = &node;
-
-               foundSelection = true;
+               node->projection.gather( node->mesh );
+               node->projectionValid = true;
             }
+            node->projection.project( PM, query.screen_w, query.screen_h );
+            projections.push_back( &node->projection );
+         }
 
-         } // Done iterating through all triangles.
+         idBuffer.render( projections, query.screen_w, query.screen_h );
+         idBufferTransform = PM;
+         idBufferWidth = query.screen_w;
+         idBufferHeight = query.screen_h;
+         idBufferValid = true;
+      }
 
-      } // Done iterating over meshes.
+      // (The buffer has its origin at the bottom left, like OpenGL.)
+      const Vector2D selectionPoint = Vector2D( query.x, query.screen_h - query.y );
 
-      // Update the Current hoveredFeature values.
-      if( foundSelection )
+      Index m, t;
+      if( idBuffer.lookup( selectionPoint.x, selectionPoint.y, m, t ) )
       {
-         closestFeature.node->fillFeatureStructure( this->hoveredFeature, closestFeature, barycentric_min, w );
-         hoveredFeature.node = closestNode;
+         // Refine the hit to the cursor's exact position on the triangle.
+         MeshNode& node = meshNodes[m];
+         Vector3D barycentricCoordinates;
+         float w;
+         node.projection.barycentric( t, selectionPoint, barycentricCoordinates, w );
+
+         MeshFeature closestFeature;
+         closestFeature.element = elementAddress( node.projection.face( t ) );
+         closestFeature.node = &node;
+         node.fillFeatureStructure( feature, closestFeature, barycentricCoordinates, w );
       }
       else // If the cursor is not hovering over any element, clear the selection.
       {
-         this->hoveredFeature.invalidate();
+         feature.invalidate();
       }
    }
 
@@ -863,6 +1025,169 @@ namespace CMU462 {
       selectedFeature = hoveredFeature;
    }
 
+   // Selects the elements that fall inside the region dragged out with the mouse.
+   void MeshEdit::selectRegion()
+   {
+      // A click without a drag just clears the selection.
+      vector<Vector2D> polygon;
+      if( regionMode == REGION_BOX && region.size() == 2 )
+      {
+         const Vector2D& a( region[0] );
+         const Vector2D& b( region[1] );
+         polygon.push_back( Vector2D( a.x, a.y ) );
+         polygon.push_back( Vector2D( b.x, a.y ) );
+         polygon.push_back( Vector2D( b.x, b.y ) );
+         polygon.push_back( Vector2D( a.x, b.y ) );
+      }
+      else if( regionMode == REGION_LASSO && region.size() >= 3 )
+      {
+         polygon = region;
+      }
+
+      // (Projected meshes have their origin at the bottom left.)
+      for( Index i = 0; i < polygon.size(); i++ )
+      {
+         polygon[i].y = screen_h - polygon[i].y;
+      }
+
+      PickQuery query = pickQuery( mouse_x, mouse_y );
+      Matrix4x4 PM = query.P*query.M;
+
+      lock_guard<mutex> lock( hoverPicker.dataMutex() );
+      vector<unsigned char> inside;
+      unordered_set<const Vertex*> insideVertices;
+      for( vector<DrawnMeshNode>::iterator node = meshNodes.begin(); node != meshNodes.end(); node++ )
+      {
+         node->selection.clear();
+         if( polygon.empty() ) continue;
+
+         if( !node->projectionValid )
+         {
+            node->projection.gather( node->mesh );
+            node->projectionValid = true;
+            idBufferValid = false;
+         }
+         node->projection.project( PM, query.screen_w, query.screen_h );
+         node->projection.select( polygon, inside );
+
+         // Match the results of select() up with the mesh through the
+         // projection's own list of vertices, rather than Vertex::index
+         // (which MeshBuffers renumbers when it reorders the mesh).
+         insideVertices.clear();
+         for( Index i = 0; i < inside.size(); i++ )
+         {
+            if( inside[i] ) insideVertices.insert( &*node->projection.vertex( i ) );
+         }
+
+         HalfedgeMesh& mesh( node->mesh );
+         switch( regionElements )
+         {
+            case REGION_VERTICES:
+               for( Index i = 0; i < inside.size(); i++ )
+               {
+                  if( inside[i] ) node->selection.insert( elementAddress( node->projection.vertex( i ) ) );
+               }
+               break;
+
+            case REGION_EDGES:
+               for( EdgeIter e = mesh.edgesBegin(); e != mesh.edgesEnd(); e++ )
+               {
+                  if( insideVertices.count( &*e->halfedge()->vertex() ) &&
+                      insideVertices.count( &*e->halfedge()->twin()->vertex() ) )
+                  {
+                     node->selection.insert( elementAddress( e ) );
+                  }
+               }
+               break;
+
+            case REGION_FACES:
+            default:
+               for( FaceIter f = mesh.facesBegin(); f != mesh.facesEnd(); f++ )
+               {
+                  bool all = true;
+                  HalfedgeIter h = f->halfedge();
+                  do
+                  {
+                     all = all && insideVertices.count( &*h->vertex() );
+                     h = h->next();
+                  }
+                  while( h != f->halfedge() );
+
+                  if( all ) node->selection.insert( elementAddress( f ) );
+               }
+               break;
+         }
+      }
+   }
+
+   // Returns whether the element is part of some node's region selection.
+   bool MeshEdit::inRegionSelection( HalfedgeElement* element )
+   {
+      for( vector<DrawnMeshNode>::iterator node = meshNodes.begin(); node != meshNodes.end(); node++ )
+      {
+         if( !node->selection.empty() && node->selection.count( element ) ) return true;
+      }
+      return false;
+   }
+
+   // Returns the number of elements in the region selection, over all nodes.
+   Size MeshEdit::regionSelectionSize()
+   {
+      Size n = 0;
+      for( vector<DrawnMeshNode>::iterator node = meshNodes.begin(); node != meshNodes.end(); node++ )
+      {
+         n += node->selection.size();
+      }
+      return n;
+   }
+
+   // Draws the outline of the region being dragged out, in screenspace.
+   void MeshEdit::drawRegion()
+   {
+      glPushAttrib( GL_VIEWPORT_BIT | GL_ENABLE_BIT | GL_LINE_BIT );
+      glViewport( 0, 0, screen_w, screen_h );
+
+      glMatrixMode( GL_PROJECTION );
+      glPushMatrix();
+      glLoadIdentity();
+      glOrtho( 0, screen_w, screen_h, 0, 0, 1 ); // Y flipped, like window coordinates
+
+      glMatrixMode( GL_MODELVIEW );
+      glPushMatrix();
+      glLoadIdentity();
+      glTranslatef( 0, 0, -1 );
+
+      glDisable( GL_DEPTH_TEST );
+      glDisable( GL_LIGHTING );
+      glLineWidth( 1.0 );
+      glColor3f( regionStyle.edgeColor.r, regionStyle.edgeColor.g, regionStyle.edgeColor.b );
+
+      glBegin( GL_LINE_LOOP );
+      if( regionMode == REGION_BOX && region.size() == 2 )
+      {
+         glVertex2d( region[0].x, region[0].y );
+         glVertex2d( region[1].x, region[0].y );
+         glVertex2d( region[1].x, region[1].y );
+         glVertex2d( region[0].x, region[1].y );
+      }
+      else
+      {
+         for( Index i = 0; i < region.size(); i++ )
+         {
+            glVertex2d( region[i].x, region[i].y );
+         }
+      }
+      glEnd();
+
+      glMatrixMode( GL_PROJECTION );
+      glPopMatrix();
+
+      glMatrixMode( GL_MODELVIEW );
+      glPopMatrix();
+
+      glPopAttrib();
+   }
+
   // Transforms the position vector in world space according to an offset in screenspace.
   void MeshEdit::dragPosition(float screen_x_offset, float screen_y_offset,
 								   Vector3D & position)
@@ -934,7 +1259,7 @@ namespace CMU462 {
          mesh = &( meshNodes.begin()->mesh );
       }
 
-      resampler.upsample( *mesh );
+      startOperation( "Upsampling", mesh, [this]( HalfedgeMesh& m ) { resampler.upsample( m ); } );
 
       // Since the mesh may have changed, the selected and
       // hovered features may no longer point to valid elements.
@@ -957,7 +1282,7 @@ namespace CMU462 {
          mesh = &( meshNodes.begin()->mesh );
       }
 
-      resampler.downsample( *mesh );
+      startOperation( "Downsampling", mesh, [this]( HalfedgeMesh& m ) { resampler.downsample( m ); } );
 
       // Since the mesh may have changed, the selected and
       // hovered features may no longer point to valid elements.
@@ -980,7 +1305,7 @@ namespace CMU462 {
          mesh = &( meshNodes.begin()->mesh );
       }
 
-      resampler.resample( *mesh );
+      startOperation( "Resampling", mesh, [this]( HalfedgeMesh& m ) { resampler.resample( m ); } );
 
       // Since the mesh may have changed, the selected and
       // hovered features may no longer point to valid elements.
@@ -988,12 +1313,282 @@ namespace CMU462 {
       hoveredFeature.invalidate();
    }
 
+   void MeshEdit::mesh_remesh()
+   {
+      HalfedgeMesh* mesh;
+
+      // If an element is selected, remesh the mesh containing that
+      // element; otherwise, remesh the first mesh in the scene.
+      if( selectedFeature.isValid() )
+      {
+         mesh = &( selectedFeature.node->mesh );
+      }
+      else
+      {
+         mesh = &( meshNodes.begin()->mesh );
+      }
+
+      // In the foreground, the remesher can run a round at a time.
+      if( useWorker )
+      {
+         startOperation( "Remeshing", mesh, [this]( HalfedgeMesh& m ) { remesher.remesh( m ); } );
+      }
+      else
+      {
+         startTask( new RemeshTask( remesher, *mesh ) );
+      }
+
+      // Since the mesh may have changed, the selected and
+      // hovered features may no longer point to valid elements.
+      selectedFeature.invalidate();
+      hoveredFeature.invalidate();
+   }
+
+   void MeshEdit::mesh_flip_valence()
+   {
+      HalfedgeMesh* mesh;
+
+      // If an element is selected, flip edges in the mesh containing
+      // that element; otherwise, flip edges in the first mesh in the scene.
+      if( selectedFeature.isValid() )
+      {
+         mesh = &( selectedFeature.node->mesh );
+      }
+      else
+      {
+         mesh = &( meshNodes.begin()->mesh );
+      }
+
+      startTask( new FlipTask( flipper, *mesh, EdgeFlipper::VALENCE ) );
+
+      // Since the mesh may have changed, the selected and
+      // hovered features may no longer point to valid elements.
+      selectedFeature.invalidate();
+      hoveredFeature.invalidate();
+   }
+
+   void MeshEdit::mesh_flip_delaunay()
+   {
+      HalfedgeMesh* mesh;
+
+      // If an element is selected, flip edges in the mesh containing
+      // that element; otherwise, flip edges in the first mesh in the scene.
+      if( selectedFeature.isValid() )
+      {
+         mesh = &( selectedFeature.node->mesh );
+      }
+      else
+      {
+         mesh = &( meshNodes.begin()->mesh );
+      }
+
+      startTask( new FlipTask( flipper, *mesh, EdgeFlipper::DELAUNAY ) );
+
+      // Since the mesh may have changed, the selected and
+      // hovered features may no longer point to valid elements.
+      selectedFeature.invalidate();
+      hoveredFeature.invalidate();
+   }
+
+   void MeshEdit::mesh_refine()
+   {
+      HalfedgeMesh* mesh;
+
+      // If an element is selected, refine the mesh containing that
+      // element; otherwise, refine the first mesh in the scene.
+      if( selectedFeature.isValid() )
+      {
+         mesh = &( selectedFeature.node->mesh );
+      }
+      else
+      {
+         mesh = &( meshNodes.begin()->mesh );
+      }
+
+      // Aim for edges half as long as they are now, but never
+      // more than double the number of faces in one step.
+      double targetLength = Remesher::meanEdgeLength( *mesh ) / 2.;
+      startTask( new RefineTask( refiner, *mesh, targetLength, 2 * mesh->nFaces() ) );
+
+      // Since the mesh may have changed, the selected and
+      // hovered features may no longer point to valid elements.
+      selectedFeature.invalidate();
+      hoveredFeature.invalidate();
+   }
+
+
+   // Fraction of a frame (at 60Hz) spent on a long-running operation.
+   static const double taskSliceSeconds = .5 / 60.;
+
+   // While a task runs, the buffers are repacked for at most this fraction
+   // of the time, and at most this often (in seconds).
+   static const double taskRepackFraction = .1;
+   static const double taskRepackInterval = .25;
+
+   void MeshEdit::startTask( MeshTask* newTask )
+   {
+      task.reset( newTask );
+
+      // A task may delete any element of the mesh, so picking and selection
+      // are off until it finishes (see mouseP() and mouseM()).
+      lock_guard<mutex> lock( hoverPicker.dataMutex() );
+      selectedFeature.invalidate();
+      hoveredFeature.invalidate();
+      regionDragging = false;
+      for( vector<DrawnMeshNode>::iterator n = meshNodes.begin(); n != meshNodes.end(); n++ )
+      {
+         n->selection.clear();
+      }
+      hoverPicker.discard();
+   }
+
+   void MeshEdit::startOperation( const string& name, HalfedgeMesh* mesh, const function<void(HalfedgeMesh&)>& operation )
+   {
+      // Record the operation in the trace, on whichever thread runs it.
+      function<void(HalfedgeMesh&)> traced = [name, operation]( HalfedgeMesh& m )
+      {
+         TraceScope scope( name.c_str() );
+         operation( m );
+      };
+
+      if( useWorker )
+      {
+         // The worker copies the mesh before it returns; the picker's
+         // thread must not be numbering its elements in the meantime.
+         lock_guard<mutex> lock( hoverPicker.dataMutex() );
+         workerMesh = mesh;
+         worker.start( name, *mesh, traced );
+      }
+      else
+      {
+         startTask( new FunctionTask( name, [=]() { traced( *mesh ); } ) );
+      }
+   }
+
+   void MeshEdit::collectWorker()
+   {
+      if( workerMesh == NULL ) return;
+
+      lock_guard<mutex> lock( hoverPicker.dataMutex() );
+      if( worker.collect( *workerMesh ) )
+      {
+         // The old elements are gone, so the selected and
+         // hovered features no longer point to valid elements.
+         selectedFeature.invalidate();
+         hoveredFeature.invalidate();
+         invalidatePicking();
+         workerMesh = NULL;
+      }
+   }
+
+   void MeshEdit::runTask()
+   {
+      if( !task ) return;
+
+      lock_guard<mutex> lock( hoverPicker.dataMutex() );
+      if( task->run( taskSliceSeconds ) )
+      {
+         task.reset();
+         invalidatePicking();
+         return;
+      }
+
+      // Nothing is picked while the task runs, but the mesh is still drawn.
+      // Repacking the buffers of a large mesh takes far longer than a frame,
+      // so the old buffers are drawn in between repacks.
+      double sinceRepack = chrono::duration<double>( chrono::steady_clock::now() - lastRepack ).count();
+      if( sinceRepack >= max( taskRepackInterval, repackSeconds / taskRepackFraction ) )
+      {
+         for( vector<DrawnMeshNode>::iterator n = meshNodes.begin(); n != meshNodes.end(); n++ )
+         {
+            n->buffers.valid = false;
+            n->meshlets.valid = false;
+         }
+      }
+   }
+
+   void MeshEdit::invalidatePicking()
+   {
+      for( vector<DrawnMeshNode>::iterator n = meshNodes.begin(); n != meshNodes.end(); n++ )
+      {
+         n->bvhValid = false;
+         n->projectionValid = false;
+         n->buffers.valid = false;
+         n->meshlets.valid = false;
+         n->selection.clear();
+      }
+      idBufferValid = false;
+      hoverPicker.discard();
+   }
+
+   void MeshEdit::vertexMoved( DrawnMeshNode* node, VertexIter v )
+   {
+      if( node->bvhValid )
+      {
+         node->bvh.refit( v );
+         if( node->bvh.degraded() ) node->bvhValid = false;
+      }
+      node->projectionValid = false;
+      node->buffers.vertexMoved( v );
+      node->meshlets.vertexMoved( v );
+      idBufferValid = false;
+      hoverPicker.discard();
+   }
+
+   void MeshEdit::beginLocalEdit( DrawnMeshNode* node, EdgeIter e )
+   {
+      if( node->bvhValid )
+      {
+         node->bvh.beginEdit( e );
+      }
+      node->buffers.beginEdit( e );
+   }
+
+   void MeshEdit::endLocalEdit( DrawnMeshNode* node )
+   {
+      if( node->bvhValid )
+      {
+         node->bvh.endEdit();
+         if( node->bvh.degraded() ) node->bvhValid = false;
+      }
+      node->projectionValid = false;
+      node->buffers.endEdit();
+      node->meshlets.valid = false;
+      node->selection.clear();
+      idBufferValid = false;
+      hoverPicker.discard();
+   }
+
+   void MeshEdit::cancelTask()
+   {
+      // Tasks leave the mesh in a valid state after every step,
+      // so an operation can be abandoned between any two frames.
+      lock_guard<mutex> lock( hoverPicker.dataMutex() );
+      task.reset();
+      invalidatePicking();
+   }
 
   inline void MeshEdit::drawString(float x, float y, string str, size_t size, Color c)
   {
-	int line_index = text_mgr.add_line(( x*2/screen_w) - 1.0,
-									   (-y*2/screen_h) + 1.0, str, size, c);
-	messages.push_back(line_index);
+	float line_x = ( x*2/screen_w) - 1.0;
+	float line_y = (-y*2/screen_h) + 1.0;
+
+	// Reuse the line drawn in this position last frame, if any; OSDText
+	// only lays it out again if something about it changed.
+	if( nMessages < messages.size() )
+	{
+	   int line_index = messages[nMessages];
+	   text_mgr.set_anchor(line_index, line_x, line_y);
+	   text_mgr.set_text(line_index, str);
+	   text_mgr.set_size(line_index, size);
+	   text_mgr.set_color(line_index, c);
+	}
+	else
+	{
+	   int line_index = text_mgr.add_line(line_x, line_y, str, size, c);
+	   messages.push_back(line_index);
+	}
+	nMessages++;
   }
 
    /*
@@ -1005,15 +1600,10 @@ namespace CMU462 {
    // FIXME : Convert these to messages on screen with SKY's code.
    void MeshEdit::drawHUD()
    {
+      PROFILE_SCOPE( "drawHUD" );
 
-	  // Delete the current Lines every time.
-	  int len = messages.size();
-	  for(int i = 0; i < len; i++)
-	  {
-		int line_index = messages[i];
-		text_mgr.del_line(line_index);
-	  }
-	  messages.clear();
+	  // Lines are kept from one frame to the next, and overwritten in order.
+	  nMessages = 0;
 
 
     const size_t size = 16;
@@ -1022,6 +1612,74 @@ namespace CMU462 {
     const int inc  = use_hdpi ? 48  : 24;
     float y = y0 + inc - size;
 
+      // Progress of the current long-running operation.
+      if( worker.busy() )
+      {
+		ostringstream m1;
+		m1 << worker.getName() << " in the background...";
+
+		drawString(x0, y, m1.str(), size, text_color);y += inc; y += inc;
+      }
+      if( task )
+      {
+		ostringstream m1, m2;
+		m1 << task->getName() << ": " << int( 100. * task->progress() ) << "%";
+		m2 << "(press X to cancel)";
+
+		drawString(x0, y, m1.str(), size, text_color);y += inc;
+		drawString(x0, y, m2.str(), size, text_color);y += inc; y += inc;
+      }
+
+      // Responsiveness of the background hover picker.
+      if( asyncPicking )
+      {
+		ostringstream m1;
+		m1 << fixed;
+		m1.precision(2);
+		m1 << "Hover pick: " << 1000. * hoverPicker.averageLatency() << " ms, "
+		   << hoverPicker.queriesSkipped() << "/" << hoverPicker.queriesPosted() << " skipped";
+
+		drawString(x0, y, m1.str(), size, text_color);y += inc; y += inc;
+      }
+
+      // Clusters drawn from the buffers (see Meshlets).
+      if( useBuffers )
+      {
+		Size nVisible = 0, nMeshlets = 0;
+		for( vector<DrawnMeshNode>::iterator n = meshNodes.begin(); n != meshNodes.end(); n++ )
+		{
+		   nVisible += n->meshlets.nVisible;
+		   nMeshlets += n->meshlets.size();
+		}
+		ostringstream m1, m2;
+		m1 << "Meshlets: " << nVisible << "/" << nMeshlets << " drawn";
+
+		// Vertex cache efficiency of the edges, for the first mesh.
+		if( !meshNodes.empty() )
+		{
+		   const MeshBuffers& b( meshNodes.front().buffers );
+		   m2 << fixed;
+		   m2.precision(2);
+		   m2 << "Edge ACMR: " << b.edgeACMR[0] << " -> " << b.edgeACMR[1];
+		}
+
+		drawString(x0, y, m1.str(), size, text_color);y += inc;
+		drawString(x0, y, m2.str(), size, text_color);y += inc; y += inc;
+      }
+
+      // Box or lasso selection.
+      if( regionMode != REGION_OFF || regionSelectionSize() > 0 )
+      {
+		const char* modes[] = { "off", "box", "lasso" };
+		const char* kinds[] = { "vertices", "edges", "faces" };
+		ostringstream m1, m2;
+		m1 << "Region select: " << modes[ regionMode ] << ", " << kinds[ regionElements ];
+		m2 << regionSelectionSize() << " selected";
+
+		drawString(x0, y, m1.str(), size, text_color);y += inc;
+		drawString(x0, y, m2.str(), size, text_color);y += inc; y += inc;
+      }
+
       // No selection --> no messages.
       if(!selectedFeature.isValid())
       {
@@ -1185,6 +1843,13 @@ namespace CMU462 {
 
       glEnable( GL_DEPTH_TEST );
 
+	  // Delete the lines that were not drawn this time.
+	  for( size_t i = nMessages; i < messages.size(); i++ )
+	  {
+		text_mgr.del_line(messages[i]);
+	  }
+	  messages.resize(nMessages);
+
 	  text_mgr.render();
 
 
@@ -1203,6 +1868,128 @@ namespace CMU462 {
       glColor3f(c.r, c.g, c.b);
    }
 
+   // Draws a single polygon, with the normal of its face.
+   static void drawPolygon( Face* f )
+   {
+      glBegin(GL_POLYGON);
+
+      Vector3D normal = f->normal();
+      glNormal3dv( &normal.x );
+
+      HalfedgeIter h = f->halfedge();
+      do
+      {
+         Vector3D position = h->vertex()->position;
+         glVertex3dv( &position.x );
+         h = h->next();
+      }
+      while( h != f->halfedge() );
+
+      glEnd();
+   }
+
+   static void drawLine( Edge* e )
+   {
+      Vector3D p0 = e->halfedge()->vertex()->position;
+      Vector3D p1 = e->halfedge()->twin()->vertex()->position;
+
+      glBegin(GL_LINES);
+      glVertex3dv( &p0.x );
+      glVertex3dv( &p1.x );
+      glEnd();
+   }
+
+   void MeshEdit::renderMeshBuffers( DrawnMeshNode& node, const Matrix4x4& transform )
+   {
+      chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      bool repacked = !node.buffers.valid || !node.meshlets.valid;
+
+      if( !node.buffers.valid )
+      {
+         // (Packing numbers the elements, as the hover picker does.)
+         lock_guard<mutex> lock( hoverPicker.dataMutex() );
+         node.buffers.update( node.mesh );
+         node.meshlets.valid = false;
+      }
+      else
+      {
+         // Upload just what vertexMoved() and endEdit() recorded.
+         node.buffers.flush();
+      }
+
+      if( !node.meshlets.valid )
+      {
+         lock_guard<mutex> lock( hoverPicker.dataMutex() );
+         node.meshlets.build( node.mesh, node.buffers );
+      }
+
+      // (See runTask().)
+      if( repacked )
+      {
+         lastRepack = chrono::steady_clock::now();
+         repackSeconds = chrono::duration<double>( lastRepack - start ).count();
+      }
+
+      node.meshlets.cull( transform );
+
+      // Same state as drawFaces(), but set once for the whole mesh.
+      {
+         PROFILE_SCOPE( "drawFaces" );
+         glEnable(GL_LIGHTING);
+         glEnable(GL_POLYGON_OFFSET_FILL);
+         glPolygonOffset( 1.0, 1.0 );
+         glColorMaterial(GL_FRONT, GL_AMBIENT_AND_DIFFUSE);
+         glEnable(GL_COLOR_MATERIAL);
+
+         setColor( defaultStyle.faceColor );
+         node.meshlets.drawFaces( node.buffers );
+         drawHighlights( node, true );
+      }
+
+      // Edges are drawn with flat shading.
+      {
+         PROFILE_SCOPE( "drawEdges" );
+         glDisable(GL_LIGHTING);
+         setColor( defaultStyle.edgeColor );
+         glLineWidth( defaultStyle.strokeWidth );
+         node.meshlets.drawEdges( node.buffers );
+         drawHighlights( node, false );
+      }
+
+      drawVertices( node.mesh );
+      drawHalfedges( node.mesh );
+   }
+
+   void MeshEdit::drawHighlights( DrawnMeshNode& node, bool faces )
+   {
+      // The box or lasso selection first, so that the hovered and
+      // selected elements end up on top.
+      vector<HalfedgeElement*> elements( node.selection.begin(), node.selection.end() );
+      if(  hoveredFeature.node == &node ) elements.push_back(  hoveredFeature.element );
+      if( selectedFeature.node == &node ) elements.push_back( selectedFeature.element );
+
+      // Highlights cover elements already in the depth buffer.
+      glDepthFunc( GL_LEQUAL );
+      for( vector<HalfedgeElement*>::iterator e = elements.begin(); e != elements.end(); e++ )
+      {
+         if( *e == NULL ) continue;
+
+         Face* f = (*e)->getFace();
+         Edge* d = (*e)->getEdge();
+         if( faces && f != NULL )
+         {
+            setElementStyle( f );
+            drawPolygon( f );
+         }
+         else if( !faces && d != NULL )
+         {
+            setElementStyle( d );
+            drawLine( d );
+         }
+      }
+      glDepthFunc( GL_LESS );
+   }
+
    void MeshEdit::renderMesh( HalfedgeMesh& mesh )
    {
       glEnable(GL_LIGHTING);
@@ -1231,6 +2018,10 @@ namespace CMU462 {
       {
          style = &hoverStyle;
       }
+      else if( inRegionSelection( element ) )
+      {
+         style = &regionStyle;
+      }
 
       // Now set draw attributes according to the type of mesh element.
       if( element->getFace()     ) { setColor( style->faceColor     );                                     return; }
@@ -1243,6 +2034,8 @@ namespace CMU462 {
 
    void MeshEdit::drawFaces( HalfedgeMesh& mesh )
    {
+      PROFILE_SCOPE( "drawFaces" );
+
       for( FaceIter f = mesh.facesBegin(); f != mesh.facesEnd(); f++ )
       {
          // These guys prevent z fighting / prevents the faces from bleeding into the edge lines and points.
@@ -1255,28 +2048,7 @@ namespace CMU462 {
          // Coloring.
          setElementStyle( elementAddress( f ) );
 
-         // Start specifying the polygon.
-         glBegin(GL_POLYGON);
-
-         // Set the normal of this face.
-         Vector3D normal = f->normal();
-         glNormal3dv( &normal.x );
-
-         // iterate over this polygon's vertices
-         HalfedgeIter h = f->halfedge();
-         do
-         {
-            // Draw this vertex.
-            Vector3D position = h->vertex()->position;
-            glVertex3dv( &position.x );
-
-            // go to the next vertex in this polygon
-            h = h->next();
-
-         } while( h != f->halfedge() ); // end of iteration over polygon vertices
-
-         // Finish drawing the polygon.
-         glEnd();
+         drawPolygon( elementAddress( f ) );
 
       }// End of per polygon loop.
 
@@ -1284,17 +2056,13 @@ namespace CMU462 {
 
    void MeshEdit::drawEdges( HalfedgeMesh& mesh )
    {
+      PROFILE_SCOPE( "drawEdges" );
+
       for( EdgeIter e = mesh.edgesBegin(); e != mesh.edgesEnd(); e++ ) // iterate over edges
       {
-         Vector3D p0 = e->halfedge()->vertex()->position;
-         Vector3D p1 = e->halfedge()->twin()->vertex()->position;
-
          setElementStyle( elementAddress( e ) );
 
-         glBegin(GL_LINES);
-         glVertex3dv( &p0.x );
-         glVertex3dv( &p1.x );
-         glEnd();
+         drawLine( elementAddress( e ) );
 
       } // done iterating over edges
    }
@@ -1318,6 +2086,23 @@ namespace CMU462 {
          glEnd();
       }
 
+      // Draw the vertices of the box or lasso selection.
+      for( vector<DrawnMeshNode>::iterator n = meshNodes.begin(); n != meshNodes.end(); n++ )
+      {
+         if( &n->mesh != &mesh || n->selection.empty() ) continue;
+
+         glBegin( GL_POINTS );
+         for( unordered_set<HalfedgeElement*>::iterator e = n->selection.begin(); e != n->selection.end(); e++ )
+         {
+            v = (*e)->getVertex();
+            if( v == NULL ) continue;
+            setElementStyle( v );
+            Vector3D p = v->position;
+            glVertex3d( p.x, p.y, p.z );
+         }
+         glEnd();
+      }
+
       // Draw the selected vertex.
       v = selectedFeature.element->getVertex();
       if( v != NULL )
@@ -1378,114 +2163,17 @@ namespace CMU462 {
       glEnable( GL_DEPTH_TEST );
    }
 
-   void MeshNode::getBounds( Vector3D& low, Vector3D& high )
-   {
-      double maxValue = numeric_limits<double>::max();
-
-      low.x = maxValue; high.x = -maxValue;
-      low.y = maxValue; high.y = -maxValue;
-      low.z = maxValue; high.z = -maxValue;
-
-      for( VertexIter v = mesh.verticesBegin(); v != mesh.verticesEnd(); v++ )
-      {
-         Vector3D& p = v->position;
-
-         low.x = min( low.x, p.x );
-         low.y = min( low.y, p.y );
-         low.z = min( low.z, p.z );
-
-         high.x = max( high.x, p.x );
-         high.y = max( high.y, p.y );
-         high.z = max( high.z, p.z );
-      }
-   }
-
-   // Centroid / weighted average point.
-   void MeshNode::getCentroid( Vector3D& centroid )
-   {
-      centroid = Vector3D( 0., 0., 0. );
-
-      for( VertexIter v = mesh.verticesBegin(); v != mesh.verticesEnd(); v++ )
-      {
-         centroid += v->position;
-      }
-
-      centroid /= (double) mesh.nVertices();
-   }
-
-   /*
-    * populates the given feature structure with data cooresponding to
-    * mesh feature on the face cooresponding to the given lookup structure
-    * and bary_centric_coordinates.
-    * OUT : feature.
-    * IN : Lookup location : Which triangular face.
-    * barycentric_coordates : Where on the face is the mouse pointing to.
-    *  - Determines whether the user wants the face, an edge, or a vertex.
-    *  - Vector(A%, B%, C%), where ABC are in index order after the lookup location.
-    */
-   void MeshNode::fillFeatureStructure(
-         // OUTPUT:
-         MeshFeature & feature,
-
-         // INPUTS:
-         MeshFeature & lookup,
-         Vector3D    & barycentric_coords,
-         float w )
-   {
-      /* Feature on Face Selection algorithm.
-       *
-       * coordinate c is low  if (c < low_threshold)
-       * coordinate c is mid  if (low_threshold <= low_threshold <= high_hold)
-       * coordinate c is high if (c > high_threshold)
-       */
-
-      Face* f = lookup.element->getFace();
-      if( f == NULL )
-      {
-         cerr << "Error in Mesh::fillFeatureStructure(): we were asked to find a feature associated with an element that is not a face!" << endl;
-         exit( 1 );
-      }
-
-      // Grab the three halfedges of the triangle under the cursor.
-      HalfedgeIter h1 = f->halfedge();
-      HalfedgeIter h2 = h1->next();
-      HalfedgeIter h3 = h2->next();
-
-      // Grab the three "root" vertices of these halfedges.
-      VertexIter v1 = h1->vertex();
-      VertexIter v2 = h2->vertex();
-      VertexIter v3 = h3->vertex();
-
-      // The output feature will keep track of the mesh the element comes from,
-      // as well as the depth coordinate associated with the current cursor location.
-      feature.node = this;
-      feature.w = w;
-
-      // Check if the cursor is closest to a vertex; if so, this is the feature we want to return.
-      if( barycentric_coords.x > high_threshold ) { feature.element = elementAddress( v1 ); return; }
-      if( barycentric_coords.y > high_threshold ) { feature.element = elementAddress( v2 ); return; }
-      if( barycentric_coords.z > high_threshold ) { feature.element = elementAddress( v3 ); return; }
-
-      // Next, check if the cursor is closest to an edge; if so, we return it.
-      if( barycentric_coords.z < low_threshold) { feature.element = elementAddress( h1->edge() ); return; }
-      if( barycentric_coords.x < low_threshold) { feature.element = elementAddress( h2->edge() ); return; }
-      if( barycentric_coords.y < low_threshold) { feature.element = elementAddress( h3->edge() ); return; }
-
-      // Finally, check if the cursor is closest to a halfedge; if so, we return the associated halfedge.
-      if( barycentric_coords.z < mid_threshold) { feature.element = elementAddress( h1 ); return; }
-      if( barycentric_coords.x < mid_threshold) { feature.element = elementAddress( h2 ); return; }
-      if( barycentric_coords.y < mid_threshold) { feature.element = elementAddress( h3 ); return; }
-
-      // Otherwise, the cursor is closest to the (middle of) the face itself.
-      feature.element = f;
-      return;
-   }
-
    void MeshEdit :: flipSelectedEdge( void )
    {
+      if( applyToSelectedEdges( EdgeBatch::FLIP ) ) return;
+
       Edge* e = selectedFeature.element->getEdge();
       if( e == NULL ) { cerr << "Must select an edge." << endl; return; }
-      selectedFeature.node->mesh.flipEdge( e->halfedge()->edge() );
+      lock_guard<mutex> lock( hoverPicker.dataMutex() );
+      DrawnMeshNode* node = static_cast<DrawnMeshNode*>( selectedFeature.node );
+      beginLocalEdit( node, e->halfedge()->edge() );
+      node->mesh.flipEdge( e->halfedge()->edge() );
+      endLocalEdit( node );
 
       // Since the mesh may have changed, the selected and
       // hovered features may no longer point to valid elements.
@@ -1495,9 +2183,15 @@ namespace CMU462 {
 
    void MeshEdit :: splitSelectedEdge( void )
    {
+      if( applyToSelectedEdges( EdgeBatch::SPLIT ) ) return;
+
       Edge* e = selectedFeature.element->getEdge();
       if( e == NULL ) { cerr << "Must select an edge." << endl; return; }
-      selectedFeature.node->mesh.splitEdge( e->halfedge()->edge() );
+      lock_guard<mutex> lock( hoverPicker.dataMutex() );
+      DrawnMeshNode* node = static_cast<DrawnMeshNode*>( selectedFeature.node );
+      beginLocalEdit( node, e->halfedge()->edge() );
+      node->mesh.splitEdge( e->halfedge()->edge() );
+      endLocalEdit( node );
 
       // Since the mesh may have changed, the selected and
       // hovered features may no longer point to valid elements.
@@ -1507,9 +2201,15 @@ namespace CMU462 {
 
    void MeshEdit :: collapseSelectedEdge( void )
    {
+      if( applyToSelectedEdges( EdgeBatch::COLLAPSE ) ) return;
+
       Edge* e = selectedFeature.element->getEdge();
       if( e == NULL ) { cerr << "Must select an edge." << endl; return; }
-      selectedFeature.node->mesh.collapseEdge( e->halfedge()->edge() );
+      lock_guard<mutex> lock( hoverPicker.dataMutex() );
+      DrawnMeshNode* node = static_cast<DrawnMeshNode*>( selectedFeature.node );
+      beginLocalEdit( node, e->halfedge()->edge() );
+      node->mesh.collapseEdge( e->halfedge()->edge() );
+      endLocalEdit( node );
 
       // Since the mesh may have changed, the selected and
       // hovered features may no longer point to valid elements.
@@ -1518,4 +2218,38 @@ namespace CMU462 {
    }
 
 
+   bool MeshEdit :: applyToSelectedEdges( EdgeBatch::Operation operation )
+   {
+      const char* names[] = { "Flipped", "Split", "Collapsed" };
+
+      lock_guard<mutex> lock( hoverPicker.dataMutex() );
+      bool any = false;
+      for( vector<DrawnMeshNode>::iterator node = meshNodes.begin(); node != meshNodes.end(); node++ )
+      {
+         if( node->selection.empty() ) continue;
+
+         // List the selected edges in mesh order (not in the order of the
+         // selection, which depends on their addresses), since EdgeBatch
+         // breaks ties between conflicting edges by their position.
+         vector<EdgeIter> edges;
+         for( EdgeIter e = node->mesh.edgesBegin(); e != node->mesh.edgesEnd(); e++ )
+         {
+            if( node->selection.count( &*e ) ) edges.push_back( e );
+         }
+         if( edges.empty() ) continue;
+         any = true;
+
+         Size n = edgeBatch.apply( node->mesh, edges, operation );
+         cerr << names[ operation ] << " " << n << " of " << edges.size() << " selected edges ("
+              << edgeBatch.nIllegal << " illegal, " << edgeBatch.nConflicting << " conflicting)." << endl;
+      }
+      if( !any ) return false;
+
+      // Update the picking structures once for the whole batch.
+      selectedFeature.invalidate();
+      hoveredFeature.invalidate();
+      invalidatePicking();
+      return true;
+   }
+
 } // namespace CMU462
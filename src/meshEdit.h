@@ -13,11 +13,26 @@
 #include "material.h"
 #include "halfEdgeMesh.h"
 #include "student_code.h"
+#include "remesher.h"
+#include "edgeFlipper.h"
+#include "adaptiveRefiner.h"
+#include "meshTask.h"
+#include "meshWorker.h"
+#include "meshNode.h"
+#include "asyncQuery.h"
+#include "idBuffer.h"
+#include "edgeBatch.h"
+#include "meshBuffers.h"
+#include "meshlets.h"
 
 #include <string>
 #include <iostream>
 #include <sstream>
 #include <algorithm>
+#include <chrono>
+#include <memory>
+#include <functional>
+#include <unordered_set>
 
 
 using namespace std;
@@ -73,135 +88,36 @@ namespace CMU462 {
      float vertexRadius;
   };
 
-  class MeshNode;
-
-  // A MeshFeature is used to represent an element of the surface selected
-  // by the user (e.g., edge, vertex, face).  No matter what kind of feature
-  // is selected, the feature is specified relative to some polygon in the
-  // mesh.  For instance, if an edge is selected, the MeshFeature will store
-  // a pointer to a face containing that edge, as well as the local index of
-  // the first (of two) vertices in the polygon corresponding to the edge.
-  class MeshFeature
-  {
-     public:
-        // By default, a mesh feature points nowhere!
-        MeshFeature( void )
-        : element( NULL ), node( NULL ), w( 0. )
-        {}
-
-        bool isValid( void ) const
-        // Returns true if and only if this feature points
-        // to some valid element of some valid mesh.
-        {
-           return element != NULL &&
-                     node != NULL;
-        }
-
-        void invalidate( void )
-        // Marks this feature as not pointing to anything.
-        {
-           element = NULL;
-              node = NULL;
-        }
-
-        HalfedgeElement* element; // which element is selected?
-        MeshNode* node; // which mesh node does this element come from?
-        double w; // what's the depth value for this selection?
-  };
-
-
-  /* MeshNode class, for use with the MeshEdit class.
-   * Intended for Assignment 2 of 15-462 at Carnegie Mellon University.
-   *
-   * Written by Bryce Summers on 9/14/2015.
-   *
-   * Computes useful stuff for meshes and renders them to the screen.
-   * Also provides functionality for applying visual styles to the mesh
-   * that match up with the MeshEdit picking system.
+  /* A MeshNode as drawn by the MeshEdit class, along with the OpenGL
+   * buffers holding its faces and edges.  Every node in MeshEdit::meshNodes
+   * is one, so the nodes referred to by picked features can be cast back.
    */
-   class MeshNode
+   class DrawnMeshNode : public MeshNode
    {
       public:
-         // Constructor.
-         MeshNode( Polymesh& polyMesh )
-         {
-
-            // Construct a new array of index lists for the halfedgemesh structure.
-            vector< vector<size_t> > polygons;
-
-            // Currently, the halfedge data structure only stores the connectivity of
-            // the mesh and the vertex positions; here we just want to copy the
-            // connectivity into our local array ("polygons").
-            for( PolyListIter p  = polyMesh.polygons.begin();
-                              p != polyMesh.polygons.end();
-                              p ++ )
-            {
-               polygons.push_back( p->vertex_indices );
-            }
-
-            mesh.build( polygons, polyMesh.vertices );
-         }
-
-         // Destructor --- this destructor shouldn't be needed according to the
-         // C++ spec, though some compilers seem to complain if there isn't a
-         // default destructor explicitly defined.  (May be worth checking up on
-         // later!)
-         ~MeshNode() {}
-
-
-         /* Returns the lower and upper corners of the axis aligned
-          * bounding box for the mesh
-          */
-         void getBounds( Vector3D& low, Vector3D& high );
-
-         // Centroid / weighted average point.
-         void getCentroid( Vector3D& centroid );
-
-
-         /* The following functions will be used for extracting model
-          * space triangluar data.
-          * These functions assume that all polygons are triangles.
-          * If a polygon has more than 3 vertices,
-          * only the first three vertices will be used.
-          * FIXME : Triangulate degenerate n > 3 gons.
-          */
-
-         /*
-          * populates the given feature structure with data corresponding to
-          * mesh feature on the face corresponding to the given lookup structure
-          * and bary_centric_coordinates.
-          * OUT : feature.
-          */
-         void fillFeatureStructure(MeshFeature & lookup,
-                                   MeshFeature & feature,
-                                   Vector3D    & barycentric_coords,
-                                   float w);
-
-
-         // representation of the mesh geometry itself
-         HalfedgeMesh mesh;
-
-         // This vector gives us indexed hooks into the half edge structure,
-         // which can be used to query information for the debugging messages.
-         std::vector<Vertex*> half_edge_vertices;
-
-      private:
-         // These thresholds define when a mouse click on given
-         // triangle corresponds to selection of a vertex, edge,
-         // or face; they are expressed as percent relative to
-         // barycentric coordinates. (Note that .3 is about halfway
-         // through the triangle.)
-         const double low_threshold  = .1;
-         const double mid_threshold  = .2;
-         const double high_threshold = 1.0 - low_threshold;
-
-   };// class MeshNode.
+         DrawnMeshNode( Polymesh& polyMesh )
+         : MeshNode( polyMesh )
+         {}
+
+         // Faces and edges packed into OpenGL buffers for drawing;
+         // likewise repacked after any change.
+         MeshBuffers buffers;
+
+         // Clusters of faces in the buffers, culled before drawing; rebuilt
+         // whenever the buffers are repacked or edited, and refit after
+         // vertices move.
+         Meshlets meshlets;
+   };
 
 
 // The viewer class the manages the viewing and rendering of Collada Files.
 class MeshEdit : public Renderer {
  public:
 
+  MeshEdit()
+  : hoverPicker( [this]( const PickQuery& query, MeshFeature& feature ) { pick( query, feature ); } )
+  { }
+
   // --  Inherited public interface functions.
   ~MeshEdit() { }
 
@@ -212,6 +128,8 @@ class MeshEdit : public Renderer {
   virtual std::string name();
   virtual std::string info();
 
+  virtual bool wants_frame();
+
   virtual void key_event( char key );
   virtual void cursor_event( float x, float y, unsigned char keys );
   virtual void scroll_event( float offset_x, float offset_y );
@@ -226,7 +144,7 @@ class MeshEdit : public Renderer {
   // --  Private Variables.
   Scene* scene;
 
-  vector<MeshNode> meshNodes;
+  vector<DrawnMeshNode> meshNodes;
 
   // View Frustrum Variables.
   float hfov; // FIXME : I would like to specify the view frustrum
@@ -274,6 +192,9 @@ class MeshEdit : public Renderer {
   void reset_camera();
 
   // Rendering functions.
+  bool useBuffers; // draw from MeshBuffers rather than in immediate mode? (toggled with 'b')
+  void renderMeshBuffers( DrawnMeshNode& node, const Matrix4x4& transform ); // transform: projection * modelview, for culling
+  void drawHighlights   ( DrawnMeshNode& node, bool faces ); // hovered/selected faces or edges, on top of the buffers
   void renderMesh   ( HalfedgeMesh& mesh );
   void drawFaces    ( HalfedgeMesh& mesh );
   void drawEdges    ( HalfedgeMesh& mesh );
@@ -293,6 +214,7 @@ class MeshEdit : public Renderer {
   DrawStyle defaultStyle; // style for elements that are neither hovered nor selected
   DrawStyle hoverStyle;   // style for element currently under the cursor
   DrawStyle selectStyle;  // style for currently selected element
+  DrawStyle regionStyle;  // style for elements in a box or lasso selection
   Color text_color;
 
   // -- Mouse input.
@@ -322,12 +244,96 @@ class MeshEdit : public Renderer {
   MeshFeature hoveredFeature;  // feature currently under the cursor
   MeshFeature selectedFeature; // feature last clicked on by the user
 
+  // Which picking algorithm to use (cycled with 'k').
+  enum PickEngine
+  {
+    PICK_BVH,
+    PICK_LINEAR,
+    PICK_ID_BUFFER,
+    N_PICK_ENGINES
+  };
+  PickEngine pickEngine;
+
+  // Everything the picking algorithm needs to know about the view,
+  // so that it can run away from the OpenGL context.
+  struct PickQuery
+  {
+    float x, y;                // cursor position
+    Matrix4x4 P, M;            // projection and modelview matrices
+    size_t screen_w, screen_h;
+    PickEngine engine;
+  };
+
   // Executes the picking algorithm.
-  // result stored in 'hover_selection'.
+  // result stored in 'hoveredFeature' (right away, or by the next
+  // frame if picking asynchronously).
   void findMouseSelection(float x, float y);
+  PickQuery pickQuery(float x, float y); // reads the current view
+  void pick( const PickQuery& query, MeshFeature& feature );
+  void findMouseSelectionBVH( const PickQuery& query, MeshFeature& feature );    // ray cast against each mesh's face BVH
+  void findMouseSelectionLinear( const PickQuery& query, MeshFeature& feature ); // projects every triangle onto the screen
+  void findMouseSelectionIDBuffer( const PickQuery& query, MeshFeature& feature ); // looks the cursor up in a rasterized ID buffer
+
+  // Rasterized triangle IDs of all meshes, and the view they were
+  // rendered for (invalidated along with the other picking structures).
+  IDBuffer idBuffer;
+  bool idBufferValid;
+  Matrix4x4 idBufferTransform;
+  size_t idBufferWidth, idBufferHeight;
+
+  // Runs hover picks on a background thread, latest cursor position
+  // first.  Code that modifies a mesh must hold its dataMutex().
+  AsyncQuery<PickQuery,MeshFeature> hoverPicker;
+  bool asyncPicking; // toggled with 'h'
+
+  // Marks the picking structures of every mesh as out of date;
+  // must be called whenever a mesh is modified (other than by the
+  // local edits below).  These methods also discard any hover pick
+  // that is in flight, so they must be called with the hoverPicker's
+  // dataMutex() held.  (invalidatePicking() and endLocalEdit() also
+  // clear box and lasso selections, whose elements may be gone.)
+  void invalidatePicking();
+
+  // Keep the picking structures of a mesh up to date with local edits:
+  // vertexMoved() after a vertex moves, and beginLocalEdit()/endLocalEdit()
+  // around a flip, split, or collapse of the given edge.  (The BVH is
+  // updated in place, unless it has degraded enough to need a rebuild.)
+  void vertexMoved( DrawnMeshNode* node, VertexIter v );
+  void beginLocalEdit( DrawnMeshNode* node, EdgeIter e );
+  void endLocalEdit( DrawnMeshNode* node );
   // Copies 'hover_selection' to 'current_selection' on mouse release.
   void enactPotentialSelection();
 
+  // -- Box and lasso selection.
+  // While a region mode is on, dragging with the left button outlines
+  // a region on the screen, and releasing it selects all elements of
+  // the chosen kind that lie inside (whether or not they are visible).
+  enum RegionMode
+  {
+    REGION_OFF,
+    REGION_BOX,
+    REGION_LASSO,
+    N_REGION_MODES
+  };
+  RegionMode regionMode; // cycled with 'g'
+
+  enum RegionElements
+  {
+    REGION_VERTICES,
+    REGION_EDGES,
+    REGION_FACES,
+    N_REGION_ELEMENTS
+  };
+  RegionElements regionElements; // cycled with 'e'
+
+  bool regionDragging;
+  vector<Vector2D> region; // outline dragged so far, in window coordinates
+
+  void selectRegion();      // replaces each node's selection with the elements inside 'region'
+  bool inRegionSelection( HalfedgeElement* element );
+  Size regionSelectionSize();
+  void drawRegion();        // draws the outline being dragged
+
   /**
    * IN: screen_x_offset -- offset in screen space in x direction.
    *     screen_y_offset -- offset in screen space in y direction.
@@ -338,25 +344,29 @@ class MeshEdit : public Renderer {
 					Vector3D & position);
 
 
-  inline bool triangleSelectionTest
-	(const Vector2D & selectionPoint,
-	 Vector4D & A, Vector4D & B, Vector4D & C,
-	 float & w,
-         Vector3D& barycentricCoordinates );
-
-  inline Vector2D unitCubeToScreenSpace(Vector4D & in);
-
 
 
   // -- Geometric Operations
-  // Local operations on current element.
+  // Local operations on current element (or, if a box or lasso selection
+  // contains edges, on all of its edges at once).
   void flipSelectedEdge( void );
   void splitSelectedEdge( void );
   void collapseSelectedEdge( void );
+  // Applies the given operation to the edges of the box or lasso
+  // selection; returns false if the selection contains no edges.
+  bool applyToSelectedEdges( EdgeBatch::Operation operation );
+  EdgeBatch edgeBatch;
   // Sets up and calls the MeshResampler with the appropiate operation.
   void mesh_up_sample();
   void mesh_down_sample();
   void mesh_resample();
+  // Runs the parallel isotropic remesher.
+  void mesh_remesh();
+  // Flips edges toward regular valence / toward a Delaunay triangulation.
+  void mesh_flip_valence();
+  void mesh_flip_delaunay();
+  // Splits the longest edges first, up to a face budget.
+  void mesh_refine();
 
   // If a halfedge is selected, advances to the next or twin halfedge.
   void selectNextHalfedge( void );
@@ -365,11 +375,42 @@ class MeshEdit : public Renderer {
   // The canonical resampler used to perform operations on meshes.
   MeshResampler resampler;
 
+  // Parallel isotropic remesher.
+  Remesher remesher;
+
+  // Worklist-driven edge flipping passes.
+  EdgeFlipper flipper;
+
+  // Longest-edge-first refinement.
+  AdaptiveRefiner refiner;
+
+  // -- Long-running operations.
+  // The operation currently in progress (if any), which is advanced by
+  // a time slice every frame so that the viewer stays responsive.
+  unique_ptr<MeshTask> task;
+  void startTask( MeshTask* newTask );
+  void runTask();
+  void cancelTask();
+
+  // When the buffers were last repacked, and how long that took (in
+  // seconds); used to limit how often they are repacked while a task runs.
+  chrono::steady_clock::time_point lastRepack;
+  double repackSeconds;
+
+  // Heavy operations can instead run on a copy of the mesh on a background
+  // thread, which is swapped in (by collectWorker()) once it's done.
+  MeshWorker worker;
+  HalfedgeMesh* workerMesh; // mesh that will receive the worker's result
+  bool useWorker;           // run operations in the background? (toggled with 'w')
+  void startOperation( const string& name, HalfedgeMesh* mesh, const function<void(HalfedgeMesh&)>& operation );
+  void collectWorker();
+
 
   // OSD text manager
   OSDText text_mgr;
 
-  vector<int> messages;
+  vector<int> messages; // OSD lines of the HUD, in drawing order
+  size_t nMessages;      // number of them drawn so far this frame
 
   // -- Debugging strings.
   bool showHUD;
@@ -0,0 +1,317 @@
+#include "meshGenerators.h"
+#include "mesh.h"
+#include "CMU462/trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <random>
+
+namespace CMU462
+{
+   static void addTriangle( PolygonList& polygons, Index a, Index b, Index c )
+   {
+      polygons.push_back( vector<Index>( 3 ) );
+      vector<Index>& p( polygons.back() );
+      p[0] = a; p[1] = b; p[2] = c;
+   }
+
+   // Splits the quad abcd (counterclockwise) into two triangles.
+   static void addQuad( PolygonList& polygons, Index a, Index b, Index c, Index d )
+   {
+      addTriangle( polygons, a, b, c );
+      addTriangle( polygons, a, c, d );
+   }
+
+   // Adds the triangles of an nu x nv grid of vertices (numbered row by
+   // row, u fastest), each range either open or wrapping around.
+   static void addGrid( PolygonList& polygons, Size nu, Size nv, bool wrapU, bool wrapV )
+   {
+      Size cu = wrapU ? nu : nu - 1;
+      Size cv = wrapV ? nv : nv - 1;
+      polygons.reserve( polygons.size() + 2 * cu * cv );
+      for( Index j = 0; j < cv; j++ )
+      {
+         Index j1 = ( j + 1 ) % nv;
+         for( Index i = 0; i < cu; i++ )
+         {
+            Index i1 = ( i + 1 ) % nu;
+            addQuad( polygons, j*nu + i, j*nu + i1, j1*nu + i1, j1*nu + i );
+         }
+      }
+   }
+
+   void icosphere( Size n, PolygonList& polygons, vector<Vector3D>& positions )
+   {
+      static const double t = ( 1. + sqrt( 5. ) ) / 2.;
+      static const double corners[12][3] = {
+         { -1.,  t,  0. }, {  1.,  t,  0. }, { -1., -t,  0. }, {  1., -t,  0. },
+         {  0., -1.,  t }, {  0.,  1.,  t }, {  0., -1., -t }, {  0.,  1., -t },
+         {  t,  0., -1. }, {  t,  0.,  1. }, { -t,  0., -1. }, { -t,  0.,  1. } };
+      static const Index faces[20][3] = {
+         { 0, 11,  5 }, { 0,  5,  1 }, { 0,  1,  7 }, { 0,  7, 10 }, { 0, 10, 11 },
+         { 1,  5,  9 }, { 5, 11,  4 }, { 11, 10, 2 }, { 10, 7,  6 }, { 7,  1,  8 },
+         { 3,  9,  4 }, { 3,  4,  2 }, { 3,  2,  6 }, { 3,  6,  8 }, { 3,  8,  9 },
+         { 4,  9,  5 }, { 2,  4, 11 }, { 6,  2, 10 }, { 8,  6,  7 }, { 9,  8,  1 } };
+
+      n = max( n, Size( 1 ) );
+      polygons.clear();
+      positions.clear();
+
+      // Vertices are numbered as the 12 corners, then the n-1 points inside
+      // each of the 30 edges (from its lower corner to its higher one), then
+      // the points inside each face.
+      map< pair<Index,Index>, Index > edgeNumber;
+      for( Index f = 0; f < 20; f++ )
+      {
+         for( Index k = 0; k < 3; k++ )
+         {
+            Index a = faces[f][k], b = faces[f][(k+1)%3];
+            pair<Index,Index> key( min( a, b ), max( a, b ) );
+            if( !edgeNumber.count( key ) )
+            {
+               Index e = edgeNumber.size();
+               edgeNumber[ key ] = e;
+            }
+         }
+      }
+      const Size nInterior = n >= 3 ? ( n - 1 ) * ( n - 2 ) / 2 : 0;
+      const Index firstEdgePoint = 12;
+      const Index firstFacePoint = 12 + 30 * ( n - 1 );
+      positions.resize( firstFacePoint + 20 * nInterior );
+
+      for( Index c = 0; c < 12; c++ )
+      {
+         positions[c] = Vector3D( corners[c][0], corners[c][1], corners[c][2] ).unit();
+      }
+
+      // Number of the point at step s (0..n) along the edge from corner a to b.
+      auto edgePoint = [&]( Index a, Index b, Index s ) -> Index
+      {
+         if( s == 0 ) return a;
+         if( s == n ) return b;
+         Index e = edgeNumber[ pair<Index,Index>( min( a, b ), max( a, b ) ) ];
+         return firstEdgePoint + e * ( n - 1 ) + ( a < b ? s : n - s ) - 1;
+      };
+
+      // Point (i,j) of face f lies at a + i/n (b-a) + j/n (c-a), for i+j <= n.
+      vector<Index> grid( ( n + 1 ) * ( n + 1 ) );
+      polygons.reserve( 20 * n * n );
+      for( Index f = 0; f < 20; f++ )
+      {
+         Index a = faces[f][0], b = faces[f][1], c = faces[f][2];
+         Vector3D A( positions[a] ), B( positions[b] ), C( positions[c] );
+         Index next = firstFacePoint + f * nInterior;
+
+         for( Index j = 0; j <= n; j++ )
+         {
+            for( Index i = 0; i + j <= n; i++ )
+            {
+               Index v;
+               if     ( j == 0     ) v = edgePoint( a, b, i );
+               else if( i == 0     ) v = edgePoint( a, c, j );
+               else if( i + j == n ) v = edgePoint( b, c, j );
+               else
+               {
+                  v = next++;
+                  positions[v] = ( A + double( i ) / n * ( B - A ) + double( j ) / n * ( C - A ) ).unit();
+               }
+               grid[ j*(n+1) + i ] = v;
+            }
+         }
+
+         // Positions of points on edges are set by every face sharing the
+         // edge, to the same value.
+         for( Index s = 1; s < n; s++ )
+         {
+            positions[ edgePoint( a, b, s ) ] = ( A + double( s ) / n * ( B - A ) ).unit();
+            positions[ edgePoint( a, c, s ) ] = ( A + double( s ) / n * ( C - A ) ).unit();
+            positions[ edgePoint( b, c, s ) ] = ( B + double( s ) / n * ( C - B ) ).unit();
+         }
+
+         for( Index j = 0; j < n; j++ )
+         {
+            for( Index i = 0; i + j < n; i++ )
+            {
+               addTriangle( polygons, grid[ j*(n+1) + i ], grid[ j*(n+1) + i+1 ], grid[ (j+1)*(n+1) + i ] );
+               if( i + j + 1 < n )
+               {
+                  addTriangle( polygons, grid[ j*(n+1) + i+1 ], grid[ (j+1)*(n+1) + i+1 ], grid[ (j+1)*(n+1) + i ] );
+               }
+            }
+         }
+      }
+   }
+
+   void torus( Size nu, Size nv, double R, double r, PolygonList& polygons, vector<Vector3D>& positions )
+   {
+      nu = max( nu, Size( 3 ) );
+      nv = max( nv, Size( 3 ) );
+      polygons.clear();
+      positions.resize( nu * nv );
+
+      for( Index j = 0; j < nv; j++ )
+      {
+         double v = 2. * M_PI * j / nv;
+         for( Index i = 0; i < nu; i++ )
+         {
+            double u = 2. * M_PI * i / nu;
+            positions[ j*nu + i ] = Vector3D( ( R + r * cos( v ) ) * cos( u ),
+                                              ( R + r * cos( v ) ) * sin( u ),
+                                              r * sin( v ) );
+         }
+      }
+      addGrid( polygons, nu, nv, true, true );
+   }
+
+   void heightField( Size n, double amplitude, PolygonList& polygons, vector<Vector3D>& positions )
+   {
+      n = max( n, Size( 1 ) );
+      polygons.clear();
+      positions.resize( ( n + 1 ) * ( n + 1 ) );
+
+      for( Index j = 0; j <= n; j++ )
+      {
+         double y = -1. + 2. * j / n;
+         for( Index i = 0; i <= n; i++ )
+         {
+            double x = -1. + 2. * i / n;
+            double z = amplitude * ( sin( 3. * x ) * cos( 2. * y ) +
+                                     .5 * sin( 7. * x + 5. * y ) +
+                                     .25 * cos( 13. * x * y ) );
+            positions[ j*(n+1) + i ] = Vector3D( x, y, z );
+         }
+      }
+      addGrid( polygons, n + 1, n + 1, false, false );
+   }
+
+   void noisyTube( Size nAround, Size nAlong, double noise, unsigned seed, PolygonList& polygons, vector<Vector3D>& positions )
+   {
+      nAround = max( nAround, Size( 3 ) );
+      nAlong = max( nAlong, Size( 1 ) );
+      polygons.clear();
+      positions.resize( nAround * ( nAlong + 1 ) );
+
+      // A few waves that wrap around the axis, with random frequencies
+      // and phases.
+      mt19937 random( seed );
+      uniform_real_distribution<double> uniform( 0., 1. );
+      const int nWaves = 4;
+      double around[nWaves], along[nWaves], phase[nWaves];
+      for( int k = 0; k < nWaves; k++ )
+      {
+         around[k] = 1 + int( 6 * uniform( random ) );
+         along[k] = 4. * uniform( random );
+         phase[k] = 2. * M_PI * uniform( random );
+      }
+
+      for( Index j = 0; j <= nAlong; j++ )
+      {
+         double z = -2. + 4. * j / nAlong;
+         for( Index i = 0; i < nAround; i++ )
+         {
+            double theta = 2. * M_PI * i / nAround;
+            double wave = 0.;
+            for( int k = 0; k < nWaves; k++ ) wave += sin( around[k] * theta + along[k] * z + phase[k] ) / nWaves;
+            double jitter = 2. * uniform( random ) - 1.;
+            double radius = 1. + noise * ( .8 * wave + .2 * jitter );
+            positions[ j*nAround + i ] = Vector3D( radius * cos( theta ), radius * sin( theta ), z );
+         }
+      }
+      addGrid( polygons, nAround, nAlong + 1, true, false );
+   }
+
+   bool parseGeneratorSpec( const string& spec, string& shape, Size& nFaces )
+   {
+      size_t colon = spec.find( ':' );
+      if( colon == string::npos ) return false;
+
+      shape = spec.substr( 0, colon );
+      if( shape != "icosphere" && shape != "torus" && shape != "grid" && shape != "tube" ) return false;
+
+      // Only plain decimals (strtod() would also take "inf", "nan" and hex).
+      string count = spec.substr( colon + 1 );
+      size_t digits = count.find_first_not_of( "0123456789." );
+      if( digits == 0 || count.find( '.' ) != count.rfind( '.' ) ) return false;
+      if( digits != string::npos && digits + 1 != count.size() ) return false;
+
+      char* end;
+      double x = strtod( count.c_str(), &end );
+      if( end == count.c_str() ) return false;
+      switch( *end )
+      {
+         case '\0':           break;
+         case 'k': case 'K': x *= 1e3; end++; break;
+         case 'm': case 'M': x *= 1e6; end++; break;
+         case 'g': case 'G': x *= 1e9; end++; break;
+         default: return false;
+      }
+      // (far beyond anything that fits in memory, but still a valid Size)
+      const double maxFaces = 1e12;
+      if( *end != '\0' || !isfinite( x ) || x < 1. || x > maxFaces ) return false;
+
+      nFaces = Size( x );
+      return true;
+   }
+
+   bool generateMesh( const string& spec, PolygonList& polygons, vector<Vector3D>& positions )
+   {
+      string shape;
+      Size nFaces;
+      if( !parseGeneratorSpec( spec, shape, nFaces ) ) return false;
+
+      TRACE_SCOPE( "generateMesh" );
+
+      double F = double( nFaces );
+      if( shape == "icosphere" )
+      {
+         icosphere( Size( max( 1., floor( sqrt( F / 20. ) + .5 ) ) ), polygons, positions );
+      }
+      else if( shape == "torus" )
+      {
+         // three times as many steps around the axis as around the tube
+         Size nv = Size( max( 3., floor( sqrt( F / 6. ) + .5 ) ) );
+         Size nu = Size( max( 3., floor( F / ( 2. * nv ) + .5 ) ) );
+         torus( nu, nv, 1., 1. / 3., polygons, positions );
+      }
+      else if( shape == "grid" )
+      {
+         heightField( Size( max( 1., floor( sqrt( F / 2. ) + .5 ) ) ), .1, polygons, positions );
+      }
+      else
+      {
+         // four times as many steps along the axis as around it
+         Size nAround = Size( max( 3., floor( sqrt( F / 8. ) + .5 ) ) );
+         Size nAlong  = Size( max( 1., floor( F / ( 2. * nAround ) + .5 ) ) );
+         noisyTube( nAround, nAlong, .1, 462, polygons, positions );
+      }
+      return true;
+   }
+
+   bool generateScene( const string& spec, Scene* scene )
+   {
+      PolygonList polygons;
+      vector<Vector3D> positions;
+      if( !generateMesh( spec, polygons, positions ) ) return false;
+
+      Polymesh* polymesh = new Polymesh();
+      polymesh->type = POLYMESH;
+      polymesh->id = polymesh->name = spec;
+      polymesh->material = NULL;
+      polymesh->vertices.swap( positions );
+      polymesh->polygons.resize( polygons.size() );
+      for( Index i = 0; i < polygons.size(); i++ )
+      {
+         polymesh->polygons[i].vertex_indices.swap( polygons[i] );
+      }
+
+      Node node;
+      node.id = node.name = spec;
+      node.instance = polymesh;
+      node.transform = Matrix4x4::identity();
+      scene->nodes.push_back( node );
+      return true;
+   }
+
+} // namespace CMU462
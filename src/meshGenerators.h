@@ -0,0 +1,83 @@
+/*
+ * Procedural meshes of arbitrary resolution.
+ *
+ * The bundled models are all small (the largest, peter.dae, has 40K
+ * faces).  These generators produce triangle meshes of any size, in the
+ * form taken by HalfedgeMesh::build(), so that algorithms can be timed
+ * over a range of sizes without shipping huge files:
+ *
+ *    icosphere   a subdivided icosahedron, projected onto the unit sphere
+ *                (closed, nearly uniform triangles)
+ *    torus       a ring around the z axis (closed, with genus one)
+ *    grid        a height field over a square (open, with one boundary)
+ *    tube        an open cylinder with a noisy radius (two boundaries,
+ *                irregular triangles)
+ *
+ * Each can be made from its own resolution parameters, or from a "spec"
+ * naming a shape and an approximate number of faces, e.g., "torus:2M";
+ * the counts accept a K, M or G suffix.  Random choices use a fixed seed,
+ * so a spec always describes the same mesh.
+ */
+
+#ifndef CMU462_MESHGENERATORS_H
+#define CMU462_MESHGENERATORS_H
+
+#include <string>
+#include <vector>
+
+#include "halfEdgeMesh.h"
+#include "scene.h"
+
+namespace CMU462
+{
+   typedef vector< vector<Index> > PolygonList;
+
+   /**
+    * Icosahedron whose faces are each split into n*n triangles
+    * (20*n*n faces in all), with every vertex on the unit sphere.
+    */
+   void icosphere( Size n, PolygonList& polygons, vector<Vector3D>& positions );
+
+   /**
+    * Torus with major radius R and minor radius r, split into nu steps
+    * around the z axis and nv steps around the tube (2*nu*nv faces).
+    */
+   void torus( Size nu, Size nv, double R, double r, PolygonList& polygons, vector<Vector3D>& positions );
+
+   /**
+    * Height field over [-1,1]x[-1,1], split into n*n squares (2*n*n
+    * faces), whose height is a sum of a few waves of the given amplitude.
+    */
+   void heightField( Size n, double amplitude, PolygonList& polygons, vector<Vector3D>& positions );
+
+   /**
+    * Open cylinder of radius 1 and height 4 along the z axis, split into
+    * nAround steps around the axis and nAlong steps along it (2*nAround*nAlong
+    * faces).  The radius varies by up to the given relative amount, as a sum
+    * of smooth waves plus random jitter at every vertex.
+    */
+   void noisyTube( Size nAround, Size nAlong, double noise, unsigned seed, PolygonList& polygons, vector<Vector3D>& positions );
+
+   /**
+    * Parses a spec of the form "shape:faces".  Returns false if the shape
+    * is unknown or the count is invalid.
+    */
+   bool parseGeneratorSpec( const string& spec, string& shape, Size& nFaces );
+
+   /**
+    * Generates the mesh described by a spec, choosing the resolution that
+    * comes closest to the requested number of faces.  Returns false (and
+    * generates nothing) if the spec is invalid.
+    */
+   bool generateMesh( const string& spec, PolygonList& polygons, vector<Vector3D>& positions );
+
+   /**
+    * Same as generateMesh(), but adds the mesh to a scene, as a single
+    * Polymesh node (without a material) named after the spec, e.g., to
+    * save it with ColladaParser::save().
+    */
+   bool generateScene( const string& spec, Scene* scene );
+
+} // namespace CMU462
+
+#endif // CMU462_MESHGENERATORS_H
@@ -0,0 +1,141 @@
+#include "meshNode.h"
+#include "meshOps.h"
+
+#include <iostream>
+#include <limits>
+
+namespace CMU462 {
+
+   void MeshNode::getBounds( Vector3D& low, Vector3D& high )
+   {
+      double maxValue = numeric_limits<double>::max();
+
+      low.x = maxValue; high.x = -maxValue;
+      low.y = maxValue; high.y = -maxValue;
+      low.z = maxValue; high.z = -maxValue;
+
+      for( VertexIter v = mesh.verticesBegin(); v != mesh.verticesEnd(); v++ )
+      {
+         Vector3D& p = v->position;
+
+         low.x = min( low.x, p.x );
+         low.y = min( low.y, p.y );
+         low.z = min( low.z, p.z );
+
+         high.x = max( high.x, p.x );
+         high.y = max( high.y, p.y );
+         high.z = max( high.z, p.z );
+      }
+   }
+
+   // Centroid / weighted average point.
+   void MeshNode::getCentroid( Vector3D& centroid )
+   {
+      centroid = Vector3D( 0., 0., 0. );
+
+      for( VertexIter v = mesh.verticesBegin(); v != mesh.verticesEnd(); v++ )
+      {
+         centroid += v->position;
+      }
+
+      centroid /= (double) mesh.nVertices();
+   }
+
+   void MeshNode::writePolymesh( Polymesh& polyMesh )
+   {
+      vector<VertexIter> vertices;
+      indexVertices( mesh, vertices );
+
+      polyMesh.vertices.resize( vertices.size() );
+      for( Index i = 0; i < vertices.size(); i++ )
+      {
+         polyMesh.vertices[i] = vertices[i]->position;
+      }
+      polyMesh.normals.clear();
+      polyMesh.texcoords.clear();
+
+      polyMesh.polygons.clear();
+      polyMesh.polygons.reserve( mesh.nFaces() );
+      for( FaceIter f = mesh.facesBegin(); f != mesh.facesEnd(); f++ )
+      {
+         Polygon p;
+         HalfedgeIter h = f->halfedge();
+         do
+         {
+            p.vertex_indices.push_back( h->vertex()->index );
+            h = h->next();
+         }
+         while( h != f->halfedge() );
+         polyMesh.polygons.push_back( p );
+      }
+   }
+
+   /*
+    * populates the given feature structure with data cooresponding to
+    * mesh feature on the face cooresponding to the given lookup structure
+    * and bary_centric_coordinates.
+    * OUT : feature.
+    * IN : Lookup location : Which triangular face.
+    * barycentric_coordates : Where on the face is the mouse pointing to.
+    *  - Determines whether the user wants the face, an edge, or a vertex.
+    *  - Vector(A%, B%, C%), where ABC are in index order after the lookup location.
+    */
+   void MeshNode::fillFeatureStructure(
+         // OUTPUT:
+         MeshFeature & feature,
+
+         // INPUTS:
+         MeshFeature & lookup,
+         Vector3D    & barycentric_coords,
+         float w )
+   {
+      /* Feature on Face Selection algorithm.
+       *
+       * coordinate c is low  if (c < low_threshold)
+       * coordinate c is mid  if (low_threshold <= low_threshold <= high_hold)
+       * coordinate c is high if (c > high_threshold)
+       */
+
+      Face* f = lookup.element->getFace();
+      if( f == NULL )
+      {
+         cerr << "Error in Mesh::fillFeatureStructure(): we were asked to find a feature associated with an element that is not a face!" << endl;
+         exit( 1 );
+      }
+
+      // Grab the three halfedges of the triangle under the cursor.
+      HalfedgeIter h1 = f->halfedge();
+      HalfedgeIter h2 = h1->next();
+      HalfedgeIter h3 = h2->next();
+
+      // Grab the three "root" vertices of these halfedges.
+      VertexIter v1 = h1->vertex();
+      VertexIter v2 = h2->vertex();
+      VertexIter v3 = h3->vertex();
+
+      // The output feature will keep track of the mesh the element comes from,
+      // as well as the depth coordinate associated with the current cursor location.
+      feature.node = this;
+      feature.w = w;
+
+      // Check if the cursor is closest to a vertex; if so, this is the feature we want to return.
+      if( barycentric_coords.x > high_threshold ) { feature.element = elementAddress( v1 ); return; }
+      if( barycentric_coords.y > high_threshold ) { feature.element = elementAddress( v2 ); return; }
+      if( barycentric_coords.z > high_threshold ) { feature.element = elementAddress( v3 ); return; }
+
+      // Next, check if the cursor is closest to an edge; if so, we return it.
+      if( barycentric_coords.z < low_threshold) { feature.element = elementAddress( h1->edge() ); return; }
+      if( barycentric_coords.x < low_threshold) { feature.element = elementAddress( h2->edge() ); return; }
+      if( barycentric_coords.y < low_threshold) { feature.element = elementAddress( h3->edge() ); return; }
+
+      // Finally, check if the cursor is closest to a halfedge; if so, we return the associated halfedge.
+      if( barycentric_coords.z < mid_threshold) { feature.element = elementAddress( h1 ); return; }
+      if( barycentric_coords.x < mid_threshold) { feature.element = elementAddress( h2 ); return; }
+      if( barycentric_coords.y < mid_threshold) { feature.element = elementAddress( h3 ); return; }
+
+      // Otherwise, the cursor is closest to the (middle of) the face itself.
+      feature.element = f;
+      return;
+   }
+
+} // namespace CMU462
@@ -0,0 +1,170 @@
+/*
+ * The mesh of a single Polymesh node in a scene, converted to a
+ * HalfedgeMesh, along with the state used to pick its elements.
+ *
+ * None of this depends on OpenGL, so that the command-line tools can
+ * load, edit and save meshes the same way as the editor does.
+ */
+
+#ifndef CMU462_MESHNODE_H
+#define CMU462_MESHNODE_H
+
+#include <vector>
+#include <unordered_set>
+
+#include "halfEdgeMesh.h"
+#include "faceBVH.h"
+#include "screenProjection.h"
+
+namespace CMU462 {
+
+  class MeshNode;
+
+  // A MeshFeature is used to represent an element of the surface selected
+  // by the user (e.g., edge, vertex, face).  No matter what kind of feature
+  // is selected, the feature is specified relative to some polygon in the
+  // mesh.  For instance, if an edge is selected, the MeshFeature will store
+  // a pointer to a face containing that edge, as well as the local index of
+  // the first (of two) vertices in the polygon corresponding to the edge.
+  class MeshFeature
+  {
+     public:
+        // By default, a mesh feature points nowhere!
+        MeshFeature( void )
+        : element( NULL ), node( NULL ), w( 0. )
+        {}
+
+        bool isValid( void ) const
+        // Returns true if and only if this feature points
+        // to some valid element of some valid mesh.
+        {
+           return element != NULL &&
+                     node != NULL;
+        }
+
+        void invalidate( void )
+        // Marks this feature as not pointing to anything.
+        {
+           element = NULL;
+              node = NULL;
+        }
+
+        HalfedgeElement* element; // which element is selected?
+        MeshNode* node; // which mesh node does this element come from?
+        double w; // what's the depth value for this selection?
+  };
+
+
+  /* MeshNode class, for use with the MeshEdit class.
+   * Intended for Assignment 2 of 15-462 at Carnegie Mellon University.
+   *
+   * Written by Bryce Summers on 9/14/2015.
+   *
+   * Computes useful stuff for meshes, and holds the state used to pick
+   * their elements.  Drawing is left to MeshEdit (see DrawnMeshNode), so
+   * that meshes can also be built, edited and saved without OpenGL.
+   */
+   class MeshNode
+   {
+      public:
+         // Constructor.
+         MeshNode( Polymesh& polyMesh )
+         : bvhValid( false ), projectionValid( false )
+         {
+
+            // Construct a new array of index lists for the halfedgemesh structure.
+            vector< vector<size_t> > polygons;
+
+            // Currently, the halfedge data structure only stores the connectivity of
+            // the mesh and the vertex positions; here we just want to copy the
+            // connectivity into our local array ("polygons").
+            for( PolyListIter p  = polyMesh.polygons.begin();
+                              p != polyMesh.polygons.end();
+                              p ++ )
+            {
+               polygons.push_back( p->vertex_indices );
+            }
+
+            mesh.build( polygons, polyMesh.vertices );
+         }
+
+         // Destructor --- this destructor shouldn't be needed according to the
+         // C++ spec, though some compilers seem to complain if there isn't a
+         // default destructor explicitly defined.  (May be worth checking up on
+         // later!)
+         ~MeshNode() {}
+
+
+         /* Returns the lower and upper corners of the axis aligned
+          * bounding box for the mesh
+          */
+         void getBounds( Vector3D& low, Vector3D& high );
+
+         // Centroid / weighted average point.
+         void getCentroid( Vector3D& centroid );
+
+         /* Writes the current mesh back into the given polygon mesh,
+          * e.g., for saving.  Normals and texture coordinates are dropped,
+          * since they no longer match the polygons after any edit.
+          * Numbers the vertices as a side effect (see indexVertices()).
+          */
+         void writePolymesh( Polymesh& polyMesh );
+
+
+         /* The following functions will be used for extracting model
+          * space triangluar data.
+          * These functions assume that all polygons are triangles.
+          * If a polygon has more than 3 vertices,
+          * only the first three vertices will be used.
+          * FIXME : Triangulate degenerate n > 3 gons.
+          */
+
+         /*
+          * populates the given feature structure with data corresponding to
+          * mesh feature on the face corresponding to the given lookup structure
+          * and bary_centric_coordinates.
+          * OUT : feature.
+          */
+         void fillFeatureStructure(MeshFeature & lookup,
+                                   MeshFeature & feature,
+                                   Vector3D    & barycentric_coords,
+                                   float w);
+
+
+         // representation of the mesh geometry itself
+         HalfedgeMesh mesh;
+
+         // Hierarchy over the faces of the mesh, used for picking.  It is
+         // updated in place after local edits, and rebuilt (lazily) after
+         // any other change to the mesh, which is signaled by clearing bvhValid.
+         FaceBVH bvh;
+         bool bvhValid;
+
+         // Flat copy of the mesh, projected onto the screen when picking
+         // without the BVH; likewise regathered after any change.
+         ScreenProjection projection;
+         bool projectionValid;
+
+         // Elements chosen by the last box or lasso selection (see
+         // MeshEdit::selectRegion()); cleared whenever the mesh changes.
+         unordered_set<HalfedgeElement*> selection;
+
+         // This vector gives us indexed hooks into the half edge structure,
+         // which can be used to query information for the debugging messages.
+         std::vector<Vertex*> half_edge_vertices;
+
+      private:
+         // These thresholds define when a mouse click on given
+         // triangle corresponds to selection of a vertex, edge,
+         // or face; they are expressed as percent relative to
+         // barycentric coordinates. (Note that .3 is about halfway
+         // through the triangle.)
+         const double low_threshold  = .1;
+         const double mid_threshold  = .2;
+         const double high_threshold = 1.0 - low_threshold;
+
+   };// class MeshNode.
+
+} // namespace CMU462
+
+#endif // CMU462_MESHNODE_H
@@ -0,0 +1,262 @@
+#include "meshOps.h"
+
+#include <cstring>
+#include <algorithm>
+
+namespace CMU462
+{
+   Size valence( VertexCIter v )
+   {
+      Size n = 0;
+
+      HalfedgeCIter h = v->halfedge();
+      do
+      {
+         n++;
+         h = h->twin()->next();
+      }
+      while( h != v->halfedge() );
+
+      return n;
+   }
+
+   // Returns true if and only if the given vertices are joined by an edge.
+   static bool adjacent( VertexCIter u, VertexCIter v )
+   {
+      HalfedgeCIter h = u->halfedge();
+      do
+      {
+         if( h->twin()->vertex() == v )
+         {
+            return true;
+         }
+         h = h->twin()->next();
+      }
+      while( h != u->halfedge() );
+
+      return false;
+   }
+
+   // Returns true if and only if the given halfedge sits on a triangle.
+   static bool onTriangle( HalfedgeCIter h )
+   {
+      return h->next()->next()->next() == h;
+   }
+
+   bool canFlip( EdgeIter e )
+   {
+      HalfedgeIter h0 = e->halfedge();
+      HalfedgeIter h1 = h0->twin();
+
+      // Only interior edges between two triangles can be flipped.
+      if( h0->isBoundary() || h1->isBoundary() ) return false;
+      if( !onTriangle( h0 ) || !onTriangle( h1 ) ) return false;
+
+      VertexIter a = h0->vertex();
+      VertexIter b = h1->vertex();
+      VertexIter c = h0->next()->next()->vertex();
+      VertexIter d = h1->next()->next()->vertex();
+
+      // The endpoints each lose an edge; don't let them become degenerate.
+      if( valence( a ) <= ( a->isBoundary() ? 2 : 3 ) ) return false;
+      if( valence( b ) <= ( b->isBoundary() ? 2 : 3 ) ) return false;
+
+      // The flipped edge must not already exist.
+      return c != d && !adjacent( c, d );
+   }
+
+   bool canSplit( EdgeIter e )
+   {
+      HalfedgeIter h0 = e->halfedge();
+      HalfedgeIter h1 = h0->twin();
+
+      if( !h0->isBoundary() && !onTriangle( h0 ) ) return false;
+      if( !h1->isBoundary() && !onTriangle( h1 ) ) return false;
+
+      return true;
+   }
+
+   bool canCollapse( EdgeIter e )
+   {
+      HalfedgeIter h0 = e->halfedge();
+      HalfedgeIter h1 = h0->twin();
+
+      // Only interior edges between two triangles are collapsed.
+      if( h0->isBoundary() || h1->isBoundary() ) return false;
+      if( !onTriangle( h0 ) || !onTriangle( h1 ) ) return false;
+
+      VertexIter a = h0->vertex();
+      VertexIter b = h1->vertex();
+      VertexIter c = h0->next()->next()->vertex();
+      VertexIter d = h1->next()->next()->vertex();
+
+      // An interior edge joining two boundary vertices would pinch the surface.
+      if( a->isBoundary() && b->isBoundary() ) return false;
+
+      // Link condition: the endpoints may share no neighbors other than c and d.
+      // (One-rings are small, so a quadratic search beats building a set.)
+      Size shared = 0;
+      HalfedgeIter ha = a->halfedge();
+      do
+      {
+         VertexIter u = ha->twin()->vertex();
+         HalfedgeIter hb = b->halfedge();
+         do
+         {
+            if( hb->twin()->vertex() == u )
+            {
+               shared++;
+               break;
+            }
+            hb = hb->twin()->next();
+         }
+         while( hb != b->halfedge() );
+
+         ha = ha->twin()->next();
+      }
+      while( ha != a->halfedge() );
+
+      if( shared != 2 ) return false;
+
+      // Neither the merged vertex nor the two opposite vertices may end up with fewer than three edges.
+      if( valence( a ) + valence( b ) - 4 < 3 ) return false;
+      if( valence( c ) <= 3 || valence( d ) <= 3 ) return false;
+
+      return true;
+   }
+
+   void indexVertices( HalfedgeMesh& mesh, vector<VertexIter>& vertices )
+   {
+      vertices.clear();
+      vertices.reserve( mesh.nVertices() );
+
+      Index i = 0;
+      for( VertexIter v = mesh.verticesBegin(); v != mesh.verticesEnd(); v++ )
+      {
+         v->index = i++;
+         vertices.push_back( v );
+      }
+   }
+
+   void indexEdges( HalfedgeMesh& mesh, vector<EdgeIter>& edges )
+   {
+      edges.clear();
+      edges.reserve( mesh.nEdges() );
+
+      Index i = 0;
+      for( EdgeIter e = mesh.edgesBegin(); e != mesh.edgesEnd(); e++ )
+      {
+         e->index = i++;
+         edges.push_back( e );
+      }
+   }
+
+   void indexFaces( HalfedgeMesh& mesh, vector<FaceIter>& faces )
+   {
+      faces.clear();
+      faces.reserve( mesh.nFaces() );
+
+      Index i = 0;
+      for( FaceIter f = mesh.facesBegin(); f != mesh.facesEnd(); f++ )
+      {
+         f->index = i++;
+         faces.push_back( f );
+      }
+   }
+
+   void edgeQuad( EdgeIter e, vector<Index>& region )
+   {
+      region.clear();
+
+      HalfedgeIter h0 = e->halfedge();
+      HalfedgeIter h1 = h0->twin();
+
+      region.push_back( h0->vertex()->index );
+      region.push_back( h1->vertex()->index );
+      if( !h0->isBoundary() ) region.push_back( h0->next()->next()->vertex()->index );
+      if( !h1->isBoundary() ) region.push_back( h1->next()->next()->vertex()->index );
+   }
+
+   void edgeNeighborhood( EdgeIter e, vector<Index>& region )
+   {
+      region.clear();
+
+      HalfedgeIter h0 = e->halfedge();
+      HalfedgeIter h1 = h0->twin();
+
+      region.push_back( h0->vertex()->index );
+      region.push_back( h1->vertex()->index );
+
+      // The neighbors of each endpoint (which include the other endpoint).
+      HalfedgeIter h = h0;
+      do
+      {
+         region.push_back( h->twin()->vertex()->index );
+         h = h->twin()->next();
+      }
+      while( h != h0 );
+
+      h = h1;
+      do
+      {
+         region.push_back( h->twin()->vertex()->index );
+         h = h->twin()->next();
+      }
+      while( h != h1 );
+   }
+
+   void VertexReservation::reset( Size nVertices )
+   {
+      if( nVertices > capacity )
+      {
+         slots.reset( new atomic<uint64_t>[ nVertices ] );
+         capacity = nVertices;
+      }
+      size = nVertices;
+
+      const long n = size;
+      #pragma omp parallel for schedule(static)
+      for( long i = 0; i < n; i++ )
+      {
+         slots[i].store( UINT64_MAX, memory_order_relaxed );
+      }
+   }
+
+   void VertexReservation::reserve( const vector<Index>& region, uint64_t key )
+   {
+      for( vector<Index>::const_iterator i = region.begin(); i != region.end(); i++ )
+      {
+         // Atomic minimum: keep trying until either we hold the
+         // slot, or somebody with a smaller key got there first.
+         atomic<uint64_t>& slot = slots[*i];
+         uint64_t current = slot.load( memory_order_relaxed );
+         while( key < current && !slot.compare_exchange_weak( current, key, memory_order_relaxed ) );
+      }
+   }
+
+   bool VertexReservation::holds( const vector<Index>& region, uint64_t key ) const
+   {
+      for( vector<Index>::const_iterator i = region.begin(); i != region.end(); i++ )
+      {
+         if( slots[*i].load( memory_order_relaxed ) != key )
+         {
+            return false;
+         }
+      }
+
+      return true;
+   }
+
+   uint64_t VertexReservation::key( float score, Index id )
+   {
+      // The bit patterns of non-negative floats sort in the same
+      // order as the floats themselves, so we can use them directly
+      // as the high-order bits of the key.
+      score = max( score, 0.f );
+      uint32_t bits;
+      memcpy( &bits, &score, sizeof( bits ) );
+
+      return ( uint64_t( bits ) << 32 ) | uint64_t( id & 0xffffffff );
+   }
+
+} // namespace CMU462
@@ -0,0 +1,106 @@
+/*
+ * Helpers shared by algorithms that apply many local operations
+ * (flips, splits, collapses) to a triangle mesh at once.
+ */
+
+#ifndef CMU462_MESHOPS_H
+#define CMU462_MESHOPS_H
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+
+#include "halfEdgeMesh.h"
+
+namespace CMU462
+{
+   /*
+    * Legality tests for the local operations on a triangle mesh.  An
+    * algorithm that applies operations in bulk should only ever call
+    * HalfedgeMesh::flipEdge(), splitEdge() and collapseEdge() on edges
+    * that pass these tests, since the operations themselves are allowed
+    * to assume a "nice" neighborhood.
+    */
+   bool canFlip    ( EdgeIter e ); ///< interior edge between two triangles, whose flip keeps the mesh manifold
+   bool canSplit   ( EdgeIter e ); ///< every non-boundary face touching the edge is a triangle
+   bool canCollapse( EdgeIter e ); ///< interior edge satisfying the link condition
+
+   /**
+    * Returns the number of edges incident on the given vertex
+    * (unlike Vertex::degree(), boundary edges are also counted).
+    */
+   Size valence( VertexCIter v );
+
+   /*
+    * These methods number the elements of the given mesh (storing the
+    * number in the element's "index" field) and return iterators to
+    * all elements in index order, so that the elements can be visited
+    * from a parallel loop.  The numbering is only valid until the
+    * connectivity of the mesh changes.
+    */
+   void indexVertices( HalfedgeMesh& mesh, vector<VertexIter>& vertices );
+   void indexEdges   ( HalfedgeMesh& mesh, vector<EdgeIter>&   edges    );
+   void indexFaces   ( HalfedgeMesh& mesh, vector<FaceIter>&   faces    );
+
+   /*
+    * Neighborhoods of an edge, given as the indices of the vertices they
+    * contain (vertices must have been numbered with indexVertices()).
+    */
+   void edgeQuad        ( EdgeIter e, vector<Index>& region ); ///< the endpoints, plus the vertex opposite the edge in each triangle
+   void edgeNeighborhood( EdgeIter e, vector<Index>& region ); ///< the endpoints, plus every vertex adjacent to either endpoint
+
+   /**
+    * A VertexReservation picks a conflict-free subset of candidate operations
+    * in parallel, using "deterministic reservations": every candidate first
+    * writes its key into each vertex of its region (keeping the minimum), and
+    * afterwards a candidate wins if and only if it still holds every vertex
+    * of its region.  The regions of the winners are pairwise disjoint, hence
+    * the winners can be applied in any order---or concurrently, as long as
+    * the operation does not allocate or delete mesh elements.  Candidates with
+    * smaller keys take precedence; see VertexReservation::key().
+    *
+    * Typical use:
+    *
+    *    reservation.reset( mesh.nVertices() );
+    *    // in parallel, for each candidate i:
+    *       reservation.reserve( region_i, VertexReservation::key( score_i, i ) );
+    *    // then in parallel, for each candidate i:
+    *       win[i] = reservation.holds( region_i, VertexReservation::key( score_i, i ) );
+    */
+   class VertexReservation
+   {
+      public:
+         VertexReservation( void ) : capacity( 0 ), size( 0 ) {}
+
+         /**
+          * Releases every vertex, making room for the given number of vertices.
+          */
+         void reset( Size nVertices );
+
+         /**
+          * Claims every vertex of the region for the given key, unless
+          * the vertex is already claimed by a smaller key.
+          */
+         void reserve( const vector<Index>& region, uint64_t key );
+
+         /**
+          * Returns true if and only if the given key holds every vertex of the region.
+          */
+         bool holds( const vector<Index>& region, uint64_t key ) const;
+
+         /**
+          * Builds a key from a (non-negative) score and a unique candidate id;
+          * candidates with a lower score win, and ties are broken by id.
+          */
+         static uint64_t key( float score, Index id );
+
+      protected:
+         unique_ptr< atomic<uint64_t>[] > slots;
+         Size capacity;
+         Size size;
+   };
+
+} // namespace CMU462
+
+#endif // CMU462_MESHOPS_H
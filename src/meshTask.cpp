@@ -0,0 +1,75 @@
+#include "meshTask.h"
+
+#include <chrono>
+
+namespace CMU462
+{
+   // Number of queued edges examined per step by the worklist-driven tasks;
+   // small enough that a step takes well under a millisecond.
+   static const Size edgesPerStep = 256;
+
+   bool MeshTask::run( double seconds )
+   {
+      typedef chrono::steady_clock Clock;
+      Clock::time_point deadline = Clock::now() + chrono::duration_cast<Clock::duration>( chrono::duration<double>( seconds ) );
+
+      while( !done )
+      {
+         done = step();
+         if( Clock::now() >= deadline ) break;
+      }
+
+      return done;
+   }
+
+   RemeshTask::RemeshTask( Remesher& _remesher, HalfedgeMesh& mesh, int nIterations )
+   : MeshTask( "Remeshing" ), remesher( _remesher )
+   {
+      remesher.begin( mesh, nIterations );
+   }
+
+   bool RemeshTask::step( void )
+   {
+      return remesher.step();
+   }
+
+   double RemeshTask::progress( void ) const
+   {
+      return remesher.progress();
+   }
+
+   FlipTask::FlipTask( EdgeFlipper& _flipper, HalfedgeMesh& mesh, EdgeFlipper::Criterion criterion )
+   : MeshTask( criterion == EdgeFlipper::DELAUNAY ? "Delaunay flips" : "Valence flips" ), flipper( _flipper )
+   {
+      flipper.begin( mesh, criterion );
+   }
+
+   bool FlipTask::step( void )
+   {
+      return flipper.step( edgesPerStep );
+   }
+
+   double FlipTask::progress( void ) const
+   {
+      // The queue can grow as well as shrink, so this is only an estimate.
+      Size total = flipper.nFlips() + flipper.nQueued();
+      return total == 0 ? 1. : double( flipper.nFlips() ) / double( total );
+   }
+
+   RefineTask::RefineTask( AdaptiveRefiner& _refiner, HalfedgeMesh& mesh, double targetLength, Size faceBudget )
+   : MeshTask( "Refining" ), refiner( _refiner )
+   {
+      refiner.begin( mesh, targetLength, faceBudget );
+   }
+
+   bool RefineTask::step( void )
+   {
+      return refiner.step( edgesPerStep );
+   }
+
+   double RefineTask::progress( void ) const
+   {
+      return refiner.progress();
+   }
+
+} // namespace CMU462
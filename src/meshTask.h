@@ -0,0 +1,115 @@
+/*
+ * Time-sliced execution of long mesh operations.
+ *
+ * A MeshTask is a resumable operation on a mesh: each call to step()
+ * does a bounded amount of work and leaves the mesh in a valid state,
+ * so the operation can be spread over many frames (via run(), which
+ * steps until a time budget is used up) and abandoned at any point by
+ * simply deleting the task.
+ */
+
+#ifndef CMU462_MESHTASK_H
+#define CMU462_MESHTASK_H
+
+#include <string>
+#include <functional>
+
+#include "halfEdgeMesh.h"
+#include "remesher.h"
+#include "edgeFlipper.h"
+#include "adaptiveRefiner.h"
+
+namespace CMU462
+{
+   class MeshTask
+   {
+      public:
+         MeshTask( const string& _name ) : name( _name ), done( false ) {}
+         virtual ~MeshTask( void ) {}
+
+         /**
+          * Calls step() until either the task is finished or the given
+          * number of seconds has elapsed (at least one step is always
+          * taken).  Returns true if and only if the task is finished.
+          */
+         bool run( double seconds );
+
+         /**
+          * Performs one bounded unit of work, returning true once the task is finished.
+          */
+         virtual bool step( void ) = 0;
+
+         /**
+          * Returns a rough estimate of the fraction of the work done, in [0,1].
+          */
+         virtual double progress( void ) const = 0;
+
+         const string& getName( void ) const { return name; }
+         bool isDone( void ) const { return done; }
+
+      protected:
+         string name;
+         bool done;
+   };
+
+   /**
+    * Runs Remesher::remesh() one round at a time.
+    */
+   class RemeshTask : public MeshTask
+   {
+      public:
+         RemeshTask( Remesher& remesher, HalfedgeMesh& mesh, int nIterations = 5 );
+         virtual bool step( void );
+         virtual double progress( void ) const;
+
+      protected:
+         Remesher& remesher;
+   };
+
+   /**
+    * Runs an EdgeFlipper pass a batch of edges at a time.
+    */
+   class FlipTask : public MeshTask
+   {
+      public:
+         FlipTask( EdgeFlipper& flipper, HalfedgeMesh& mesh, EdgeFlipper::Criterion criterion );
+         virtual bool step( void );
+         virtual double progress( void ) const;
+
+      protected:
+         EdgeFlipper& flipper;
+   };
+
+   /**
+    * Runs AdaptiveRefiner::refine() a batch of edges at a time.
+    */
+   class RefineTask : public MeshTask
+   {
+      public:
+         RefineTask( AdaptiveRefiner& refiner, HalfedgeMesh& mesh, double targetLength, Size faceBudget );
+         virtual bool step( void );
+         virtual double progress( void ) const;
+
+      protected:
+         AdaptiveRefiner& refiner;
+   };
+
+   /**
+    * Wraps an operation that cannot be split up (such as the
+    * MeshResampler operations) so that it can be run as a task;
+    * the whole operation is performed by the first step.
+    */
+   class FunctionTask : public MeshTask
+   {
+      public:
+         FunctionTask( const string& name, const function<void()>& _f ) : MeshTask( name ), f( _f ) {}
+         virtual bool step( void ) { f(); return true; }
+         virtual double progress( void ) const { return done ? 1. : 0.; }
+
+      protected:
+         function<void()> f;
+   };
+
+} // namespace CMU462
+
+#endif // CMU462_MESHTASK_H
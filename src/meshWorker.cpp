@@ -0,0 +1,53 @@
+#include "meshWorker.h"
+#include "CMU462/trace.h"
+
+namespace CMU462
+{
+   MeshWorker::~MeshWorker( void )
+   {
+      // Operations can't be interrupted, so wait for any that's still running.
+      if( worker.joinable() )
+      {
+         worker.join();
+      }
+   }
+
+   bool MeshWorker::start( const string& _name, const HalfedgeMesh& mesh, const function<void(HalfedgeMesh&)>& operation )
+   {
+      if( running ) return false;
+
+      name = _name;
+      running = true;
+      finished.store( false, memory_order_relaxed );
+
+      // The copy is made here, on the caller's thread, since other threads
+      // (e.g., picking and drawing) may write to the mesh's elements (such
+      // as Vertex::index) as soon as this returns.
+      result = mesh;
+      worker = thread( [this, operation]()
+      {
+         Trace::name_thread( "MeshWorker" );
+
+         operation( result );
+         finished.store( true, memory_order_release );
+         if( whenFinished ) whenFinished();
+      });
+
+      return true;
+   }
+
+   bool MeshWorker::collect( HalfedgeMesh& mesh )
+   {
+      if( !running || !finished.load( memory_order_acquire ) ) return false;
+
+      worker.join();
+      mesh.swap( result );
+      running = false;
+
+      // Release the old mesh (now held in result) right away.
+      HalfedgeMesh().swap( result );
+
+      return true;
+   }
+
+} // namespace CMU462
@@ -0,0 +1,78 @@
+/*
+ * Background execution of mesh operations.
+ *
+ * A MeshWorker runs an operation on its own thread, against a private
+ * copy of a mesh, so that the original can keep being drawn while the
+ * operation runs.  Once the operation finishes, the result is swapped
+ * into the original mesh in constant time (see HalfedgeMesh::swap()).
+ *
+ * Typical use, from the render thread:
+ *
+ *    worker.start( "Upsampling", mesh, []( HalfedgeMesh& m ) { ... } );
+ *
+ *    // every frame:
+ *    if( worker.collect( mesh ) )
+ *    {
+ *       // mesh now holds the result; any pointers into the
+ *       // old mesh (selections, etc.) are no longer valid
+ *    }
+ *
+ * The original mesh is copied by start() (on the caller's thread, so no
+ * other thread may be writing to it at the time), and is replaced once
+ * the operation finishes, so its connectivity must not be modified while
+ * the worker is busy.
+ */
+
+#ifndef CMU462_MESHWORKER_H
+#define CMU462_MESHWORKER_H
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+#include "halfEdgeMesh.h"
+
+namespace CMU462
+{
+   class MeshWorker
+   {
+      public:
+         MeshWorker( void ) : running( false ), finished( false ) {}
+         ~MeshWorker( void );
+
+         /**
+          * Starts running the given operation on a copy of the given mesh.
+          * Returns false (and does nothing) if the worker is already busy.
+          */
+         bool start( const string& name, const HalfedgeMesh& mesh, const function<void(HalfedgeMesh&)>& operation );
+
+         /**
+          * If the operation has finished, swaps its result into the given
+          * mesh (which should be the mesh passed to start()) and returns
+          * true; otherwise, returns false without waiting.
+          */
+         bool collect( HalfedgeMesh& mesh );
+
+         /**
+          * Sets a function to call (from the worker thread) whenever an
+          * operation finishes, e.g., to wake up the render loop.  Must not
+          * be called while the worker is busy.
+          */
+         void onFinished( const function<void(void)>& f ) { whenFinished = f; }
+
+         bool busy( void ) const { return running; } ///< has an operation been started but not yet collected?
+         const string& getName( void ) const { return name; }
+
+      protected:
+         thread worker;
+         HalfedgeMesh result;
+         string name;
+         bool running;
+         atomic<bool> finished;
+         function<void(void)> whenFinished;
+   };
+
+} // namespace CMU462
+
+#endif // CMU462_MESHWORKER_H
@@ -0,0 +1,274 @@
+#include "meshlets.h"
+#include "meshOps.h"
+#include "CMU462/trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace CMU462
+{
+   // Largest number of triangles in a cluster (unless it consists of a
+   // single face, split into even more triangles).
+   static const Size maxTriangles = 128;
+
+   // Cluster of a face not yet assigned to one.
+   static const Index noCluster = numeric_limits<Index>::max();
+
+   // Number of triangles a face is split into.
+   static Size nTriangles( FaceIter f )
+   {
+      Size degree = f->degree();
+      return degree >= 3 ? degree - 2 : 0;
+   }
+
+   void Meshlets::build( HalfedgeMesh& mesh, const MeshBuffers& buffers )
+   {
+      TRACE_SCOPE( "Meshlets::build" );
+
+      closed = ( mesh.nBoundaries() == 0 );
+
+      indexFaces( mesh, faces );
+      clusterOf.assign( faces.size(), noCluster );
+
+      clusters.clear();
+      faces.clear();
+      faceIndices.clear();
+      edgeIndices.clear();
+
+      for( FaceIter f = mesh.facesBegin(); f != mesh.facesEnd(); f++ )
+      {
+         if( clusterOf[ f->index ] != noCluster ) continue;
+
+         Index k = clusters.size();
+         clusters.push_back( Cluster() );
+         Cluster& c( clusters.back() );
+         c.firstFace = faces.size();
+         c.firstFaceIndex = faceIndices.size();
+         c.firstEdgeIndex = edgeIndices.size();
+
+         // Grow the cluster breadth-first from f, adding neighbors as long
+         // as they fit (faces are claimed as soon as they are queued).
+         faces.push_back( f );
+         clusterOf[ f->index ] = k;
+         Size size = nTriangles( f );
+         for( Index i = c.firstFace; i < faces.size(); i++ )
+         {
+            HalfedgeIter h = faces[i]->halfedge();
+            do
+            {
+               FaceIter g = h->twin()->face();
+               if( !g->isBoundary() && clusterOf[ g->index ] == noCluster && size + nTriangles( g ) <= maxTriangles )
+               {
+                  faces.push_back( g );
+                  clusterOf[ g->index ] = k;
+                  size += nTriangles( g );
+               }
+               h = h->next();
+            }
+            while( h != faces[i]->halfedge() );
+         }
+         c.nFaces = faces.size() - c.firstFace;
+
+         // List the corners of the faces, and the edges whose first
+         // halfedge lies in the cluster (or whose second one does, if the
+         // first lies on the boundary).
+         for( Index i = c.firstFace; i < faces.size(); i++ )
+         {
+            FaceIter g = faces[i];
+
+            Index first;
+            Size count;
+            buffers.faceCorners( g, first, count );
+            for( Index j = 0; j < count; j++ ) faceIndices.push_back( first + j );
+
+            HalfedgeIter h = g->halfedge();
+            do
+            {
+               HalfedgeIter h0 = h->edge()->halfedge();
+               if( h0 == h || ( h0->face()->isBoundary() && h0->twin() == h ) )
+               {
+                  GLuint a, b;
+                  buffers.edgeVertices( h->edge(), a, b );
+                  edgeIndices.push_back( a );
+                  edgeIndices.push_back( b );
+               }
+               h = h->next();
+            }
+            while( h != g->halfedge() );
+         }
+         c.nFaceIndices = faceIndices.size() - c.firstFaceIndex;
+         c.nEdgeIndices = edgeIndices.size() - c.firstEdgeIndex;
+
+         fit( c );
+      }
+
+      if( faceIndexBuffer == 0 )
+      {
+         glGenBuffers( 1, &faceIndexBuffer );
+         glGenBuffers( 1, &edgeIndexBuffer );
+      }
+      glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, faceIndexBuffer );
+      glBufferData( GL_ELEMENT_ARRAY_BUFFER, faceIndices.size() * sizeof( GLuint ), faceIndices.empty() ? NULL : &faceIndices[0], GL_STATIC_DRAW );
+      glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, edgeIndexBuffer );
+      glBufferData( GL_ELEMENT_ARRAY_BUFFER, edgeIndices.size() * sizeof( GLuint ), edgeIndices.empty() ? NULL : &edgeIndices[0], GL_STATIC_DRAW );
+      glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+
+      nVisible = clusters.size();
+      valid = true;
+   }
+
+   void Meshlets::fit( Cluster& c )
+   {
+      // Sphere around the bounding box of the vertices.
+      Vector3D low(  numeric_limits<double>::max() );
+      Vector3D high( -numeric_limits<double>::max() );
+      Vector3D sum( 0., 0., 0. );
+      normals.resize( c.nFaces );
+      for( Index i = c.firstFace; i < c.firstFace + c.nFaces; i++ )
+      {
+         HalfedgeIter h = faces[i]->halfedge();
+         do
+         {
+            const Vector3D& p( h->vertex()->position );
+            low.x  = min( low.x,  p.x ); low.y  = min( low.y,  p.y ); low.z  = min( low.z,  p.z );
+            high.x = max( high.x, p.x ); high.y = max( high.y, p.y ); high.z = max( high.z, p.z );
+            h = h->next();
+         }
+         while( h != faces[i]->halfedge() );
+
+         // (Degenerate faces have no normal.)
+         normals[i-c.firstFace] = faces[i]->normal();
+         if( normals[i-c.firstFace].norm2() > .5 ) sum += normals[i-c.firstFace];
+      }
+
+      c.center = .5 * ( low + high );
+      double r2 = 0.;
+      for( Index i = c.firstFace; i < c.firstFace + c.nFaces; i++ )
+      {
+         HalfedgeIter h = faces[i]->halfedge();
+         do
+         {
+            r2 = max( r2, ( h->vertex()->position - c.center ).norm2() );
+            h = h->next();
+         }
+         while( h != faces[i]->halfedge() );
+      }
+      c.radius = sqrt( r2 );
+
+      // Cone around the average normal, through the normal farthest from it.
+      c.axis = Vector3D( 0., 0., 0. );
+      c.sinAngle = 1.;
+      if( sum.norm() < 1e-9 ) return;
+
+      Vector3D axis = sum.unit();
+      double minDot = 1.;
+      for( Index i = c.firstFace; i < c.firstFace + c.nFaces; i++ )
+      {
+         const Vector3D& N( normals[i-c.firstFace] );
+         if( N.norm2() > .5 ) minDot = min( minDot, dot( N, axis ) );
+      }
+      if( minDot <= 0. ) return;
+
+      c.axis = axis;
+      c.sinAngle = sqrt( 1. - minDot*minDot );
+   }
+
+   void Meshlets::vertexMoved( VertexIter v )
+   {
+      if( !valid ) return;
+
+      HalfedgeIter h = v->halfedge();
+      do
+      {
+         FaceIter f = h->face();
+         if( !f->isBoundary() ) fit( clusters[ clusterOf[ f->index ] ] );
+         h = h->twin()->next();
+      }
+      while( h != v->halfedge() );
+   }
+
+   void Meshlets::cull( const Matrix4x4& transform )
+   {
+      // Planes of the frustum, from the rows of the transform (Gribb and
+      // Hartmann); a point p lies inside if dot( plane, (p,1) ) >= 0.
+      Vector4D row[4];
+      for( int i = 0; i < 4; i++ )
+      {
+         row[i] = Vector4D( transform(i,0), transform(i,1), transform(i,2), transform(i,3) );
+      }
+      Vector4D planes[6] = { row[3] + row[0], row[3] - row[0],
+                             row[3] + row[1], row[3] - row[1],
+                             row[3] + row[2], row[3] - row[2] };
+      double planeNorm[6];
+      for( int j = 0; j < 6; j++ )
+      {
+         planeNorm[j] = Vector3D( planes[j].x, planes[j].y, planes[j].z ).norm();
+      }
+
+      // The eye maps to a multiple of (0,0,1,0) in clip space (under an
+      // orthographic transform, it lies at infinity, and cones are not used).
+      Vector4D e = transform.inv() * Vector4D( 0., 0., 1., 0. );
+      bool perspective = closed && fabs( e.w ) > 1e-12;
+      Vector3D eye = perspective ? Vector3D( e.x/e.w, e.y/e.w, e.z/e.w ) : Vector3D();
+
+      faceCounts.clear(); faceOffsets.clear();
+      edgeCounts.clear(); edgeOffsets.clear();
+      nVisible = 0;
+      bool extendFaces = false, extendEdges = false;
+      for( Index k = 0; k < clusters.size(); k++ )
+      {
+         const Cluster& c( clusters[k] );
+
+         bool inside = true;
+         for( int j = 0; j < 6 && inside; j++ )
+         {
+            const Vector4D& p( planes[j] );
+            inside = ( p.x*c.center.x + p.y*c.center.y + p.z*c.center.z + p.w >= -c.radius * planeNorm[j] );
+         }
+
+         bool facing = true;
+         if( inside && perspective && c.axis.norm2() > 0. )
+         {
+            Vector3D d = c.center - eye;
+            facing = ( dot( d, c.axis ) < c.sinAngle * d.norm() + c.radius );
+         }
+
+         // Clusters are contiguous in the index buffers, so runs of
+         // visible clusters are drawn as single ranges.
+         if( inside && facing )
+         {
+            nVisible++;
+            if( extendFaces ) faceCounts.back() += c.nFaceIndices;
+            else
+            {
+               faceCounts.push_back( c.nFaceIndices );
+               faceOffsets.push_back( (const GLvoid*) ( c.firstFaceIndex * sizeof( GLuint ) ) );
+            }
+         }
+         extendFaces = inside && facing;
+
+         if( inside )
+         {
+            if( extendEdges ) edgeCounts.back() += c.nEdgeIndices;
+            else
+            {
+               edgeCounts.push_back( c.nEdgeIndices );
+               edgeOffsets.push_back( (const GLvoid*) ( c.firstEdgeIndex * sizeof( GLuint ) ) );
+            }
+         }
+         extendEdges = inside;
+      }
+   }
+
+   void Meshlets::drawFaces( MeshBuffers& buffers )
+   {
+      buffers.drawFaces( faceIndexBuffer, faceCounts, faceOffsets );
+   }
+
+   void Meshlets::drawEdges( MeshBuffers& buffers )
+   {
+      buffers.drawEdges( edgeIndexBuffer, edgeCounts, edgeOffsets );
+   }
+
+} // namespace CMU462
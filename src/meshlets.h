@@ -0,0 +1,119 @@
+/*
+ * Clusters of nearby faces ("meshlets"), culled before drawing.
+ *
+ * Meshlets partitions the faces of a mesh into connected clusters of up
+ * to about a hundred triangles, grown breadth-first across edges, and
+ * keeps for each cluster:
+ *
+ *  - a bounding sphere, tested against the six planes of the view
+ *    frustum, so that clusters entirely off the screen are skipped;
+ *
+ *  - a cone containing the normals of its faces, so that clusters facing
+ *    entirely away from the eye are skipped as well.  Since back faces
+ *    are drawn, this test is only used on closed meshes (where back faces
+ *    are always hidden by front faces).
+ *
+ * The triangles and edges of every cluster are listed contiguously in
+ * two index buffers, referring to the data packed by MeshBuffers, so
+ * that the visible clusters are drawn with one call per pass.  Each edge
+ * belongs to the cluster of one of its faces, and is culled against the
+ * frustum only (an edge on the boundary of a back-facing cluster may
+ * still lie on the silhouette).
+ *
+ * The clusters refer to the slots of a MeshBuffers, so they must be
+ * rebuilt whenever the buffers are repacked or edited (i.e., after any
+ * change to the connectivity of the mesh).  After moving a vertex, call
+ * vertexMoved() to refit the clusters around it instead.
+ */
+
+#ifndef CMU462_MESHLETS_H
+#define CMU462_MESHLETS_H
+
+#include <vector>
+
+#include "GL/glew.h"
+
+#include "halfEdgeMesh.h"
+#include "meshBuffers.h"
+
+namespace CMU462
+{
+   class Meshlets
+   {
+      public:
+         Meshlets( void ) : valid( false ), nVisible( 0 ), faceIndexBuffer( 0 ), edgeIndexBuffer( 0 ), closed( false ) {}
+
+         // Buffer objects belong to the OpenGL context, not to the mesh,
+         // so copies start out empty (and will be built on first use).
+         Meshlets( const Meshlets& other ) : valid( false ), nVisible( 0 ), faceIndexBuffer( 0 ), edgeIndexBuffer( 0 ), closed( false ) {}
+         Meshlets& operator=( const Meshlets& other ) { valid = false; return *this; }
+
+         /**
+          * Clusters the faces of the given mesh, which must have just been
+          * packed into the given buffers, and uploads the index buffers
+          * (so the OpenGL context must be current), then sets valid.
+          * Numbers the faces of the mesh as a side effect (see indexFaces()).
+          */
+         void build( HalfedgeMesh& mesh, const MeshBuffers& buffers );
+
+         /**
+          * Refits the bounds of the clusters containing the faces around
+          * the given vertex, after it has moved.  Relies on the numbering
+          * of the faces by build(), which does not change until the
+          * connectivity of the mesh does.
+          */
+         void vertexMoved( VertexIter v );
+
+         /**
+          * Selects the clusters visible with the given (projection *
+          * modelview) transform, for the next calls to drawFaces() and
+          * drawEdges().
+          */
+         void cull( const Matrix4x4& transform );
+
+         // Draw the visible clusters, from the given buffers.
+         void drawFaces( MeshBuffers& buffers );
+         void drawEdges( MeshBuffers& buffers );
+
+         Size size( void ) const { return clusters.size(); }
+
+         bool valid; ///< whether the clusters match the mesh
+         Size nVisible; ///< number of clusters kept by the last call to cull()
+
+      protected:
+         struct Cluster
+         {
+            Index firstFace,      nFaces;       ///< range of faces
+            Index firstFaceIndex, nFaceIndices; ///< range of the face index buffer
+            Index firstEdgeIndex, nEdgeIndices; ///< range of the edge index buffer
+
+            Vector3D center; ///< bounding sphere
+            double radius;
+
+            Vector3D axis;   ///< normal cone, or zero if it spans a hemisphere or more
+            double sinAngle; ///< sine of the angle between the axis and the cone
+         };
+
+         // Computes the bounding sphere and normal cone of a cluster.
+         void fit( Cluster& c );
+
+         vector<Cluster> clusters;
+         vector<FaceIter> faces; ///< faces, grouped by cluster
+         vector<Index> clusterOf; ///< cluster of each face, by number
+         vector<Vector3D> normals; ///< scratch space for fit()
+
+         vector<GLuint> faceIndices; ///< triangle corners, grouped by cluster
+         vector<GLuint> edgeIndices; ///< vertex slots (two per edge), grouped by cluster
+         GLuint faceIndexBuffer;
+         GLuint edgeIndexBuffer;
+
+         bool closed; ///< whether the mesh has no boundary (enabling cone culling)
+
+         // Draw lists produced by cull().
+         vector<GLsizei> faceCounts, edgeCounts;
+         vector<const GLvoid*> faceOffsets, edgeOffsets;
+   };
+
+} // namespace CMU462
+
+#endif // CMU462_MESHLETS_H
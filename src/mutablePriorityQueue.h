@@ -58,8 +58,10 @@
  *
  */
 
-#ifndef CMU462_CAMERA_H
-#define CMU462_CAMERA_H
+#ifndef CMU462_MUTABLEPRIORITYQUEUE_H
+#define CMU462_MUTABLEPRIORITYQUEUE_H
+
+#include <set>
 
 namespace CMU462
 {
@@ -91,10 +93,25 @@ namespace CMU462
             queue.erase( queue.begin() );
          }
 
+         bool empty( void ) const
+         {
+            return queue.empty();
+         }
+
+         size_t size( void ) const
+         {
+            return queue.size();
+         }
+
+         void clear( void )
+         {
+            queue.clear();
+         }
+
       protected:
-         set<T> queue;
+         std::set<T> queue;
    };
 
 } // namespace CMU462
 
-#endif // CMU462_CAMERA_H
+#endif // CMU462_MUTABLEPRIORITYQUEUE_H
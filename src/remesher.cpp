@@ -0,0 +1,421 @@
+#include "remesher.h"
+
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+namespace CMU462
+{
+   void Remesher::remesh( HalfedgeMesh& mesh, int nIterations )
+   {
+      begin( mesh, nIterations );
+      while( !step() );
+   }
+
+   void Remesher::begin( HalfedgeMesh& _mesh, int _nIterations )
+   {
+      mesh = &_mesh;
+      nIterations = _nIterations;
+      iteration = 0;
+      phase = SPLIT;
+      round = 0;
+
+      // A phase normally settles within a few rounds per doubling of the
+      // mesh size; cap the rounds in case it never does (e.g., if flips
+      // keep undoing one another).
+      maxRounds = 4 * ( 1 + (int) log2( 1. + mesh->nEdges() ) );
+
+      // As in MeshResampler::resample(), the target edge length is the
+      // mean edge length of the input; edges are considered "too long"
+      // above 4/3 of the target, and "too short" below 4/5 of it.
+      double L = meanEdgeLength( *mesh );
+      maxLength = 4./3. * L;
+      minLength = 4./5. * L;
+
+      if( projectToSurface ) surface.build( *mesh );
+   }
+
+   bool Remesher::step( void )
+   {
+      if( iteration >= nIterations ) return true;
+
+      // Each phase repeats its rounds until a round changes nothing, or
+      // until it runs out of rounds.
+      switch( phase )
+      {
+         case SPLIT:
+            if( splitRound( *mesh, maxLength ) == 0 || ++round >= maxRounds )
+            {
+               phase = COLLAPSE;
+               round = 0;
+            }
+            break;
+         case COLLAPSE:
+            if( collapseRound( *mesh, minLength, maxLength ) == 0 || ++round >= maxRounds )
+            {
+               phase = FLIP;
+               round = 0;
+            }
+            break;
+         case FLIP:
+            if( flipRound( *mesh ) == 0 || ++round >= maxRounds )
+            {
+               phase = SMOOTH;
+               round = 0;
+            }
+            break;
+         case SMOOTH:
+            smooth( *mesh );
+            phase = PROJECT;
+            break;
+         case PROJECT:
+            if( projectToSurface ) project( *mesh, surface );
+            phase = SPLIT;
+            iteration++;
+            break;
+      }
+
+      return iteration >= nIterations;
+   }
+
+   double Remesher::progress( void ) const
+   {
+      if( nIterations <= 0 ) return 1.;
+      return min( 1., ( iteration + phase / 5. ) / nIterations );
+   }
+
+   double Remesher::meanEdgeLength( HalfedgeMesh& mesh )
+   {
+      vector<EdgeIter> edges;
+      indexEdges( mesh, edges );
+
+      const long n = edges.size();
+      if( n == 0 ) return 0.;
+
+      double sum = 0.;
+      #pragma omp parallel for schedule(static) reduction(+:sum)
+      for( long i = 0; i < n; i++ )
+      {
+         sum += edges[i]->length();
+      }
+
+      return sum / n;
+   }
+
+   Size Remesher::splitRound( HalfedgeMesh& mesh, double maxLength )
+   {
+      indexVertices( mesh, vertices );
+      indexEdges( mesh, edges );
+      reservation.reset( vertices.size() );
+
+      const long n = edges.size();
+      candidate.assign( n, 0 );
+      score.resize( n );
+
+      #pragma omp parallel
+      {
+         vector<Index> region;
+
+         // Every edge that is too long claims the quad around it,
+         // with longer edges taking precedence over shorter ones.
+         #pragma omp for schedule(static)
+         for( long i = 0; i < n; i++ )
+         {
+            double length = edges[i]->length();
+            if( length > maxLength && canSplit( edges[i] ) )
+            {
+               candidate[i] = 1;
+               score[i] = 1. / length;
+               edgeQuad( edges[i], region );
+               reservation.reserve( region, VertexReservation::key( score[i], i ) );
+            }
+         }
+
+         // Only edges that hold their entire quad get split.
+         #pragma omp for schedule(static)
+         for( long i = 0; i < n; i++ )
+         {
+            if( candidate[i] )
+            {
+               edgeQuad( edges[i], region );
+               candidate[i] = reservation.holds( region, VertexReservation::key( score[i], i ) );
+            }
+         }
+      }
+
+      // Splitting allocates new elements, so the winners are applied in sequence.
+      // (Only splits that actually add a vertex are counted.)
+      Size nSplits = 0;
+      for( long i = 0; i < n; i++ )
+      {
+         if( candidate[i] )
+         {
+            Size nV = mesh.nVertices();
+            mesh.splitEdge( edges[i] );
+            if( mesh.nVertices() != nV ) nSplits++;
+         }
+      }
+
+      return nSplits;
+   }
+
+   // Returns true if and only if collapsing the given edge to its midpoint
+   // would create an edge longer than the given length.
+   static bool collapseCreatesLongEdge( EdgeIter e, double maxLength )
+   {
+      HalfedgeIter h0 = e->halfedge();
+      HalfedgeIter h1 = h0->twin();
+      Vector3D m = ( h0->vertex()->position + h1->vertex()->position ) / 2.;
+
+      HalfedgeIter start[2] = { h0, h1 };
+      for( int i = 0; i < 2; i++ )
+      {
+         HalfedgeIter h = start[i];
+         do
+         {
+            if( ( h->twin()->vertex()->position - m ).norm() > maxLength )
+            {
+               return true;
+            }
+            h = h->twin()->next();
+         }
+         while( h != start[i] );
+      }
+
+      return false;
+   }
+
+   Size Remesher::collapseRound( HalfedgeMesh& mesh, double minLength, double maxLength )
+   {
+      indexVertices( mesh, vertices );
+      indexEdges( mesh, edges );
+      reservation.reset( vertices.size() );
+
+      const long n = edges.size();
+      candidate.assign( n, 0 );
+      score.resize( n );
+
+      #pragma omp parallel
+      {
+         vector<Index> region;
+
+         // A collapse moves both endpoints and changes every edge around
+         // them, so each short edge claims both of its one-rings; shorter
+         // edges take precedence.
+         #pragma omp for schedule(static)
+         for( long i = 0; i < n; i++ )
+         {
+            double length = edges[i]->length();
+            if( length < minLength &&
+                canCollapse( edges[i] ) &&
+                !collapseCreatesLongEdge( edges[i], maxLength ) )
+            {
+               candidate[i] = 1;
+               score[i] = length;
+               edgeNeighborhood( edges[i], region );
+               reservation.reserve( region, VertexReservation::key( score[i], i ) );
+            }
+         }
+
+         #pragma omp for schedule(static)
+         for( long i = 0; i < n; i++ )
+         {
+            if( candidate[i] )
+            {
+               edgeNeighborhood( edges[i], region );
+               candidate[i] = reservation.holds( region, VertexReservation::key( score[i], i ) );
+            }
+         }
+      }
+
+      // Collapsing deletes elements, so the winners are applied in sequence.
+      // Since their neighborhoods are disjoint, a collapse never deletes
+      // (or changes the legality of) any other winning edge.  Only collapses
+      // that actually remove a vertex are counted.
+      Size nCollapses = 0;
+      for( long i = 0; i < n; i++ )
+      {
+         if( candidate[i] )
+         {
+            Size nV = mesh.nVertices();
+            mesh.collapseEdge( edges[i] );
+            if( mesh.nVertices() != nV ) nCollapses++;
+         }
+      }
+
+      return nCollapses;
+   }
+
+   // Returns the reduction in total valence deviation obtained by flipping
+   // the given edge, using the valences computed at the start of the round.
+   static int flipGain( EdgeIter e, const vector<int>& valences, const vector<char>& boundary )
+   {
+      HalfedgeIter h0 = e->halfedge();
+      HalfedgeIter h1 = h0->twin();
+      if( h0->isBoundary() || h1->isBoundary() ) return 0;
+
+      Index v[4] = { h0->vertex()->index,
+                     h1->vertex()->index,
+                     h0->next()->next()->vertex()->index,
+                     h1->next()->next()->vertex()->index };
+
+      // The endpoints each lose an edge, and the opposite vertices each gain one.
+      const int change[4] = { -1, -1, 1, 1 };
+
+      int before = 0, after = 0;
+      for( int i = 0; i < 4; i++ )
+      {
+         int target = boundary[v[i]] ? 4 : 6;
+         before += abs( valences[v[i]] - target );
+         after  += abs( valences[v[i]] + change[i] - target );
+      }
+
+      return before - after;
+   }
+
+   Size Remesher::flipRound( HalfedgeMesh& mesh )
+   {
+      indexVertices( mesh, vertices );
+      indexEdges( mesh, edges );
+      reservation.reset( vertices.size() );
+
+      // Compute each valence once, rather than four times per edge.
+      const long nV = vertices.size();
+      valences.resize( nV );
+      boundary.resize( nV );
+      #pragma omp parallel for schedule(static)
+      for( long i = 0; i < nV; i++ )
+      {
+         valences[i] = valence( vertices[i] );
+         boundary[i] = vertices[i]->isBoundary();
+      }
+
+      const long n = edges.size();
+      candidate.assign( n, 0 );
+      score.resize( n );
+
+      #pragma omp parallel
+      {
+         vector<Index> region;
+
+         // Edges whose flip improves valence claim their quad, with
+         // bigger improvements taking precedence.  The (more expensive)
+         // legality test is only run for edges that would improve.
+         #pragma omp for schedule(static)
+         for( long i = 0; i < n; i++ )
+         {
+            int gain = flipGain( edges[i], valences, boundary );
+            if( gain > 0 && canFlip( edges[i] ) )
+            {
+               candidate[i] = 1;
+               score[i] = 1. / gain;
+               edgeQuad( edges[i], region );
+               reservation.reserve( region, VertexReservation::key( score[i], i ) );
+            }
+         }
+
+         #pragma omp for schedule(static)
+         for( long i = 0; i < n; i++ )
+         {
+            if( candidate[i] )
+            {
+               edgeQuad( edges[i], region );
+               candidate[i] = reservation.holds( region, VertexReservation::key( score[i], i ) );
+            }
+         }
+      }
+
+      // A flip only rewires the two triangles on either side of the edge
+      // (and allocates nothing), and the winning quads are disjoint, so
+      // the winners can be flipped concurrently.  Only flips that actually
+      // change the endpoints of the edge are counted.
+      long nFlips = 0;
+      #pragma omp parallel for schedule(static) reduction(+:nFlips)
+      for( long i = 0; i < n; i++ )
+      {
+         if( candidate[i] )
+         {
+            VertexIter a = edges[i]->halfedge()->vertex();
+            VertexIter b = edges[i]->halfedge()->twin()->vertex();
+            mesh.flipEdge( edges[i] );
+            VertexIter c = edges[i]->halfedge()->vertex();
+            VertexIter d = edges[i]->halfedge()->twin()->vertex();
+            if( !( ( a == c && b == d ) || ( a == d && b == c ) ) ) nFlips++;
+         }
+      }
+
+      return nFlips;
+   }
+
+   void Remesher::smooth( HalfedgeMesh& mesh )
+   {
+      indexVertices( mesh, vertices );
+      const long n = vertices.size();
+
+      // Jacobi step: every new position is computed from the old
+      // positions only, so all vertices can be updated in parallel.
+      #pragma omp parallel for schedule(static)
+      for( long i = 0; i < n; i++ )
+      {
+         VertexIter v = vertices[i];
+         Vector3D p = v->position;
+         v->newPosition = p;
+
+         // Boundary vertices stay put.
+         if( v->isBoundary() ) continue;
+
+         // Accumulate the centroid of the neighbors, as well as the
+         // area-weighted normal of the surrounding triangles.
+         Vector3D c( 0., 0., 0. );
+         Vector3D N( 0., 0., 0. );
+         Size k = 0;
+         HalfedgeIter h = v->halfedge();
+         do
+         {
+            Vector3D pj = h->next()->vertex()->position;
+            Vector3D pk = h->next()->next()->vertex()->position;
+            c += pj;
+            N += cross( pj - p, pk - p );
+            k++;
+
+            h = h->twin()->next();
+         }
+         while( h != v->halfedge() );
+         c /= (double) k;
+
+         // Move toward the centroid, but only within the tangent plane.
+         Vector3D u = c - p;
+         if( N.norm() > 0. )
+         {
+            N.normalize();
+            u -= dot( u, N ) * N;
+         }
+         v->newPosition = p + smoothingWeight * u;
+      }
+
+      #pragma omp parallel for schedule(static)
+      for( long i = 0; i < n; i++ )
+      {
+         vertices[i]->position = vertices[i]->newPosition;
+      }
+   }
+
+   void Remesher::project( HalfedgeMesh& mesh, const AABBTree& surface )
+   {
+      if( surface.empty() ) return;
+
+      indexVertices( mesh, vertices );
+      const long n = vertices.size();
+
+      // Queries only read the tree, and each vertex is written by
+      // exactly one iteration, so the loop runs fully in parallel.
+      // (Queries near detailed regions take longer, hence the dynamic
+      // schedule.)
+      #pragma omp parallel for schedule(dynamic,256)
+      for( long i = 0; i < n; i++ )
+      {
+         vertices[i]->position = surface.closestPoint( vertices[i]->position );
+      }
+   }
+
+} // namespace CMU462
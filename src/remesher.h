@@ -0,0 +1,115 @@
+/*
+ * Parallel isotropic remeshing.
+ *
+ * The Remesher runs the same four steps as MeshResampler::resample()
+ * (split long edges, collapse short edges, flip toward regular valence,
+ * tangential smoothing), but each step is organized so that the work per
+ * iteration scales with the number of cores:
+ *
+ *  - splits and collapses are applied in rounds; in each round, candidate
+ *    edges are evaluated in parallel, and a conflict-free subset is chosen
+ *    in parallel with a VertexReservation.  (The winners of a round are
+ *    then applied one after the other, since splitting and collapsing
+ *    allocate or delete elements of the mesh's element lists.)
+ *
+ *  - flips are chosen by evaluating the change in valence of every edge in
+ *    parallel (from valences computed once per round), and the winning
+ *    flips---which touch disjoint quads---are applied in parallel.  (This
+ *    assumes HalfedgeMesh::flipEdge() only modifies the elements of the two
+ *    triangles containing the edge.)
+ *
+ *  - smoothing is a Jacobi step: new positions are computed in parallel
+ *    from the old ones into Vertex::newPosition, and then copied back.
+ *
+ *  - after smoothing, every vertex is projected (in parallel) back onto
+ *    the input surface, using an AABBTree built over a frozen copy of the
+ *    input; otherwise, repeated smoothing slowly shrinks the surface.
+ */
+
+#ifndef CMU462_REMESHER_H
+#define CMU462_REMESHER_H
+
+#include "halfEdgeMesh.h"
+#include "meshOps.h"
+#include "aabbTree.h"
+
+namespace CMU462
+{
+   class Remesher
+   {
+      public:
+         Remesher( void ) : smoothingWeight( .2 ), projectToSurface( true ), mesh( NULL ), iteration( 0 ), nIterations( 0 ), phase( SPLIT ), round( 0 ), maxRounds( 0 ), minLength( 0. ), maxLength( 0. ) {}
+
+         /**
+          * Runs the given number of split / collapse / flip / smooth iterations,
+          * targeting the mean edge length of the mesh that was passed in.
+          * If projectToSurface is set, vertices are kept on the surface of
+          * the mesh as it was passed in.
+          */
+         void remesh( HalfedgeMesh& mesh, int nIterations = 5 );
+
+         /*
+          * Incremental interface, for remeshing a little at a time: begin()
+          * sets up a call to remesh(), and each call to step() performs one
+          * round (or one smoothing or projection step), returning true once
+          * all iterations are done.  The mesh must not be modified by anyone
+          * else in between.
+          */
+         void begin( HalfedgeMesh& mesh, int nIterations = 5 );
+         bool step( void );
+         double progress( void ) const; ///< rough fraction of the work done, in [0,1]
+
+         /*
+          * The individual steps.  Each "round" applies one conflict-free set
+          * of operations and returns the number of operations that changed
+          * the mesh; a step is complete once a round returns zero (or, in
+          * step(), once the step has used up its rounds).
+          */
+         Size splitRound   ( HalfedgeMesh& mesh, double maxLength );                   ///< splits edges longer than maxLength
+         Size collapseRound( HalfedgeMesh& mesh, double minLength, double maxLength ); ///< collapses edges shorter than minLength, unless this creates edges longer than maxLength
+         Size flipRound    ( HalfedgeMesh& mesh );                                     ///< flips edges whose flip brings vertex valences closer to 6 (4 on the boundary)
+         void smooth       ( HalfedgeMesh& mesh );                                     ///< moves interior vertices toward the centroid of their neighbors, within the tangent plane
+         void project      ( HalfedgeMesh& mesh, const AABBTree& surface );            ///< moves every vertex to the closest point on the given surface
+
+         /**
+          * Returns the mean length of the edges of the given mesh.
+          */
+         static double meanEdgeLength( HalfedgeMesh& mesh );
+
+         double smoothingWeight; ///< fraction of the way each vertex moves toward its (tangential) centroid per smoothing step
+         bool projectToSurface;  ///< whether remesh() projects vertices back onto the input surface after each smoothing step
+
+      protected:
+         enum Phase
+         {
+            SPLIT,
+            COLLAPSE,
+            FLIP,
+            SMOOTH,
+            PROJECT
+         };
+
+         // State of the remeshing pass started by begin().
+         HalfedgeMesh* mesh;
+         int iteration;
+         int nIterations;
+         Phase phase;
+         int round;     ///< rounds run so far in the current phase
+         int maxRounds; ///< rounds allowed per phase
+         double minLength;
+         double maxLength;
+         AABBTree surface; ///< frozen copy of the input surface
+
+         // Per-round scratch space, kept around to avoid reallocation.
+         VertexReservation reservation;
+         vector<VertexIter> vertices;
+         vector<EdgeIter> edges;
+         vector<char> candidate;
+         vector<float> score;
+         vector<int> valences;
+         vector<char> boundary;
+   };
+
+} // namespace CMU462
+
+#endif // CMU462_REMESHER_H
@@ -9,7 +9,10 @@
 #include <vector>
 #include <iostream>
 
-#include "CMU462/CMU462.h"
+#include "CMU462/vector2D.h"
+#include "CMU462/vector3D.h"
+#include "CMU462/matrix4x4.h"
+#include "CMU462/color.h"
 
 namespace CMU462 {
 
@@ -0,0 +1,284 @@
+#include "screenProjection.h"
+#include "meshOps.h"
+
+#include <algorithm>
+
+namespace CMU462
+{
+   void ScreenProjection::gather( HalfedgeMesh& mesh )
+   {
+      indexVertices( mesh, vertices );
+
+      Size nV = vertices.size();
+      px.resize( nV );
+      py.resize( nV );
+      pz.resize( nV );
+      for( Index i = 0; i < nV; i++ )
+      {
+         const Vector3D& p( vertices[i]->position );
+         px[i] = p.x;
+         py[i] = p.y;
+         pz[i] = p.z;
+      }
+
+      faces.clear();
+      triangles.clear();
+      for( FaceIter f = mesh.facesBegin(); f != mesh.facesEnd(); f++ )
+      {
+         HalfedgeIter h = f->halfedge();
+         faces.push_back( f );
+         triangles.push_back( h->vertex()->index );
+         triangles.push_back( h->next()->vertex()->index );
+         triangles.push_back( h->next()->next()->vertex()->index );
+      }
+
+      projected = false;
+   }
+
+   void ScreenProjection::project( const Matrix4x4& transform, double width, double height )
+   {
+      if( projected && width == projectedWidth && height == projectedHeight )
+      {
+         bool same = true;
+         for( int i = 0; i < 4; i++ )
+         for( int j = 0; j < 4; j++ )
+         {
+            if( transform(i,j) != projectedTransform(i,j) ) same = false;
+         }
+         if( same ) return;
+      }
+      projected = true;
+      projectedTransform = transform;
+      projectedWidth = width;
+      projectedHeight = height;
+
+      Size nV = px.size();
+      sx.resize( nV );
+      sy.resize( nV );
+      sz.resize( nV );
+      sw.resize( nV );
+
+      // Copy the entries we need into scalars, so that the loop body is
+      // free of aliasing and can be vectorized.
+      const double m00 = transform(0,0), m01 = transform(0,1), m02 = transform(0,2), m03 = transform(0,3);
+      const double m10 = transform(1,0), m11 = transform(1,1), m12 = transform(1,2), m13 = transform(1,3);
+      const double m20 = transform(2,0), m21 = transform(2,1), m22 = transform(2,2), m23 = transform(2,3);
+      const double m30 = transform(3,0), m31 = transform(3,1), m32 = transform(3,2), m33 = transform(3,3);
+
+      const double* x = &px[0];
+      const double* y = &py[0];
+      const double* z = &pz[0];
+      double* outX = &sx[0];
+      double* outY = &sy[0];
+      double* outZ = &sz[0];
+      double* outW = &sw[0];
+
+      // The arithmetic is ordered exactly as in Matrix4x4::operator*()
+      // and Vector4D::operator/=(), so that the results match the original
+      // per-triangle picking code bit for bit.  (Vector4D::operator/=()
+      // leaves w alone, so the depth is the clip-space w, i.e., eye depth.)
+      #pragma omp simd
+      for( long i = 0; i < (long) nV; i++ )
+      {
+         double cx = x[i]*m00 + y[i]*m01 + z[i]*m02 + m03;
+         double cy = x[i]*m10 + y[i]*m11 + z[i]*m12 + m13;
+         double cz = x[i]*m20 + y[i]*m21 + z[i]*m22 + m23;
+         double cw = x[i]*m30 + y[i]*m31 + z[i]*m32 + m33;
+
+         double r = 1./cw;
+         outX[i] = width  * ( cx*r + 1 ) / 2;
+         outY[i] = height * ( cy*r + 1 ) / 2;
+         outZ[i] = cz*r;
+         outW[i] = cw;
+      }
+   }
+
+   bool ScreenProjection::pick( const Vector2D& p, float& w, FaceIter& face, Vector3D& barycentric )
+   {
+      Size nT = faces.size();
+      if( nT == 0 ) return false;
+
+      bu.resize( nT );
+      bv.resize( nT );
+      inside.resize( nT );
+
+      const double* x = &sx[0];
+      const double* y = &sy[0];
+      const Index* t = &triangles[0];
+      double* u = &bu[0];
+      double* v = &bv[0];
+      unsigned char* in = &inside[0];
+      const double qx = p.x;
+      const double qy = p.y;
+
+      // First, find the barycentric coordinates of p with respect to
+      // every triangle, and whether p lies inside it.
+      #pragma omp simd
+      for( long i = 0; i < (long) nT; i++ )
+      {
+         Index a = t[3*i+0];
+         Index b = t[3*i+1];
+         Index c = t[3*i+2];
+
+         double v0x = x[c] - x[a], v0y = y[c] - y[a];
+         double v1x = x[b] - x[a], v1y = y[b] - y[a];
+         double v2x = qx   - x[a], v2y = qy   - y[a];
+
+         double dot00 = v0x*v0x + v0y*v0y;
+         double dot01 = v0x*v1x + v0y*v1y;
+         double dot02 = v0x*v2x + v0y*v2y;
+         double dot11 = v1x*v1x + v1y*v1y;
+         double dot12 = v1x*v2x + v1y*v2y;
+
+         double invDenom = 1.0 / (dot00 * dot11 - dot01 * dot01);
+         u[i] = (dot11 * dot02 - dot01 * dot12) * invDenom;
+         v[i] = (dot00 * dot12 - dot01 * dot02) * invDenom;
+         in[i] = (u[i] >= 0) && (v[i] >= 0) && (u[i] + v[i] < 1);
+      }
+
+      // Then apply the depth test to the (few) triangles that contain p,
+      // in order, since the first of several equally close triangles wins.
+      bool found = false;
+      for( Index i = 0; i < nT; i++ )
+      {
+         if( !in[i] ) continue;
+
+         float bary_u = u[i];
+         float bary_v = v[i];
+
+         double wA = sw[ t[3*i+0] ];
+         double wB = sw[ t[3*i+1] ];
+         double wC = sw[ t[3*i+2] ];
+
+         float dwu = wC - wA;
+         float dwv = wB - wA;
+         float w_new = wA + dwu*bary_u + dwv*bary_v;
+
+         if( w < 0.0 || ( w_new > 0 && w_new < w ) )
+         {
+            w = w_new;
+            face = faces[i];
+            barycentric.x = 1.0 - bary_u - bary_v;
+            barycentric.y = bary_v;
+            barycentric.z = bary_u;
+            found = true;
+         }
+      }
+
+      return found;
+   }
+
+   void ScreenProjection::barycentric( Index t, const Vector2D& p, Vector3D& barycentric, float& w ) const
+   {
+      Index a = triangles[3*t+0];
+      Index b = triangles[3*t+1];
+      Index c = triangles[3*t+2];
+
+      double v0x = sx[c] - sx[a], v0y = sy[c] - sy[a];
+      double v1x = sx[b] - sx[a], v1y = sy[b] - sy[a];
+      double v2x = p.x   - sx[a], v2y = p.y   - sy[a];
+
+      double dot00 = v0x*v0x + v0y*v0y;
+      double dot01 = v0x*v1x + v0y*v1y;
+      double dot02 = v0x*v2x + v0y*v2y;
+      double dot11 = v1x*v1x + v1y*v1y;
+      double dot12 = v1x*v2x + v1y*v2y;
+
+      double denom = dot00 * dot11 - dot01 * dot01;
+      double u = 1./3., v = 1./3.; // (for a degenerate triangle)
+      if( denom != 0. )
+      {
+         u = (dot11 * dot02 - dot01 * dot12) / denom;
+         v = (dot00 * dot12 - dot01 * dot02) / denom;
+      }
+
+      // Clamp to the triangle.
+      u = max( 0., u );
+      v = max( 0., v );
+      if( u + v > 1. )
+      {
+         double s = u + v;
+         u /= s;
+         v /= s;
+      }
+
+      barycentric.x = 1. - u - v;
+      barycentric.y = v;
+      barycentric.z = u;
+      w = sw[a] + ( sw[c] - sw[a] )*u + ( sw[b] - sw[a] )*v;
+   }
+
+   void ScreenProjection::select( const vector<Vector2D>& polygon, vector<unsigned char>& inside )
+   {
+      Size nV = sx.size();
+      inside.assign( nV, 0 );
+      if( nV == 0 || polygon.size() < 3 ) return;
+
+      double x0 = polygon[0].x, x1 = polygon[0].x;
+      double y0 = polygon[0].y, y1 = polygon[0].y;
+      for( Index k = 1; k < polygon.size(); k++ )
+      {
+         x0 = min( x0, polygon[k].x ); x1 = max( x1, polygon[k].x );
+         y0 = min( y0, polygon[k].y ); y1 = max( y1, polygon[k].y );
+      }
+
+      // First, keep only the vertices inside the bounding box of the
+      // polygon (and in front of the eye), which is usually a small
+      // fraction of the mesh.
+      const double* x = &sx[0];
+      const double* y = &sy[0];
+      const double* z = &sz[0];
+      const double* w = &sw[0];
+      unsigned char* in = &inside[0];
+      #pragma omp simd
+      for( long i = 0; i < (long) nV; i++ )
+      {
+         in[i] = w[i] > 0. && z[i] >= -1. && z[i] <= 1. &&
+                 x[i] >= x0 && x[i] <= x1 && y[i] >= y0 && y[i] <= y1;
+      }
+
+      candidates.clear();
+      for( Index i = 0; i < nV; i++ )
+      {
+         if( in[i] ) candidates.push_back( i );
+      }
+      Size nC = candidates.size();
+      if( nC == 0 ) return;
+
+      cx.resize( nC );
+      cy.resize( nC );
+      crossings.assign( nC, 0 );
+      for( Index k = 0; k < nC; k++ )
+      {
+         cx[k] = x[ candidates[k] ];
+         cy[k] = y[ candidates[k] ];
+      }
+
+      // Then count how many polygon edges a ray from each candidate
+      // toward +x crosses, one edge at a time across all candidates.
+      const double* px = &cx[0];
+      const double* py = &cy[0];
+      unsigned char* c = &crossings[0];
+      for( Index k = 0; k < polygon.size(); k++ )
+      {
+         const Vector2D& a( polygon[k] );
+         const Vector2D& b( polygon[ (k+1) % polygon.size() ] );
+         if( a.y == b.y ) continue;
+         const double ax = a.x, ay = a.y;
+         const double slope = ( b.x - a.x ) / ( b.y - a.y );
+         const double ylo = min( a.y, b.y ), yhi = max( a.y, b.y );
+
+         #pragma omp simd
+         for( long i = 0; i < (long) nC; i++ )
+         {
+            c[i] ^= ( py[i] >= ylo && py[i] < yhi && px[i] < ax + slope*( py[i] - ay ) );
+         }
+      }
+
+      for( Index k = 0; k < nC; k++ )
+      {
+         in[ candidates[k] ] = crossings[k];
+      }
+   }
+
+} // namespace CMU462
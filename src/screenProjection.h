@@ -0,0 +1,127 @@
+/*
+ * Screen-space image of a HalfedgeMesh, stored as flat arrays.
+ *
+ * A ScreenProjection keeps a copy of the vertex positions and triangles
+ * of a mesh in structure-of-arrays form, so that all vertices can be
+ * transformed to the screen in a single (vectorized) pass, rather than
+ * once per triangle they belong to.  Queries against the projected
+ * mesh (such as picking the triangle under the cursor) then only touch
+ * contiguous arrays of numbers.
+ *
+ * gather() must be called again whenever the mesh changes (including
+ * when vertices move); project() must be called again whenever the
+ * view changes.  Both reuse their storage from one call to the next.
+ *
+ * Picking follows the fixed-function pipeline.  A vertex X is taken to
+ * clip space by the combined transform (projection times modelview),
+ * divided by its w coordinate, and mapped from the unit cube to the
+ * screen as ( width*(x+1)/2, height*(y+1)/2 ), with the origin at the
+ * bottom left.  The screen point lies inside a triangle ABC if its
+ * barycentric coordinates u (towards C) and v (towards B) satisfy
+ * u >= 0, v >= 0 and u+v < 1.  Its depth is the clip-space w (i.e., eye
+ * depth) of A, B and C, interpolated linearly in u and v; the triangle
+ * with the smallest positive depth wins, and the first one wins ties.
+ */
+
+#ifndef CMU462_SCREENPROJECTION_H
+#define CMU462_SCREENPROJECTION_H
+
+#include <vector>
+
+#include "halfEdgeMesh.h"
+
+namespace CMU462
+{
+   class ScreenProjection
+   {
+      public:
+         ScreenProjection( void ) : projected( false ), projectedWidth( 0. ), projectedHeight( 0. ) {}
+
+         /**
+          * Copies the vertex positions of the given mesh, and the first
+          * three vertices of each of its faces (as in the original picking
+          * code, faces are assumed to be triangles).  Numbers the vertices
+          * of the mesh as a side effect (see indexVertices()).
+          */
+         void gather( HalfedgeMesh& mesh );
+
+         /**
+          * Maps every vertex through the given (projection * modelview)
+          * transform, then to a screen of the given size, with the origin
+          * at the bottom left.  Does nothing if the vertices were already
+          * projected with the same transform and screen size (and the mesh
+          * has not been gathered again since).
+          */
+         void project( const Matrix4x4& transform, double width, double height );
+
+         /**
+          * Finds the closest triangle containing the screen point p, as
+          * described above.  On input, w is the depth of the closest
+          * triangle found so far (or negative, if there is none).  Returns
+          * true if a closer triangle was found, in which case it also
+          * updates w and sets face and barycentric (to ( 1-u-v, v, u )).
+          */
+         bool pick( const Vector2D& p, float& w, FaceIter& face, Vector3D& barycentric );
+
+         /**
+          * Computes the barycentric coordinates and depth of the screen
+          * point p on triangle t, as pick() does.  If p lies (slightly)
+          * outside the triangle, the coordinates are clamped to it.
+          */
+         void barycentric( Index t, const Vector2D& p, Vector3D& barycentric, float& w ) const;
+
+         /**
+          * Sets inside[i] to 1 if vertex i projects to a point inside the
+          * given screen polygon (e.g., the four corners of a rectangle, or
+          * a lasso), and lies between the near and far planes; otherwise
+          * sets it to 0.  Uses the even-odd rule for self-intersecting
+          * polygons.
+          */
+         void select( const vector<Vector2D>& polygon, vector<unsigned char>& inside );
+
+         Size nVertices( void ) const { return vertices.size(); }
+         Size nTriangles( void ) const { return faces.size(); }
+         FaceIter face( Index t ) const { return faces[t]; }
+         VertexIter vertex( Index i ) const { return vertices[i]; }
+
+         /*
+          * Projected data (valid after project()).  Triangle t has vertices
+          * triangle(t)[0..2]; vertex i lies at screen point (x[i],y[i]),
+          * with clip-space w[i], and normalized depth z[i] (which is -1 at
+          * the near plane and 1 at the far plane).
+          */
+         const Index* triangle( Index t ) const { return &triangles[3*t]; }
+         const double* x( void ) const { return &sx[0]; }
+         const double* y( void ) const { return &sy[0]; }
+         const double* z( void ) const { return &sz[0]; }
+         const double* w( void ) const { return &sw[0]; }
+
+      protected:
+         vector<VertexIter> vertices;
+         vector<FaceIter> faces;
+         vector<Index> triangles; ///< three vertex indices per face
+
+         // model-space positions
+         vector<double> px, py, pz;
+
+         // screen-space positions, normalized depth, and clip-space w
+         vector<double> sx, sy, sz, sw;
+
+         // transform and screen size of the last call to project()
+         bool projected;
+         Matrix4x4 projectedTransform;
+         double projectedWidth, projectedHeight;
+
+         // scratch space for pick()
+         vector<double> bu, bv;
+         vector<unsigned char> inside;
+
+         // scratch space for select()
+         vector<Index> candidates;
+         vector<double> cx, cy;
+         vector<unsigned char> crossings;
+   };
+
+} // namespace CMU462
+
+#endif // CMU462_SCREENPROJECTION_H
@@ -3,6 +3,7 @@
 #include <assert.h>
 #include <iostream>
 #include <algorithm>
+#include <cmath>
 
 using namespace std;
 
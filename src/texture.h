@@ -1,7 +1,9 @@
 #ifndef CMU462_TEXTURE_H
 #define CMU462_TEXTURE_H
 
-#include "CMU462/CMU462.h"
+#include <vector>
+
+#include "CMU462/color.h"
 
 namespace CMU462 {
 
@@ -0,0 +1,138 @@
+#include "vertexCache.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace CMU462
+{
+   static const Index none = numeric_limits<Index>::max();
+
+   void orderPrimitives( const vector<Index>& indices, Size nVertices, Size primitiveSize, Size cacheSize, vector<Index>& order )
+   {
+      const Size k = primitiveSize;
+      const Size nPrimitives = indices.size() / k;
+      order.clear();
+      order.reserve( nPrimitives );
+      if( nPrimitives == 0 ) return;
+
+      // Primitives using each vertex (compressed rows), and the number
+      // of them not yet drawn.
+      vector<Index> first( nVertices + 1, 0 );
+      for( Index i = 0; i < indices.size(); i++ ) first[ indices[i] + 1 ]++;
+      for( Index v = 0; v < nVertices; v++ ) first[v+1] += first[v];
+      vector<Index> adjacent( indices.size() );
+      vector<Size> live( nVertices, 0 );
+      for( Index i = 0; i < indices.size(); i++ )
+      {
+         Index v = indices[i];
+         adjacent[ first[v] + live[v]++ ] = i / k;
+      }
+
+      // A vertex is in the cache if it was loaded by one of the last
+      // cacheSize misses (as in acmr()).
+      vector<Size> loaded( nVertices, 0 );
+      Size time = cacheSize + 1;
+
+      vector<char> drawn( nPrimitives, 0 );
+      vector<Index> deadEnd;    // recently used vertices, most recent last
+      vector<Index> candidates; // vertices of the last fan
+      Index scan = 0;           // every vertex before this one is done
+
+      Index fan = none;
+      while( true )
+      {
+         // Pick the next vertex to fan around: among the vertices just
+         // used, the one that has been in the cache longest, and whose
+         // remaining primitives will all be drawn before it leaves; else
+         // a recently used vertex with primitives left; else the next
+         // vertex in order.
+         Index next = none;
+         Size bestPriority = 0;
+         for( Index i = 0; i < candidates.size(); i++ )
+         {
+            Index v = candidates[i];
+            if( live[v] == 0 ) continue;
+
+            Size priority = 0;
+            if( time - loaded[v] + ( k - 1 ) * live[v] <= cacheSize ) priority = time - loaded[v];
+            if( next == none || priority > bestPriority )
+            {
+               next = v;
+               bestPriority = priority;
+            }
+         }
+         while( next == none && !deadEnd.empty() )
+         {
+            Index v = deadEnd.back();
+            deadEnd.pop_back();
+            if( live[v] > 0 ) next = v;
+         }
+         while( next == none && scan < nVertices )
+         {
+            if( live[scan] > 0 ) next = scan;
+            else scan++;
+         }
+         if( next == none ) break;
+         fan = next;
+
+         // Draw every remaining primitive around it.
+         candidates.clear();
+         for( Index j = first[fan]; j < first[fan+1]; j++ )
+         {
+            Index p = adjacent[j];
+            if( drawn[p] ) continue;
+
+            drawn[p] = 1;
+            order.push_back( p );
+            for( Index l = 0; l < k; l++ )
+            {
+               Index v = indices[k*p+l];
+               deadEnd.push_back( v );
+               candidates.push_back( v );
+               live[v]--;
+               if( loaded[v] == 0 || time - loaded[v] > cacheSize )
+               {
+                  loaded[v] = time++;
+               }
+            }
+         }
+      }
+   }
+
+   void orderVertices( const vector<Index>& indices, Size nVertices, vector<Index>& remap )
+   {
+      remap.assign( nVertices, none );
+
+      Index next = 0;
+      for( Index i = 0; i < indices.size(); i++ )
+      {
+         if( remap[ indices[i] ] == none ) remap[ indices[i] ] = next++;
+      }
+      for( Index v = 0; v < nVertices; v++ )
+      {
+         if( remap[v] == none ) remap[v] = next++;
+      }
+   }
+
+   double acmr( const vector<Index>& indices, Size nVertices, Size primitiveSize, Size cacheSize )
+   {
+      if( indices.empty() ) return 0.;
+
+      // A vertex is in the cache if it was loaded by one of the last
+      // cacheSize misses.
+      vector<Size> loaded( nVertices, 0 );
+      Size misses = 0;
+      for( Index i = 0; i < indices.size(); i++ )
+      {
+         Index v = indices[i];
+         if( loaded[v] == 0 || misses - loaded[v] >= cacheSize )
+         {
+            misses++;
+            loaded[v] = misses;
+         }
+      }
+
+      return double( misses ) / double( indices.size() / primitiveSize );
+   }
+
+} // namespace CMU462
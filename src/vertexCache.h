@@ -0,0 +1,51 @@
+/*
+ * Reordering of indexed primitives for the post-transform vertex cache.
+ *
+ * GPUs keep the last few transformed vertices of an indexed draw call in
+ * a small cache, so a vertex referenced again shortly afterwards need not
+ * be transformed twice.  Primitives listed in an arbitrary order (e.g.,
+ * the order of the face list, after many edits) reuse the cache poorly.
+ * These helpers reorder the primitives of an index list (triangles, or
+ * the lines of a wireframe) with the "Tipsify" algorithm of Sander et al.
+ * (which draws all remaining primitives around one vertex at a time,
+ * choosing the next vertex so that it is still in the cache), then number
+ * the vertices in order of first use, so that vertex fetches also walk
+ * memory mostly forwards.
+ *
+ * Primitives are consecutive groups of primitiveSize indices in
+ * [0,nVertices).  The average cache miss ratio (ACMR) is the number of
+ * vertices transformed per primitive: at best about 0.5 for large
+ * triangle meshes, and primitiveSize in the worst case.
+ */
+
+#ifndef CMU462_VERTEXCACHE_H
+#define CMU462_VERTEXCACHE_H
+
+#include <vector>
+
+#include "halfEdgeMesh.h"
+
+namespace CMU462
+{
+   /**
+    * Computes an order of the primitives that reuses a first-in first-out
+    * cache of the given size well: the primitive order[i] should be drawn
+    * i-th.
+    */
+   void orderPrimitives( const vector<Index>& indices, Size nVertices, Size primitiveSize, Size cacheSize, vector<Index>& order );
+
+   /**
+    * Numbers the vertices in order of first use by the given indices
+    * (unused vertices come last): vertex i becomes vertex remap[i].
+    */
+   void orderVertices( const vector<Index>& indices, Size nVertices, vector<Index>& remap );
+
+   /**
+    * Returns the average cache miss ratio of the given primitives, with a
+    * first-in first-out cache of the given size.
+    */
+   double acmr( const vector<Index>& indices, Size nVertices, Size primitiveSize, Size cacheSize = 16 );
+
+} // namespace CMU462
+
+#endif // CMU462_VERTEXCACHE_H